@@ -0,0 +1,218 @@
+// Throughput and latency benchmark for the cbuf_t byte API.
+// Covers cbuf_write/cbuf_read/cbuf_peek for chunks from 1 B to 1 MiB, the
+// single-byte calls, both index schemes (cbuf_init/cbuf_init_pow2) and two
+// access patterns: "linear" never crosses the end of buffer, "wrap" straddles
+// it. A single byte cannot straddle anything, so the 1 B "wrap" rows (chunk 1
+// and the single-byte calls) put it in the last byte instead, where the
+// position wraps to the start after the operation.
+// Operations are timed in batches long enough for the clock. Each sample is
+// the average time per operation of one batch, so the batch_p* percentiles
+// describe batch averages: they show slow batches, not the tail latency of
+// individual operations.
+//
+// Usage: bench_cbuf.out [--json] [--ms <time budget per case, default 40>]
+// Output: CSV (default) or JSON on stdout.
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cbuf.h"
+
+#define BUF_SIZE     (4u * 1024 * 1024)
+#define MAX_CHUNK    (1u * 1024 * 1024)
+#define MAX_SAMPLES  100000
+#define MIN_BATCH_NS 2000.0
+
+typedef enum { OP_WRITE, OP_READ, OP_PEEK, OP_WRITE_SINGLE, OP_READ_SINGLE } op_t;
+
+static char const *const opNames[] = {"write", "read", "peek", "write_single", "read_single"};
+
+typedef struct {
+    cbuf_t *cb;
+    op_t op;
+    uint64_t chunk;
+    uint64_t readPos;  // positions restored before every operation
+    uint64_t writePos;
+    uint8_t *data;
+} bench_case_t;
+
+typedef struct {
+    double nsPerOp;
+    double bytesPerSec;
+    double batchP50;  // percentiles of the per-batch average, ns per operation
+    double batchP99;
+    double batchP999;
+    uint64_t ops;
+} bench_result_t;
+
+static uint8_t *ringBuffer;
+static volatile uint64_t sink; // keeps results alive
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int cmp_double(void const *a, void const *b) {
+    double x = *(double const *)a, y = *(double const *)b;
+    return (x > y) - (x < y);
+}
+
+// Runs count operations, returns bytes moved
+static uint64_t run_batch(bench_case_t const *c, uint64_t count) {
+    cbuf_t *cb = c->cb;
+    uint64_t bytes = 0;
+    uint8_t byte = 0;
+
+    for (uint64_t i = 0; i < count; i++) {
+        cb->readPos  = c->readPos;
+        cb->writePos = c->writePos;
+        switch (c->op) {
+            case OP_WRITE:        bytes += cbuf_write(cb, c->data, c->chunk); break;
+            case OP_READ:         bytes += cbuf_read(cb, c->data, c->chunk); break;
+            case OP_PEEK:         bytes += cbuf_peek(cb, c->data, c->chunk); break;
+            case OP_WRITE_SINGLE: bytes += cbuf_write_single(cb, (uint8_t)i); break;
+            case OP_READ_SINGLE:  bytes += cbuf_read_single(cb, &byte); sink += byte; break;
+        }
+    }
+    return bytes;
+}
+
+static bench_result_t run_case(bench_case_t const *c, double budgetNs) {
+    static double samples[MAX_SAMPLES];
+    bench_result_t r = {0};
+    uint64_t batch = 1, bytes = 0, numSamples = 0;
+    double total = 0;
+
+    // Grow the batch until it is long enough to be timed reliably
+    for (;;) {
+        double t0 = now_ns();
+        sink += run_batch(c, batch);
+        if (now_ns() - t0 >= MIN_BATCH_NS || batch >= (1u << 20)) {
+            break;
+        }
+        batch *= 2;
+    }
+
+    while (total < budgetNs && numSamples < MAX_SAMPLES) {
+        double t0 = now_ns();
+        bytes += run_batch(c, batch);
+        double dt = now_ns() - t0;
+        samples[numSamples++] = dt / (double)batch;
+        total += dt;
+    }
+
+    qsort(samples, numSamples, sizeof(samples[0]), cmp_double);
+    r.ops         = numSamples * batch;
+    r.nsPerOp     = total / (double)r.ops;
+    r.bytesPerSec = (double)bytes / (total * 1e-9);
+    r.batchP50    = samples[(uint64_t)(0.5 * (double)(numSamples - 1))];
+    r.batchP99    = samples[(uint64_t)(0.99 * (double)(numSamples - 1))];
+    r.batchP999   = samples[(uint64_t)(0.999 * (double)(numSamples - 1))];
+    return r;
+}
+
+// Precompute positions so that chunk bytes start at startOffset
+static void place(bench_case_t *c, uint64_t startOffset, bool filled) {
+    uint64_t end = startOffset + (filled ? c->chunk : 0);
+    c->readPos  = startOffset;
+    c->writePos = (c->cb->mask || end < c->cb->size) ? end : (end - c->cb->size);
+}
+
+static void report(bool json, bool *first, bench_case_t const *c, char const *scheme, char const *pattern, bench_result_t const *r) {
+    if (json) {
+        printf("%s\n  {\"op\": \"%s\", \"scheme\": \"%s\", \"pattern\": \"%s\", \"chunk\": %llu, \"ops\": %llu, "
+               "\"bytes_per_sec\": %.0f, \"ns_per_op\": %.3f, \"batch_p50_ns\": %.3f, \"batch_p99_ns\": %.3f, "
+               "\"batch_p999_ns\": %.3f}",
+               *first ? "" : ",", opNames[c->op], scheme, pattern, (unsigned long long)c->chunk,
+               (unsigned long long)r->ops, r->bytesPerSec, r->nsPerOp, r->batchP50, r->batchP99, r->batchP999);
+    }
+    else {
+        printf("%s,%s,%s,%llu,%llu,%.0f,%.3f,%.3f,%.3f,%.3f\n", opNames[c->op], scheme, pattern,
+               (unsigned long long)c->chunk, (unsigned long long)r->ops, r->bytesPerSec, r->nsPerOp,
+               r->batchP50, r->batchP99, r->batchP999);
+    }
+    *first = false;
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    bool json = false, first = true;
+    double budgetNs = 40e6;
+    cbuf_t cb;
+
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--json")) {
+            json = true;
+        }
+        else if (0 == strcmp(argv[i], "--ms") && i + 1 < argc) {
+            budgetNs = atof(argv[++i]) * 1e6;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--json] [--ms <time budget per case>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    ringBuffer = malloc(BUF_SIZE);
+    uint8_t *data = malloc(MAX_CHUNK);
+    if (NULL == ringBuffer || NULL == data) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    memset(ringBuffer, 0x5A, BUF_SIZE);
+    memset(data, 0xA5, MAX_CHUNK);
+
+    if (json) {
+        printf("[");
+    }
+    else {
+        printf("op,scheme,pattern,chunk,ops,bytes_per_sec,ns_per_op,batch_p50_ns,batch_p99_ns,batch_p999_ns\n");
+    }
+
+    for (int scheme = 0; scheme < 2; scheme++) {
+        char const *schemeName = scheme ? "pow2" : "init";
+        // cbuf_init() with a non power-of-two size, cbuf_init_pow2() with the full buffer
+        bool ok = scheme ? cbuf_init_pow2(&cb, ringBuffer, BUF_SIZE) : cbuf_init(&cb, ringBuffer, BUF_SIZE - 13);
+        if (!ok) {
+            fprintf(stderr, "init failed\n");
+            return 1;
+        }
+        for (int wrap = 0; wrap < 2; wrap++) {
+            char const *patternName = wrap ? "wrap" : "linear";
+            for (op_t op = OP_WRITE; op <= OP_READ_SINGLE; op++) {
+                bool single = (OP_WRITE_SINGLE == op || OP_READ_SINGLE == op);
+                for (uint64_t chunk = 1; chunk <= MAX_CHUNK; chunk *= 4) {
+                    bench_case_t c = {&cb, op, single ? 1 : chunk, 0, 0, data};
+                    uint64_t start = 0;
+                    if (wrap) {
+                        // Half of the chunk before the end of buffer, the rest at the start.
+                        // A single byte lands in the last byte of the buffer.
+                        start = cb.size - (c.chunk + 1) / 2;
+                    }
+                    place(&c, start, OP_WRITE != op && OP_WRITE_SINGLE != op);
+                    if (first) {
+                        run_case(&c, budgetNs); // warm up caches and CPU clock
+                    }
+                    bench_result_t r = run_case(&c, budgetNs);
+                    report(json, &first, &c, schemeName, patternName, &r);
+                    if (single) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if (json) {
+        printf("\n]\n");
+    }
+    free(data);
+    free(ringBuffer);
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Copy kernels behind cbuf_write/cbuf_read (cbuf_copy_bytes()) against plain
+// memcpy(), from 8 B records to 16 MiB bulk copies. Up to 64 B the length
+// varies between half the size and the size, like records do. After each
+// case a hot 1 MiB working set is read again after one more copy and timed,
+// to show how much of it the copy pushed out of the caches.
+//
+// Usage: bench_copy.out [--ms <time budget per case, default 200>]
+// Output: CSV on stdout.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cbuf.h"
+#include "cbuf_internal.h"
+
+#define MAX_CHUNK    (16u * 1024 * 1024)
+#define WORKING_SET  (1u * 1024 * 1024)
+#define NUM_LENGTHS  256
+#define REREAD_RUNS  16
+
+static volatile uint64_t sink; // keeps results alive
+static uint64_t lengths[NUM_LENGTHS];
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t touch(uint8_t const *data, uint64_t len) {
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < len; i += 64) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// Returns bytes per second, *rereadNs is the time to read the working set afterwards
+static double run_case(uint8_t *dst, uint8_t const *src, uint8_t const *ws, uint64_t chunk, int kernel,
+                       double budgetNs, double *rereadNs) {
+    uint64_t const step = (chunk <= 64) ? 64 : chunk; // records packed, bulk copies repeated
+    uint64_t const span = (chunk <= 64) ? 64 * 1024 : chunk;
+    uint64_t bytes = 0, pos = 0;
+    uint32_t i = 0;
+    double t0 = now_ns(), dt;
+
+    for (uint32_t k = 0; k < NUM_LENGTHS; k++) {
+        lengths[k] = (chunk <= 64) ? chunk / 2 + 1 + (uint64_t)rand() % (chunk / 2) : chunk;
+    }
+    do {
+        for (int j = 0; j < 64; j++) {
+            uint64_t n = lengths[i++ % NUM_LENGTHS];
+            if (kernel) {
+                cbuf_copy_bytes(dst + pos, src + pos, n);
+            }
+            else {
+                memcpy(dst + pos, src + pos, n);
+            }
+            bytes += n;
+            pos = (pos + step < span) ? pos + step : 0;
+        }
+        sink += dst[pos];
+        dt = now_ns() - t0;
+    } while (dt < budgetNs);
+
+    *rereadNs = 0;
+    for (int j = 0; j < REREAD_RUNS; j++) {
+        sink += touch(ws, WORKING_SET);
+        if (kernel) {
+            cbuf_copy_bytes(dst, src, span);
+        }
+        else {
+            memcpy(dst, src, span);
+        }
+        double t1 = now_ns();
+        sink += touch(ws, WORKING_SET);
+        *rereadNs += (now_ns() - t1) / REREAD_RUNS;
+    }
+    return (double)bytes / (dt * 1e-9);
+}
+
+int main(int argc, char **argv) {
+    double budgetNs = 200e6;
+
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--ms") && i + 1 < argc) {
+            budgetNs = atof(argv[++i]) * 1e6;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--ms <time budget per case>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    uint8_t *src = malloc(MAX_CHUNK);
+    uint8_t *dst = malloc(MAX_CHUNK + 64);
+    uint8_t *ws  = malloc(WORKING_SET);
+    if (NULL == src || NULL == dst || NULL == ws) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    memset(src, 0x5A, MAX_CHUNK);
+    memset(dst, 0, MAX_CHUNK + 64);
+    memset(ws, 1, WORKING_SET);
+    double reread;
+    run_case(dst, src, ws, MAX_CHUNK, 1, budgetNs, &reread); // warm up caches and CPU clock
+
+    printf("chunk,memcpy_bytes_per_sec,cbuf_bytes_per_sec,memcpy_reread_ns,cbuf_reread_ns\n");
+    for (uint64_t chunk = 8; chunk <= MAX_CHUNK; chunk *= (chunk < 64) ? 2 : 4) {
+        double rereadLibc, rereadCbuf;
+        double libc = run_case(dst + 1, src, ws, chunk, 0, budgetNs, &rereadLibc); // dst misaligned like a ring offset
+        double cbuf = run_case(dst + 1, src, ws, chunk, 1, budgetNs, &rereadCbuf);
+        printf("%llu,%.0f,%.0f,%.0f,%.0f\n", (unsigned long long)chunk, libc, cbuf, rereadLibc, rereadCbuf);
+        fflush(stdout);
+    }
+    free(ws);
+    free(dst);
+    free(src);
+    return 0;
+}
@@ -0,0 +1,88 @@
+// CRC32C over ring contents: cbuf_read() followed by cbuf_crc32c() (two
+// passes) against cbuf_read_crc32c() (checksum during the copy), for chunks
+// from 64 B to 1 MiB. Every read wraps around the end of buffer.
+//
+// Usage: bench_crc.out [--ms <time budget per case, default 200>]
+// Output: CSV on stdout.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cbuf.h"
+#include "cbuf_crc.h"
+
+#define BUF_SIZE  (4u * 1024 * 1024)
+#define MAX_CHUNK (1u * 1024 * 1024)
+
+static volatile uint32_t sink; // keeps results alive
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Returns bytes per second
+static double run_case(cbuf_t *cb, uint8_t *out, uint64_t chunk, int fused, double budgetNs) {
+    uint64_t const start = cb->size - chunk / 2;
+    uint64_t bytes = 0;
+    double t0 = now_ns(), dt;
+
+    do {
+        for (int i = 0; i < 64; i++) {
+            uint32_t crc = CBUF_CRC32C_INIT;
+            cb->readPos  = start;
+            cb->writePos = start + chunk;
+            if (fused) {
+                bytes += cbuf_read_crc32c(cb, out, chunk, &crc);
+            }
+            else {
+                uint64_t n = cbuf_read(cb, out, chunk);
+                crc = cbuf_crc32c(crc, out, n);
+                bytes += n;
+            }
+            sink += crc;
+        }
+        dt = now_ns() - t0;
+    } while (dt < budgetNs);
+    return (double)bytes / (dt * 1e-9);
+}
+
+int main(int argc, char **argv) {
+    double budgetNs = 200e6;
+    cbuf_t cb;
+
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--ms") && i + 1 < argc) {
+            budgetNs = atof(argv[++i]) * 1e6;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--ms <time budget per case>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    uint8_t *ringBuffer = malloc(BUF_SIZE);
+    uint8_t *out = malloc(MAX_CHUNK);
+    if (NULL == ringBuffer || NULL == out || !cbuf_init_pow2(&cb, ringBuffer, BUF_SIZE)) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    memset(ringBuffer, 0x5A, BUF_SIZE);
+    memset(out, 0, MAX_CHUNK);
+    run_case(&cb, out, MAX_CHUNK, 1, budgetNs); // warm up caches and CPU clock
+
+    printf("chunk,two_pass_bytes_per_sec,fused_bytes_per_sec\n");
+    for (uint64_t chunk = 64; chunk <= MAX_CHUNK; chunk *= 4) {
+        double twoPass = run_case(&cb, out, chunk, 0, budgetNs);
+        double fused   = run_case(&cb, out, chunk, 1, budgetNs);
+        printf("%llu,%.0f,%.0f\n", (unsigned long long)chunk, twoPass, fused);
+        fflush(stdout);
+    }
+    free(out);
+    free(ringBuffer);
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Single-byte loops through the out-of-line calls of cbuf.h against the
+// header versions of cbuf_inline.h, for both index schemes. "fill_drain"
+// writes the buffer full byte by byte and reads it empty again, "decode"
+// feeds a byte stream through a small ring the way an ISR and a line decoder
+// would, counting '\n' on the read side.
+//
+// Usage: bench_inline.out [--ms <time budget per case, default 200>]
+// Output: CSV on stdout, nanoseconds per byte.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cbuf.h"
+#include "cbuf_inline.h"
+
+#define BUF_SIZE   4096
+#define CHUNK      64 // bytes per ISR in "decode"
+#define INPUT_SIZE (64 * 1024)
+
+static volatile uint64_t sink; // keeps results alive
+static uint8_t input[INPUT_SIZE];
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Both variants are written out instead of going through a function pointer,
+// which would keep the compiler from inlining either
+static uint64_t fill_drain(cbuf_t *cb, int useInline) {
+    uint64_t sum = 0, bytes = 0;
+    uint8_t value;
+
+    if (useInline) {
+        while (cbuf_write_single_inline(cb, (uint8_t)bytes)) {
+            bytes++;
+        }
+        while (cbuf_read_single_inline(cb, &value)) {
+            sum += value;
+        }
+    }
+    else {
+        while (cbuf_write_single(cb, (uint8_t)bytes)) {
+            bytes++;
+        }
+        while (cbuf_read_single(cb, &value)) {
+            sum += value;
+        }
+    }
+    sink += sum;
+    return bytes;
+}
+
+static uint64_t decode(cbuf_t *cb, int useInline) {
+    uint64_t lines = 0;
+    uint8_t value;
+
+    for (uint32_t pos = 0; pos < INPUT_SIZE; pos += CHUNK) {
+        if (useInline) {
+            for (uint32_t i = 0; i < CHUNK; i++) {
+                cbuf_write_single_inline(cb, input[pos + i]);
+            }
+            while (!cbuf_is_empty_inline(cb)) {
+                cbuf_read_single_inline(cb, &value);
+                lines += ('\n' == value);
+            }
+        }
+        else {
+            for (uint32_t i = 0; i < CHUNK; i++) {
+                cbuf_write_single(cb, input[pos + i]);
+            }
+            while (!cbuf_is_empty(cb)) {
+                cbuf_read_single(cb, &value);
+                lines += ('\n' == value);
+            }
+        }
+    }
+    sink += lines;
+    return INPUT_SIZE;
+}
+
+// Returns ns per byte
+static double run_case(cbuf_t *cb, uint64_t (*body)(cbuf_t *, int), int useInline, double budgetNs) {
+    uint64_t bytes = 0;
+    double t0 = now_ns(), dt;
+
+    do {
+        for (int i = 0; i < 16; i++) {
+            bytes += body(cb, useInline);
+        }
+        dt = now_ns() - t0;
+    } while (dt < budgetNs);
+    return dt / (double)bytes;
+}
+
+int main(int argc, char **argv) {
+    double budgetNs = 200e6;
+    static uint8_t ringBuffer[BUF_SIZE];
+    static char const *const schemes[] = {"init", "pow2"};
+    static char const *const bodies[] = {"fill_drain", "decode"};
+    uint64_t (*const fns[])(cbuf_t *, int) = {fill_drain, decode};
+
+    for (int i = 1; i < argc; i++) {
+        if (0 == strcmp(argv[i], "--ms") && i + 1 < argc) {
+            budgetNs = atof(argv[++i]) * 1e6;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--ms <time budget per case>]\n", argv[0]);
+            return 1;
+        }
+    }
+    for (uint32_t i = 0; i < INPUT_SIZE; i++) {
+        input[i] = (0 == i % 37) ? '\n' : (uint8_t)('a' + i % 26);
+    }
+
+    printf("case,scheme,call_ns_per_byte,inline_ns_per_byte\n");
+    for (int s = 0; s < 2; s++) {
+        for (int b = 0; b < 2; b++) {
+            cbuf_t cb;
+            bool ok = s ? cbuf_init_pow2(&cb, ringBuffer, BUF_SIZE) : cbuf_init(&cb, ringBuffer, BUF_SIZE);
+            if (!ok) {
+                fprintf(stderr, "setup failed\n");
+                return 1;
+            }
+            run_case(&cb, fns[b], 0, budgetNs / 4); // warm up
+            double call    = run_case(&cb, fns[b], 0, budgetNs);
+            double inlined = run_case(&cb, fns[b], 1, budgetNs);
+            printf("%s,%s,%.3f,%.3f\n", bodies[b], schemes[s], call, inlined);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Contention benchmark for cbuf_mpmc_t against a mutex-protected cbuf_t.
+// Every thread alternates one push and one pop of a 16-byte element, the
+// thread count goes from 1 to the given maximum (default: 2 * online CPUs).
+//
+// Usage: bench_mpmc.out [max_threads] [ops_per_thread]
+// Output: CSV on stdout.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cbuf.h"
+#include "cbuf_mpmc.h"
+
+#define ELEM_SIZE 16
+#define NUM_SLOTS 1024
+
+typedef struct {
+    uint64_t a;
+    uint64_t b;
+} elem_t;
+
+static cbuf_mpmc_t mpmcQueue;
+static uint64_t mpmcBuffer[CBUF_MPMC_BUFFER_SIZE(NUM_SLOTS, ELEM_SIZE) / 8];
+
+static cbuf_t lockedCb;
+static uint8_t lockedBuffer[NUM_SLOTS * ELEM_SIZE];
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_barrier_t startBarrier;
+static uint64_t opsPerThread;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void *mpmc_worker(void *arg) {
+    elem_t e = {(uint64_t)(uintptr_t)arg, 0};
+    pthread_barrier_wait(&startBarrier);
+    for (uint64_t i = 0; i < opsPerThread; i++) {
+        e.b = i;
+        while (!cbuf_mpmc_try_push(&mpmcQueue, &e)) {
+            sched_yield();
+        }
+        while (!cbuf_mpmc_try_pop(&mpmcQueue, &e)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static bool locked_push(elem_t const *e) {
+    bool ok;
+    pthread_mutex_lock(&lock);
+    ok = (cbuf_get_free(&lockedCb) >= sizeof(*e)) && (sizeof(*e) == cbuf_write(&lockedCb, e, sizeof(*e)));
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+static bool locked_pop(elem_t *e) {
+    bool ok;
+    pthread_mutex_lock(&lock);
+    ok = (cbuf_get_filled(&lockedCb) >= sizeof(*e)) && (sizeof(*e) == cbuf_read(&lockedCb, e, sizeof(*e)));
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+static void *locked_worker(void *arg) {
+    elem_t e = {(uint64_t)(uintptr_t)arg, 0};
+    pthread_barrier_wait(&startBarrier);
+    for (uint64_t i = 0; i < opsPerThread; i++) {
+        e.b = i;
+        while (!locked_push(&e)) {
+            sched_yield();
+        }
+        while (!locked_pop(&e)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Returns elapsed wall time for numThreads workers
+static double run(void *(*worker)(void *), unsigned numThreads) {
+    pthread_t threads[numThreads];
+    pthread_barrier_init(&startBarrier, NULL, numThreads + 1);
+    for (unsigned i = 0; i < numThreads; i++) {
+        pthread_create(&threads[i], NULL, worker, (void *)(uintptr_t)i);
+    }
+    double start = now_sec();
+    pthread_barrier_wait(&startBarrier);
+    for (unsigned i = 0; i < numThreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now_sec() - start;
+    pthread_barrier_destroy(&startBarrier);
+    return elapsed;
+}
+
+int main(int argc, char **argv) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned maxThreads = (argc > 1) ? (unsigned)atoi(argv[1]) : (unsigned)(2 * (cpus > 0 ? cpus : 1));
+    opsPerThread = (argc > 2) ? strtoull(argv[2], NULL, 0) : 1000000;
+
+    if (0 == maxThreads || !cbuf_mpmc_init(&mpmcQueue, mpmcBuffer, sizeof(mpmcBuffer), ELEM_SIZE)
+        || !cbuf_init(&lockedCb, lockedBuffer, sizeof(lockedBuffer))) {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    printf("impl,threads,ops,seconds,mops_per_sec,ns_per_op\n");
+    for (unsigned t = 1; t <= maxThreads; t++) {
+        uint64_t ops = 2 * opsPerThread * t; // one push and one pop per iteration
+        double s = run(mpmc_worker, t);
+        printf("mpmc,%u,%llu,%.6f,%.3f,%.2f\n", t, (unsigned long long)ops, s, ops / s * 1e-6, s * 1e9 / ops);
+        s = run(locked_worker, t);
+        printf("mutex_cbuf,%u,%llu,%.6f,%.3f,%.2f\n", t, (unsigned long long)ops, s, ops / s * 1e-6, s * 1e9 / ops);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Two-thread benchmark of cbuf_t (cbuf_write_spsc()/cbuf_read_spsc()) against
+// the cache-line separated cbuf_spsc_t.
+// - pingpong: a message bounces between the threads over two rings,
+//   reported as round-trip time.
+// - stream: one thread writes fixed-size chunks, the other reads them,
+//   reported as throughput.
+//
+// Usage: bench_pingpong.out [round_trips] [stream_bytes]
+// Output: CSV on stdout. Pin the process to two physical cores for stable numbers.
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cbuf.h"
+#include "cbuf_spsc.h"
+
+#define RING_SIZE  (64 * 1024)
+#define MSG_SIZE   8
+#define CHUNK_SIZE 64
+#define SPIN_LIMIT 4096 // failed polls before yielding, keeps single-core machines going
+
+typedef enum { VARIANT_CBUF, VARIANT_ALIGNED } variant_t;
+
+static char const *const variantNames[] = {"cbuf_t", "cbuf_spsc_t"};
+
+// Packed next to each other, as two rings in an application struct would be
+static cbuf_t packedRings[2];
+static cbuf_spsc_t alignedRings[2];
+static uint8_t ringBuffers[2][RING_SIZE];
+
+static variant_t variant;
+static uint64_t roundTrips;
+static uint64_t streamBytes;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline uint64_t ring_write(int ring, void const *data, uint64_t len) {
+    return (VARIANT_CBUF == variant) ? cbuf_write_spsc(&packedRings[ring], data, len)
+                                     : cbuf_spsc_write(&alignedRings[ring], data, len);
+}
+
+static inline uint64_t ring_read(int ring, void *data, uint64_t len) {
+    return (VARIANT_CBUF == variant) ? cbuf_read_spsc(&packedRings[ring], data, len)
+                                     : cbuf_spsc_read(&alignedRings[ring], data, len);
+}
+
+static inline void backoff(uint32_t *spins) {
+    if (++*spins >= SPIN_LIMIT) {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+// Blocks by spinning until exactly len bytes moved
+static inline void ring_write_all(int ring, void const *data, uint64_t len) {
+    uint64_t done = 0;
+    uint32_t spins = 0;
+    while (done < len) {
+        uint64_t n = ring_write(ring, (uint8_t const *)data + done, len - done);
+        if (0 == n) {
+            backoff(&spins);
+        }
+        done += n;
+    }
+}
+
+static inline void ring_read_all(int ring, void *data, uint64_t len) {
+    uint64_t done = 0;
+    uint32_t spins = 0;
+    while (done < len) {
+        uint64_t n = ring_read(ring, (uint8_t *)data + done, len - done);
+        if (0 == n) {
+            backoff(&spins);
+        }
+        done += n;
+    }
+}
+
+static void init_rings(void) {
+    for (int i = 0; i < 2; i++) {
+        cbuf_init_pow2(&packedRings[i], ringBuffers[i], RING_SIZE);
+        cbuf_spsc_init(&alignedRings[i], ringBuffers[i], RING_SIZE);
+    }
+}
+
+static void *pong_thread(void *arg) {
+    uint8_t msg[MSG_SIZE];
+    (void)arg;
+    for (uint64_t i = 0; i < roundTrips; i++) {
+        ring_read_all(0, msg, MSG_SIZE);
+        ring_write_all(1, msg, MSG_SIZE);
+    }
+    return NULL;
+}
+
+static void *stream_reader(void *arg) {
+    uint8_t chunk[CHUNK_SIZE];
+    uint64_t *checksum = (uint64_t *)arg;
+    for (uint64_t done = 0; done < streamBytes; done += CHUNK_SIZE) {
+        ring_read_all(0, chunk, CHUNK_SIZE);
+        *checksum += chunk[0];
+    }
+    return NULL;
+}
+
+static double run_pingpong(void) {
+    pthread_t thread;
+    uint8_t msg[MSG_SIZE] = {0};
+
+    init_rings();
+    pthread_create(&thread, NULL, pong_thread, NULL);
+    double t0 = now_sec();
+    for (uint64_t i = 0; i < roundTrips; i++) {
+        msg[0] = (uint8_t)i;
+        ring_write_all(0, msg, MSG_SIZE);
+        ring_read_all(1, msg, MSG_SIZE);
+    }
+    double dt = now_sec() - t0;
+    pthread_join(thread, NULL);
+    return dt;
+}
+
+static double run_stream(void) {
+    pthread_t thread;
+    uint8_t chunk[CHUNK_SIZE];
+    uint64_t checksum = 0;
+
+    memset(chunk, 1, sizeof(chunk));
+    init_rings();
+    pthread_create(&thread, NULL, stream_reader, &checksum);
+    double t0 = now_sec();
+    for (uint64_t done = 0; done < streamBytes; done += CHUNK_SIZE) {
+        ring_write_all(0, chunk, CHUNK_SIZE);
+    }
+    pthread_join(thread, NULL);
+    double dt = now_sec() - t0;
+    if (checksum != streamBytes / CHUNK_SIZE) {
+        fprintf(stderr, "stream corrupted\n");
+        exit(1);
+    }
+    return dt;
+}
+
+int main(int argc, char **argv) {
+    roundTrips  = (argc > 1) ? strtoull(argv[1], NULL, 0) : 1000000;
+    streamBytes = (argc > 2) ? strtoull(argv[2], NULL, 0) : (1ULL << 30);
+    streamBytes -= streamBytes % CHUNK_SIZE;
+
+    printf("workload,variant,ops,seconds,ns_per_op,bytes_per_sec\n");
+    for (variant = VARIANT_CBUF; variant <= VARIANT_ALIGNED; variant++) {
+        double dt = run_pingpong();
+        printf("pingpong,%s,%llu,%.3f,%.1f,\n", variantNames[variant], (unsigned long long)roundTrips,
+               dt, dt * 1e9 / (double)roundTrips);
+        fflush(stdout);
+    }
+    for (variant = VARIANT_CBUF; variant <= VARIANT_ALIGNED; variant++) {
+        double dt = run_stream();
+        uint64_t ops = streamBytes / CHUNK_SIZE;
+        printf("stream,%s,%llu,%.3f,%.1f,%.0f\n", variantNames[variant], (unsigned long long)ops,
+               dt, dt * 1e9 / (double)ops, (double)streamBytes / dt);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+// Checks for the header-only cbuf::ring of src/cbuf.hpp. Ceedling only builds
+// C, so this runs from the bench Makefile: `make -C bench check`.
+// Covers push/pop across the wrap, move-only elements, the number of
+// destructor calls on pop(), clear() and destruction, and capacity rounding.
+//
+// Usage: check_ring.out
+// Output: one line per failed check on stderr, exit status 1 if any failed.
+
+#include <cstdio>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "cbuf.hpp"
+
+static int failures;
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                      \
+        }                                                                    \
+    } while (0)
+
+// Counts live instances, move-only
+struct tracked {
+    static int live;
+    int value;
+
+    explicit tracked(int v) : value(v) { live++; }
+    tracked(tracked &&other) noexcept : value(other.value) { live++; }
+    tracked &operator=(tracked &&other) noexcept {
+        value = other.value;
+        return *this;
+    }
+    tracked(tracked const &) = delete;
+    tracked &operator=(tracked const &) = delete;
+    ~tracked() { live--; }
+};
+
+int tracked::live = 0;
+
+// Pushes and pops many times the capacity, so the indices wrap repeatedly
+template <typename Ring>
+static void check_wraparound(Ring &r) {
+    int next = 0, expected = 0;
+    std::string out;
+
+    for (int round = 0; round < 100; round++) {
+        // Fill level changes every round, so the wrap hits different offsets
+        while (r.size() < r.capacity() - static_cast<std::size_t>(round % 3)) {
+            CHECK(r.try_push(std::to_string(next++)));
+        }
+        if (0 == round % 3) {
+            CHECK(r.full());
+            CHECK(!r.try_push(std::string("x")));
+        }
+        for (int i = 0; i < 3 + round % 2 && r.try_pop(out); i++) {
+            CHECK(std::to_string(expected++) == out);
+        }
+    }
+    while (r.try_pop(out)) {
+        CHECK(std::to_string(expected++) == out);
+    }
+    CHECK(next == expected);
+    CHECK(r.empty());
+    CHECK(nullptr == r.front());
+}
+
+static void check_fixed_wraparound() {
+    cbuf::ring<std::string, 8> r;
+    CHECK(8 == r.capacity());
+    check_wraparound(r);
+}
+
+static void check_dynamic_wraparound() {
+    cbuf::ring<std::string> r(5);
+    CHECK(8 == r.capacity());
+    check_wraparound(r);
+}
+
+static void check_move_only() {
+    cbuf::ring<std::unique_ptr<int>, 4> r;
+    std::unique_ptr<int> out;
+
+    for (int i = 0; i < 10; i++) {
+        CHECK(r.try_push(std::unique_ptr<int>(new int(i))));
+        CHECK(r.emplace(new int(100 + i)));
+        CHECK(r.try_pop(out));
+        CHECK(nullptr != out && i == *out);
+        CHECK(nullptr != r.front() && 100 + i == **r.front());
+        r.pop();
+    }
+    CHECK(r.empty());
+}
+
+static void check_destructors() {
+    {
+        cbuf::ring<tracked, 4> r;
+        for (int i = 0; i < 4; i++) {
+            CHECK(r.emplace(i));
+        }
+        CHECK(!r.emplace(4));
+        CHECK(4 == tracked::live);
+
+        r.pop();
+        CHECK(3 == tracked::live);
+
+        tracked out(-1);
+        CHECK(r.try_pop(out));
+        CHECK(1 == out.value);
+        CHECK(3 == tracked::live); // two in the ring plus out
+
+        r.clear();
+        CHECK(1 == tracked::live);
+        CHECK(r.empty());
+
+        // Leave elements behind across the wrap for the destructor
+        for (int i = 0; i < 3; i++) {
+            CHECK(r.emplace(10 + i));
+        }
+        CHECK(4 == tracked::live);
+    }
+    CHECK(0 == tracked::live);
+
+    {
+        cbuf::ring<tracked> r(3);
+        for (int i = 0; i < 4; i++) {
+            CHECK(r.emplace(i));
+        }
+        CHECK(4 == tracked::live);
+    }
+    CHECK(0 == tracked::live);
+}
+
+static void check_capacity() {
+    CHECK(2 == cbuf::ring<int>(0).capacity());
+    CHECK(2 == cbuf::ring<int>(2).capacity());
+    CHECK(4 == cbuf::ring<int>(3).capacity());
+    CHECK(1024 == cbuf::ring<int>(1024).capacity());
+    CHECK(2048 == cbuf::ring<int>(1025).capacity());
+
+    std::size_t const tooLarge[] = {
+        (std::numeric_limits<std::size_t>::max() >> 1) + 2,
+        std::numeric_limits<std::size_t>::max(),
+    };
+    for (std::size_t n : tooLarge) {
+        bool thrown = false;
+        try {
+            cbuf::ring<int> r(n);
+        }
+        catch (std::length_error const &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+int main() {
+    check_fixed_wraparound();
+    check_dynamic_wraparound();
+    check_move_only();
+    check_destructors();
+    check_capacity();
+
+    if (0 != failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("check_ring: OK\n");
+    return 0;
+}
@@ -1,7 +1,229 @@
 #include "cbuf.h"
+#include "cbuf_inline.h"
+#include "cbuf_internal.h"
 #include <string.h>
+#include <unistd.h>
 
-#define CBUF_MIN(x,y) ((x) < (y) ? (x) : (y))
+// Bulk copy kernels, see cbuf_copy_bytes(). The first call picks one for
+// the CPU and every later call goes straight to it. The NEON kernel has not
+// been run on hardware yet and is only built with CBUF_COPY_ENABLE_NEON,
+// AArch64 uses memcpy() otherwise.
+#if !defined(CBUF_COPY_NO_SIMD) && defined(__x86_64__)
+#include <immintrin.h>
+#define CBUF_COPY_X86 1
+#elif !defined(CBUF_COPY_NO_SIMD) && defined(__aarch64__) && defined(CBUF_COPY_ENABLE_NEON)
+#include <arm_neon.h>
+#define CBUF_COPY_NEON 1
+#endif
+
+// Copies of at least this many bytes use non-temporal stores. Set to the L2
+// cache size on first use: below it regular stores are faster, above it they
+// push the other side's working set out for data that is evicted anyway.
+#define CBUF_COPY_STREAM_MIN (1024u * 1024u) // if the L2 size is unknown
+
+static void cbuf_copy_resolve(void *dst, void const *src, uint64_t n);
+cbuf_copy_fn cbuf_copy_bulk = cbuf_copy_resolve;
+static uint64_t copyStreamMin = CBUF_COPY_STREAM_MIN;
+
+static inline bool cbuf_copy_stream(uint64_t n) {
+    return n >= __atomic_load_n(&copyStreamMin, __ATOMIC_RELAXED);
+}
+
+static void cbuf_copy_libc(void *dst, void const *src, uint64_t n) {
+    memcpy(dst, src, n);
+}
+
+#ifdef CBUF_COPY_X86
+// Non-temporal stores from the first 16 byte boundary of d on (SSE2 is part of x86-64).
+static void cbuf_copy_stream_sse2(uint8_t *d, uint8_t const *s, uint64_t n) {
+    uint64_t const head = (16 - ((uintptr_t)d & 15)) & 15;
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+    for (; n >= 64; n -= 64, d += 64, s += 64) {
+        __m128i const a = _mm_loadu_si128((__m128i const *)s);
+        __m128i const b = _mm_loadu_si128((__m128i const *)(s + 16));
+        __m128i const c = _mm_loadu_si128((__m128i const *)(s + 32));
+        __m128i const e = _mm_loadu_si128((__m128i const *)(s + 48));
+        _mm_stream_si128((__m128i *)d, a);
+        _mm_stream_si128((__m128i *)(d + 16), b);
+        _mm_stream_si128((__m128i *)(d + 32), c);
+        _mm_stream_si128((__m128i *)(d + 48), e);
+    }
+    _mm_sfence(); // streaming stores are weakly ordered, publish them before the index
+    memcpy(d, s, n);
+}
+
+// Without AVX2, or with AVX-512 which libc uses for its own wider loop, libc
+// copies whatever is not streamed.
+static void cbuf_copy_sse2(void *dst, void const *src, uint64_t n) {
+    if (cbuf_copy_stream(n)) {
+        cbuf_copy_stream_sse2(dst, src, n);
+    }
+    else {
+        memcpy(dst, src, n);
+    }
+}
+
+#define CBUF_COPY_AVX2 __attribute__((target("avx2")))
+
+CBUF_COPY_AVX2 static inline void cbuf_copy_32(uint8_t *d, uint8_t const *s) {
+    _mm256_storeu_si256((__m256i *)d, _mm256_loadu_si256((__m256i const *)s));
+}
+
+// Four 32 byte moves per step with d aligned, the last step overlaps the one
+// before. Only called with at least CBUF_COPY_BULK_MIN bytes.
+CBUF_COPY_AVX2 static void cbuf_copy_avx2(void *dst, void const *src, uint64_t n) {
+    uint8_t *d = dst;
+    uint8_t const *s = src;
+    uint8_t *const end = d + n;
+    uint8_t const *const srcEnd = s + n;
+    uint64_t const head = 32 - ((uintptr_t)d & 31);
+    cbuf_copy_32(d, s);
+    d += head;
+    s += head;
+    n -= head;
+    if (cbuf_copy_stream(n)) {
+        for (; n >= 128; n -= 128, d += 128, s += 128) {
+            __m256i const a = _mm256_loadu_si256((__m256i const *)s);
+            __m256i const b = _mm256_loadu_si256((__m256i const *)(s + 32));
+            __m256i const c = _mm256_loadu_si256((__m256i const *)(s + 64));
+            __m256i const e = _mm256_loadu_si256((__m256i const *)(s + 96));
+            _mm256_stream_si256((__m256i *)d, a);
+            _mm256_stream_si256((__m256i *)(d + 32), b);
+            _mm256_stream_si256((__m256i *)(d + 64), c);
+            _mm256_stream_si256((__m256i *)(d + 96), e);
+        }
+        _mm_sfence();
+    }
+    else {
+        for (; n > 128; n -= 128, d += 128, s += 128) {
+            __m256i const a = _mm256_loadu_si256((__m256i const *)s);
+            __m256i const b = _mm256_loadu_si256((__m256i const *)(s + 32));
+            __m256i const c = _mm256_loadu_si256((__m256i const *)(s + 64));
+            __m256i const e = _mm256_loadu_si256((__m256i const *)(s + 96));
+            _mm256_store_si256((__m256i *)d, a);
+            _mm256_store_si256((__m256i *)(d + 32), b);
+            _mm256_store_si256((__m256i *)(d + 64), c);
+            _mm256_store_si256((__m256i *)(d + 96), e);
+        }
+    }
+    // Last (up to) 128 bytes, ending exactly at the end
+    cbuf_copy_32(end - 128, srcEnd - 128);
+    cbuf_copy_32(end - 96, srcEnd - 96);
+    cbuf_copy_32(end - 64, srcEnd - 64);
+    cbuf_copy_32(end - 32, srcEnd - 32);
+}
+#endif // CBUF_COPY_X86
+
+#ifdef CBUF_COPY_NEON
+// NEON is part of AArch64, no run time check needed. Four 16 byte moves per
+// step, the last step overlaps the one before (at least CBUF_COPY_BULK_MIN
+// bytes). stnp only hints at streaming, it needs no barrier.
+static void cbuf_copy_neon(void *dst, void const *src, uint64_t n) {
+    uint8_t *d = dst;
+    uint8_t const *s = src;
+    uint8_t *const end = d + n;
+    uint8_t const *const srcEnd = s + n;
+    bool const stream = cbuf_copy_stream(n);
+
+    for (; n > 64; n -= 64, d += 64, s += 64) {
+        uint8x16_t const a = vld1q_u8(s);
+        uint8x16_t const b = vld1q_u8(s + 16);
+        uint8x16_t const c = vld1q_u8(s + 32);
+        uint8x16_t const e = vld1q_u8(s + 48);
+        if (stream) {
+            __asm__ volatile("stnp %q0, %q1, [%4]\n\t"
+                             "stnp %q2, %q3, [%4, #32]"
+                             :: "w"(a), "w"(b), "w"(c), "w"(e), "r"(d) : "memory");
+        }
+        else {
+            vst1q_u8(d, a);
+            vst1q_u8(d + 16, b);
+            vst1q_u8(d + 32, c);
+            vst1q_u8(d + 48, e);
+        }
+    }
+    vst1q_u8(end - 64, vld1q_u8(srcEnd - 64));
+    vst1q_u8(end - 48, vld1q_u8(srcEnd - 48));
+    vst1q_u8(end - 32, vld1q_u8(srcEnd - 32));
+    vst1q_u8(end - 16, vld1q_u8(srcEnd - 16));
+}
+#endif // CBUF_COPY_NEON
+
+static void cbuf_copy_resolve(void *dst, void const *src, uint64_t n) {
+    cbuf_copy_fn kernel = cbuf_copy_libc;
+#if defined(CBUF_COPY_X86)
+    bool const avx2 = __builtin_cpu_supports("avx2") && !__builtin_cpu_supports("avx512f");
+    kernel = avx2 ? cbuf_copy_avx2 : cbuf_copy_sse2;
+#elif defined(CBUF_COPY_NEON)
+    kernel = cbuf_copy_neon;
+#endif
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    long const l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 > 0) {
+        __atomic_store_n(&copyStreamMin, (uint64_t)l2, __ATOMIC_RELAXED);
+    }
+#endif
+    // Every thread gets to the same values, the order they are seen in does not matter
+    __atomic_store_n(&cbuf_copy_bulk, kernel, __ATOMIC_RELAXED);
+    kernel(dst, src, n);
+}
+
+// Every kernel compiled in that the CPU can run, so tests can call each one
+// through cbuf_copy_bulk instead of only the one cbuf_copy_resolve() picks.
+uint32_t cbuf_copy_kernels(cbuf_copy_fn *kernels, uint32_t max) {
+    cbuf_copy_fn all[3];
+    uint32_t count = 0;
+
+    all[count++] = cbuf_copy_libc;
+#if defined(CBUF_COPY_X86)
+    all[count++] = cbuf_copy_sse2;
+    if (__builtin_cpu_supports("avx2")) {
+        all[count++] = cbuf_copy_avx2;
+    }
+#elif defined(CBUF_COPY_NEON)
+    all[count++] = cbuf_copy_neon;
+#endif
+    count = CBUF_MIN(count, max);
+    memcpy(kernels, all, count * sizeof(all[0]));
+    return count;
+}
+
+// Copy data into the buffer starting at pos, wrapping around if needed.
+// Returns the position right after the last byte written.
+static uint64_t cbuf_copy_in(cbuf_t *cb, uint64_t pos, void const *data, uint64_t numOfBytes) {
+    uint64_t offset = cbuf_offset(cb, pos);
+    uint64_t bytesTillEnd = (cb->flags & CBUF_FLAG_MIRRORED) ? numOfBytes : CBUF_MIN(numOfBytes, cb->size - offset);
+    cbuf_copy_bytes(&cb->bufPtr[offset], data, bytesTillEnd);
+    if (bytesTillEnd < numOfBytes) { // Back to start of buffer
+        cbuf_copy_bytes(&cb->bufPtr[0], (uint8_t const *)data + bytesTillEnd, numOfBytes - bytesTillEnd);
+    }
+    return cbuf_advance(cb, pos, numOfBytes);
+}
+
+// Copy data out of the buffer starting at pos, wrapping around if needed.
+// Returns the position right after the last byte read.
+static uint64_t cbuf_copy_out(cbuf_t const *cb, uint64_t pos, void *buffer, uint64_t numOfBytes) {
+    uint64_t offset = cbuf_offset(cb, pos);
+    uint64_t bytesTillEnd = (cb->flags & CBUF_FLAG_MIRRORED) ? numOfBytes : CBUF_MIN(numOfBytes, cb->size - offset);
+    cbuf_copy_bytes(buffer, &cb->bufPtr[offset], bytesTillEnd);
+    if (bytesTillEnd < numOfBytes) { // Back to start of buffer
+        cbuf_copy_bytes((uint8_t *)buffer + bytesTillEnd, &cb->bufPtr[0], numOfBytes - bytesTillEnd);
+    }
+    return cbuf_advance(cb, pos, numOfBytes);
+}
+
+// Describe numOfBytes starting at pos as at most two spans of bufPtr.
+// The second span is empty unless the region wraps around the end of buffer.
+static void cbuf_spans(cbuf_t const *cb, uint64_t pos, uint64_t numOfBytes, uint8_t *ptr[2], uint64_t len[2]) {
+    uint64_t offset = cbuf_offset(cb, pos);
+    len[0] = (cb->flags & CBUF_FLAG_MIRRORED) ? numOfBytes : CBUF_MIN(numOfBytes, cb->size - offset);
+    len[1] = numOfBytes - len[0];
+    ptr[0] = len[0] ? &cb->bufPtr[offset] : NULL;
+    ptr[1] = len[1] ? &cb->bufPtr[0] : NULL;
+}
 
 // Initialize a cbuffer with a given buffer
 // Maximum storage size is (sizeInBytes - 1) because of the full/empty conditions
@@ -22,11 +244,35 @@ bool cbuf_init(cbuf_t *cb, void *buffer, uint64_t const sizeInBytes) {
     }
     cb->bufPtr   = (uint8_t *)buffer;
     cb->size     = sizeInBytes;
+    cb->mask     = 0;
+    cb->flags    = 0;
+    cb->waiters  = 0;
+    cb->stats    = NULL;
     cb->writePos = 0;
     cb->readPos  = 0;
     return true;
 }
 
+/** \brief Initialize a circular buffer whose size is a power of two.
+ * Indices are masked instead of wrapped with a modulo, and the full
+ * sizeInBytes can be used for storage.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] buffer: internal buffer to store data, must not be directly manipulated.
+ * \param[in] sizeInBytes: size of buffer in bytes, power of two and at least 2.
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_init_pow2(cbuf_t *cb, void *buffer, uint64_t const sizeInBytes) {
+    if (sizeInBytes < 2 || 0 != (sizeInBytes & (sizeInBytes - 1))) {
+        return false;
+    }
+    if (!cbuf_init(cb, buffer, sizeInBytes)) {
+        return false;
+    }
+    cb->mask = sizeInBytes - 1;
+    return true;
+}
+
 /** \brief Reset circular buffer.
  *
  * \param[in] cb: handle to cbuf_t.
@@ -48,8 +294,8 @@ bool cbuf_reset(cbuf_t *cb) {
  * \return `true` if buffer is full, `false` otherwise.
  *
  */
-inline bool cbuf_is_full(cbuf_t *cb) {
-    return (((cb->writePos + 1) % cb->size) == cb->readPos);
+bool cbuf_is_full(cbuf_t *cb) {
+    return cbuf_is_full_inline(cb);
 }
 
 /** \brief Check if buffer is empty.
@@ -58,19 +304,19 @@ inline bool cbuf_is_full(cbuf_t *cb) {
  * \return `true` if buffer is empty, `false` otherwise.
  *
  */
-inline bool cbuf_is_empty(cbuf_t *cb) {
-    return cb->writePos == cb->readPos;
+bool cbuf_is_empty(cbuf_t *cb) {
+    return cbuf_is_empty_inline(cb);
 }
 
 /** \brief Get number of free slots in buffer.
- * Max. free slots is always (size - 1)
+ * Max. free slots is (size - 1), or size for buffers set up with cbuf_init_pow2()
  * 
  * \param[in] cb: handle to cbuf_t.
  * \return number of free bytes in buffer.
  *
  */
 uint64_t cbuf_get_free(cbuf_t *cb) {
-    return cb->size - cbuf_get_filled(cb) - 1;
+    return cbuf_get_free_inline(cb);
 }
 
 /** \brief Get number of data bytes stored in buffer.
@@ -80,12 +326,7 @@ uint64_t cbuf_get_free(cbuf_t *cb) {
  *
  */
 uint64_t cbuf_get_filled(cbuf_t *cb) {
-    if (cb->writePos >= cb->readPos) {
-        return (cb->writePos - cb->readPos);
-    }
-    else {
-        return (cb->size - cb->readPos + cb->writePos);
-    }
+    return cbuf_get_filled_inline(cb);
 }
 
 /** \brief Write data to circular buffer.
@@ -97,29 +338,14 @@ uint64_t cbuf_get_filled(cbuf_t *cb) {
  * 
  */
 uint64_t cbuf_write(cbuf_t *cb, void const *data, uint64_t numOfBytes) {
-    uint64_t bytesToWrite = CBUF_MIN(numOfBytes, cbuf_get_free(cb));
+    uint64_t const freeBytes = cbuf_get_free(cb);
+    uint64_t bytesToWrite = CBUF_MIN(numOfBytes, freeBytes);
+    CBUF_STATS_ON_WRITE(cb, cb->writePos, numOfBytes, bytesToWrite, cbuf_capacity(cb) - freeBytes);
     if (0 == bytesToWrite) {
         return 0;
     }
-    if (cb->writePos >= cb->readPos) {
-        uint64_t bytesTillEnd = CBUF_MIN(bytesToWrite, cb->size - cb->writePos);
-        memcpy(&cb->bufPtr[cb->writePos], data, bytesTillEnd);
-        cb->writePos = (cb->writePos + bytesTillEnd) % cb->size;
-        bytesToWrite -= bytesTillEnd;
-        if (0 == bytesToWrite) {
-            return bytesTillEnd;
-        }
-        else { // Back to start of buffer
-            memcpy(&cb->bufPtr[0], (uint8_t *)data + bytesTillEnd, bytesToWrite);
-            cb->writePos += bytesToWrite;
-            return bytesToWrite + bytesTillEnd;
-        }
-    }
-    else {
-        memcpy(&cb->bufPtr[cb->writePos], data, bytesToWrite);
-        cb->writePos += bytesToWrite;
-        return bytesToWrite;
-    }
+    cb->writePos = cbuf_copy_in(cb, cb->writePos, data, bytesToWrite);
+    return bytesToWrite;
 }
 
 /** \brief Read data from circular buffer.
@@ -132,28 +358,12 @@ uint64_t cbuf_write(cbuf_t *cb, void const *data, uint64_t numOfBytes) {
  */
 uint64_t cbuf_read(cbuf_t *cb, void * const buffer, uint64_t numOfBytes) {
     uint64_t bytesToRead = CBUF_MIN(numOfBytes, cbuf_get_filled(cb));
+    CBUF_STATS_ON_READ(cb, cb->readPos, numOfBytes, bytesToRead);
     if (0 == bytesToRead) {
         return 0;
     }
-    if (cb->readPos > cb->writePos) {
-        uint64_t bytesTillEnd = CBUF_MIN(bytesToRead, cb->size - cb->readPos);
-        memcpy(buffer, &cb->bufPtr[cb->readPos], bytesTillEnd);
-        cb->readPos = (cb->readPos + bytesTillEnd) % cb->size;
-        bytesToRead -= bytesTillEnd;
-        if (0 == bytesToRead) {
-            return bytesTillEnd;
-        }
-        else { // Back to start of buffer
-            memcpy((uint8_t *)buffer + bytesTillEnd, &cb->bufPtr[0], bytesToRead);
-            cb->readPos += bytesToRead;
-            return bytesToRead + bytesTillEnd;
-        }
-    }
-    else { // The (readPos == writePos) condition won't happen because it's been checked with cbuf_get_filled()
-        memcpy(buffer, &cb->bufPtr[cb->readPos], bytesToRead);
-        cb->readPos += bytesToRead;
-        return bytesToRead;
-    }
+    cb->readPos = cbuf_copy_out(cb, cb->readPos, buffer, bytesToRead);
+    return bytesToRead;
 }
 
 /** \brief Read data from circular buffer without altering the buffer's content
@@ -170,57 +380,357 @@ uint64_t cbuf_peek(cbuf_t *cb, void * const buffer, uint64_t numOfBytes) {
     if (0 == bytesToRead) {
         return 0;
     }
-    uint64_t readPosTemp = cb->readPos;
-    if (readPosTemp > cb->writePos) {
-        uint64_t bytesTillEnd = CBUF_MIN(bytesToRead, cb->size - readPosTemp);
-        memcpy(buffer, &cb->bufPtr[readPosTemp], bytesTillEnd);
-        readPosTemp = (readPosTemp + bytesTillEnd) % cb->size;
-        bytesToRead -= bytesTillEnd;
-        if (0 == bytesToRead) {
-            return bytesTillEnd;
-        }
-        else { // Back to start of buffer
-            memcpy((uint8_t *)buffer + bytesTillEnd, &cb->bufPtr[0], bytesToRead);
-            readPosTemp += bytesToRead;
-            return bytesToRead + bytesTillEnd;
-        }
+    cbuf_copy_out(cb, cb->readPos, buffer, bytesToRead); // readPos is not updated
+    return bytesToRead;
+}
+
+/** \brief Read data from circular buffer at an offset from readPos, without consuming it.
+ * Only the requested bytes are copied.
+ * 
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] offset: number of stored bytes to pass over, counted from readPos.
+ * \param[out] buffer: pointer to buffer for storing data to be read.
+ * \param[in] numOfBytes: number of bytes to be read from circular buffer.
+ * \return number of bytes read, `0` if offset is not below cbuf_get_filled().
+ * 
+ */
+uint64_t cbuf_peek_at(cbuf_t *cb, uint64_t offset, void * const buffer, uint64_t numOfBytes) {
+    uint64_t const filled = cbuf_get_filled(cb);
+    if (offset >= filled) {
+        return 0;
     }
-    else { // The (readPosTemp == writePos) condition won't happen because it's been checked with cbuf_get_filled()
-        memcpy(buffer, &cb->bufPtr[readPosTemp], bytesToRead);
-        readPosTemp += bytesToRead;
-        return bytesToRead;
+    uint64_t bytesToRead = CBUF_MIN(numOfBytes, filled - offset);
+    if (0 == bytesToRead) {
+        return 0;
     }
+    cbuf_copy_out(cb, cbuf_advance(cb, cb->readPos, offset), buffer, bytesToRead);
+    return bytesToRead;
 }
 
-/** \brief Write one byte into circular buffer.
+/** \brief Get one stored byte at an offset from readPos, without consuming it.
+ * 
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] offset: number of stored bytes to pass over, counted from readPos.
+ * \return the byte (0 to 255), `-1` if offset is not below cbuf_get_filled().
+ * 
+ */
+int cbuf_byte_at(cbuf_t *cb, uint64_t offset) {
+    if (offset >= cbuf_get_filled(cb)) {
+        return -1;
+    }
+    return cb->bufPtr[cbuf_offset(cb, cbuf_advance(cb, cb->readPos, offset))];
+}
+
+/** \brief Discard data from circular buffer without copying it.
+ * readPos is moved in one step.
+ * 
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] numOfBytes: number of bytes to be discarded.
+ * \return number of bytes discarded, limited to the data stored in buffer.
+ * 
+ */
+uint64_t cbuf_skip(cbuf_t *cb, uint64_t numOfBytes) {
+    uint64_t bytesToSkip = CBUF_MIN(numOfBytes, cbuf_get_filled(cb));
+    CBUF_STATS_ON_READ(cb, cb->readPos, numOfBytes, bytesToSkip);
+    cb->readPos = cbuf_advance(cb, cb->readPos, bytesToSkip);
+    return bytesToSkip;
+}
+
+/** \brief Write data to circular buffer, dropping the oldest data if it does not fit.
+ * The whole write is always accepted: readPos is moved past the overwritten
+ * bytes in one step. If numOfBytes exceeds the capacity, only the most
+ * recent bytes of data are kept. Not for use with a concurrent consumer.
  * 
  * \param[in] cb: handle to cbuf_t.
+ * \param[in] data: pointer to data to be written into buffer.
+ * \param[in] numOfBytes: number of bytes to be written into buffer.
+ * \return number of bytes dropped, stored data plus leading bytes of data that did not fit.
+ * 
+ */
+uint64_t cbuf_write_overwrite(cbuf_t *cb, void const *data, uint64_t numOfBytes) {
+    uint64_t const capacity = cbuf_capacity(cb);
+    uint64_t dropped = 0;
+
+    if (numOfBytes > capacity) {
+        dropped    = numOfBytes - capacity;
+        data       = (uint8_t const *)data + dropped;
+        numOfBytes = capacity;
+    }
+    uint64_t freeBytes = cbuf_get_free(cb);
+    if (numOfBytes > freeBytes) {
+        cb->readPos = cbuf_advance(cb, cb->readPos, numOfBytes - freeBytes);
+        dropped += numOfBytes - freeBytes;
+        freeBytes = numOfBytes;
+    }
+    CBUF_STATS_ON_DROP(cb, dropped);
+    CBUF_STATS_ON_WRITE(cb, cb->writePos, numOfBytes, numOfBytes, capacity - freeBytes);
+    if (0 != numOfBytes) {
+        cb->writePos = cbuf_copy_in(cb, cb->writePos, data, numOfBytes);
+    }
+    return dropped;
+}
+
+/** \brief Write one byte into circular buffer.
+ * Loops can use cbuf_write_single_inline() from cbuf_inline.h instead.
+ *
+ * \param[in] cb: handle to cbuf_t.
  * \param[in] data: data to be written.
  * \return `1` if successful, `0` otherwise.
  * 
  */
 uint8_t cbuf_write_single(cbuf_t *cb, uint8_t data) {
-    if (cbuf_is_full(cb))
-        return 0;
-
-    cb->bufPtr[cb->writePos] = data;
-    cb->writePos = (cb->writePos + 1) % cb->size; // modulo is for wrap-around
-    return 1;
+    CBUF_STATS_ON_WRITE(cb, cb->writePos, 1, !cbuf_is_full_inline(cb), cbuf_get_filled_inline(cb));
+    return cbuf_write_single_inline(cb, data);
 }
 
 /** \brief Read one byte from circular buffer.
- * 
+ * Loops can use cbuf_read_single_inline() from cbuf_inline.h instead.
+ *
  * \param[in] cb: handle to cbuf_t.
  * \param[out] buffer: buffer to store data to be read.
  * \return `1` if successful, `0` otherwise.
  * 
  */
 uint8_t cbuf_read_single(cbuf_t *cb, uint8_t *buffer) {
-    if (cbuf_is_empty(cb)) {
+    CBUF_STATS_ON_READ(cb, cb->readPos, 1, !cbuf_is_empty_inline(cb));
+    return cbuf_read_single_inline(cb, buffer);
+}
+
+/** \brief Write data to circular buffer, lock-free single-producer variant.
+ * May run concurrently with cbuf_read_spsc() on another thread, as long as
+ * there is only one producer and one consumer and neither side mixes in
+ * the non-`_spsc` functions.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] data: pointer to data to be written into buffer.
+ * \param[in] numbOfBytes: number of bytes to be written into buffer.
+ * \return number of bytes written into buffer.
+ *
+ */
+uint64_t cbuf_write_spsc(cbuf_t *cb, void const *data, uint64_t numOfBytes) {
+    uint64_t const writePos = CBUF_LOAD_RELAXED(&cb->writePos); // Owned by producer
+    uint64_t const readPos  = CBUF_LOAD_ACQUIRE(&cb->readPos);
+    uint64_t const filled   = cbuf_filled_between(cb, writePos, readPos);
+    uint64_t bytesToWrite = CBUF_MIN(numOfBytes, cbuf_capacity(cb) - filled);
+    CBUF_STATS_ON_WRITE(cb, writePos, numOfBytes, bytesToWrite, filled);
+    if (0 == bytesToWrite) {
+        return 0;
+    }
+    // Data must be in place before the consumer can observe the new writePos
+    CBUF_STORE_RELEASE(&cb->writePos, cbuf_copy_in(cb, writePos, data, bytesToWrite));
+    return bytesToWrite;
+}
+
+/** \brief Read data from circular buffer, lock-free single-consumer variant.
+ * May run concurrently with cbuf_write_spsc() on another thread.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] data: pointer to buffer for storing data to be read
+ * \param[in] numbOfBytes: number of bytes to be read from circular buffer.
+ * \return number of bytes read from buffer.
+ *
+ */
+uint64_t cbuf_read_spsc(cbuf_t *cb, void * const buffer, uint64_t numOfBytes) {
+    uint64_t const readPos  = CBUF_LOAD_RELAXED(&cb->readPos); // Owned by consumer
+    uint64_t const writePos = CBUF_LOAD_ACQUIRE(&cb->writePos);
+    uint64_t bytesToRead = CBUF_MIN(numOfBytes, cbuf_filled_between(cb, writePos, readPos));
+    CBUF_STATS_ON_READ(cb, readPos, numOfBytes, bytesToRead);
+    if (0 == bytesToRead) {
         return 0;
     }
+    // Data must be copied out before the producer can observe the new readPos
+    CBUF_STORE_RELEASE(&cb->readPos, cbuf_copy_out(cb, readPos, buffer, bytesToRead));
+    return bytesToRead;
+}
+
+/** \brief Reserve free space for writing in place (zero-copy).
+ * Data is stored directly into the returned spans, then made visible to
+ * the consumer with cbuf_write_commit(). The second span is only used when
+ * the free region wraps around the end of buffer.
+ * Can be paired with the `_spsc` functions on the consumer side.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] numOfBytes: number of bytes to reserve.
+ * \param[out] ptr: start of the (up to) two free spans, `NULL` if a span is empty.
+ * \param[out] len: length in bytes of each span.
+ * \return number of bytes reserved (len[0] + len[1]).
+ *
+ */
+uint64_t cbuf_write_reserve(cbuf_t *cb, uint64_t numOfBytes, uint8_t *ptr[2], uint64_t len[2]) {
+    uint64_t const writePos = CBUF_LOAD_RELAXED(&cb->writePos); // Owned by producer
+    uint64_t const readPos  = CBUF_LOAD_ACQUIRE(&cb->readPos);
+    uint64_t bytesToWrite = CBUF_MIN(numOfBytes, cbuf_capacity(cb) - cbuf_filled_between(cb, writePos, readPos));
+    cbuf_spans(cb, writePos, bytesToWrite, ptr, len);
+    return bytesToWrite;
+}
+
+/** \brief Commit bytes written into space obtained with cbuf_write_reserve().
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] numOfBytes: number of bytes written, starting at the first reserved span.
+ * \return number of bytes committed, limited to the free space in buffer.
+ *
+ */
+uint64_t cbuf_write_commit(cbuf_t *cb, uint64_t numOfBytes) {
+    uint64_t const writePos = CBUF_LOAD_RELAXED(&cb->writePos);
+    uint64_t const readPos  = CBUF_LOAD_ACQUIRE(&cb->readPos);
+    uint64_t const filled   = cbuf_filled_between(cb, writePos, readPos);
+    uint64_t bytesToCommit = CBUF_MIN(numOfBytes, cbuf_capacity(cb) - filled);
+    CBUF_STATS_ON_WRITE(cb, writePos, numOfBytes, bytesToCommit, filled);
+    CBUF_STORE_RELEASE(&cb->writePos, cbuf_advance(cb, writePos, bytesToCommit));
+    return bytesToCommit;
+}
+
+/** \brief Get the stored data for reading in place (zero-copy).
+ * The returned spans stay valid until they are handed back with
+ * cbuf_read_release(). The second span is only used when the stored data
+ * wraps around the end of buffer.
+ * Can be paired with the `_spsc` functions on the producer side.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] ptr: start of the (up to) two filled spans, `NULL` if a span is empty.
+ * \param[out] len: length in bytes of each span.
+ * \return number of bytes available (len[0] + len[1]).
+ *
+ */
+uint64_t cbuf_read_acquire(cbuf_t *cb, uint8_t const *ptr[2], uint64_t len[2]) {
+    uint64_t const readPos  = CBUF_LOAD_RELAXED(&cb->readPos); // Owned by consumer
+    uint64_t const writePos = CBUF_LOAD_ACQUIRE(&cb->writePos);
+    uint64_t bytesToRead = cbuf_filled_between(cb, writePos, readPos);
+    cbuf_spans(cb, readPos, bytesToRead, (uint8_t **)ptr, len);
+    return bytesToRead;
+}
+
+/** \brief Release bytes obtained with cbuf_read_acquire(), freeing their space.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] numOfBytes: number of bytes consumed, starting at the first span.
+ * \return number of bytes released, limited to the data stored in buffer.
+ *
+ */
+uint64_t cbuf_read_release(cbuf_t *cb, uint64_t numOfBytes) {
+    uint64_t const readPos  = CBUF_LOAD_RELAXED(&cb->readPos);
+    uint64_t const writePos = CBUF_LOAD_ACQUIRE(&cb->writePos);
+    uint64_t bytesToRelease = CBUF_MIN(numOfBytes, cbuf_filled_between(cb, writePos, readPos));
+    CBUF_STATS_ON_READ(cb, readPos, numOfBytes, bytesToRelease);
+    CBUF_STORE_RELEASE(&cb->readPos, cbuf_advance(cb, readPos, bytesToRelease));
+    return bytesToRelease;
+}
+
+/** \brief Read data up to and including a delimiter byte.
+ * The delimiter is searched with memchr() over the (up to) two filled spans,
+ * and the data is copied out in one go.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] delim: delimiter byte, e.g. '\n'.
+ * \param[out] buffer: buffer for storing data to be read, including the delimiter.
+ * \param[in] maxBytes: size of buffer in bytes.
+ * \return number of bytes read, `0` if no delimiter is found within the first
+ * maxBytes bytes (nothing is consumed then).
+ *
+ * If cbuf_get_filled() >= maxBytes after a `0` return, the record is longer than buffer.
+ */
+uint64_t cbuf_read_until(cbuf_t *cb, uint8_t delim, void * const buffer, uint64_t maxBytes) {
+    uint8_t const *ptr[2];
+    uint64_t len[2];
+    uint64_t searched = 0;
+
+    cbuf_read_acquire(cb, ptr, len);
+    for (int i = 0; i < 2 && searched < maxBytes; i++) {
+        uint64_t n = CBUF_MIN(len[i], maxBytes - searched);
+        uint8_t const *hit = n ? memchr(ptr[i], delim, n) : NULL;
+        if (NULL != hit) {
+            uint64_t bytesToRead = searched + (uint64_t)(hit - ptr[i]) + 1;
+            uint64_t bytesFirst = CBUF_MIN(bytesToRead, len[0]);
+            cbuf_copy_bytes(buffer, ptr[0], bytesFirst);
+            if (bytesFirst < bytesToRead) { // Back to start of buffer
+                cbuf_copy_bytes((uint8_t *)buffer + bytesFirst, ptr[1], bytesToRead - bytesFirst);
+            }
+            return cbuf_read_release(cb, bytesToRead);
+        }
+        searched += n;
+    }
+    return 0;
+}
+
+/** \brief Hand the stored data to a callback in contiguous spans, without copying.
+ * The callback is called for the first span and, if it consumed all of it,
+ * for the second span when the data wraps around the end of buffer.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] callback: returns how many bytes of the span it consumed.
+ * \param[in] ctx: passed to callback unchanged.
+ * \return total number of bytes consumed, readPos is advanced by that amount.
+ */
+uint64_t cbuf_scan(cbuf_t *cb, cbuf_scan_fn callback, void *ctx) {
+    uint8_t const *ptr[2];
+    uint64_t len[2];
+    uint64_t consumed = 0;
+
+    cbuf_read_acquire(cb, ptr, len);
+    for (int i = 0; i < 2 && 0 != len[i]; i++) {
+        uint64_t n = callback(ctx, ptr[i], len[i]);
+        n = CBUF_MIN(n, len[i]);
+        consumed += n;
+        if (n < len[i]) {
+            break;
+        }
+    }
+    return cbuf_read_release(cb, consumed);
+}
+
+/** \brief Hand over storage for the instrumentation counters.
+ * The counters are cleared and kept from then on. Attach before the buffer
+ * is used concurrently; cbuf_init() detaches them again.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] stats: storage for the counters, must outlive its use by cb.
+ *            `NULL` detaches the current storage.
+ * \return `true` if instrumentation is compiled in, `false` otherwise
+ *         (nothing is attached then).
+ */
+bool cbuf_stats_attach(cbuf_t *cb, cbuf_stats_t *stats) {
+    if (NULL == cb) {
+        return false;
+    }
+#ifdef CBUF_ENABLE_STATS
+    if (NULL != stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+    cb->stats = stats;
+    return true;
+#else
+    (void)stats;
+    return false;
+#endif
+}
 
-    *buffer = cb->bufPtr[cb->readPos];
-    cb->readPos = (cb->readPos + 1) % cb->size; // modulo is for wrap-around
-    return 1;
+/** \brief Take a snapshot of the instrumentation counters.
+ * Safe to call while a producer and a consumer are active, each counter is
+ * read atomically (the snapshot as a whole is not).
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] stats: counters, all zero if not built with CBUF_ENABLE_STATS
+ *             or if no storage is attached.
+ * \return `true` if counters were copied, `false` otherwise.
+ */
+bool cbuf_get_stats(cbuf_t *cb, cbuf_stats_t *stats) {
+    if (NULL == stats) {
+        return false;
+    }
+    memset(stats, 0, sizeof(*stats));
+#ifdef CBUF_ENABLE_STATS
+    if (NULL == cb || NULL == cb->stats) {
+        return false;
+    }
+    uint64_t const *src = (uint64_t const *)cb->stats;
+    uint64_t *dst = (uint64_t *)stats;
+    for (uint64_t i = 0; i < sizeof(*stats) / sizeof(uint64_t); i++) {
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+    return true;
+#else
+    (void)cb;
+    return false;
+#endif
 }
@@ -4,16 +4,49 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define CBUF_STATS_BUCKETS 16
+
+// Counters kept when built with CBUF_ENABLE_STATS, in storage the caller
+// hands over with cbuf_stats_attach(), see cbuf_get_stats().
+// Write side fields are updated by the producer, read side fields by the consumer.
+// Only the byte API of cbuf.c counts; the header versions of cbuf_inline.h,
+// cbuf_msg records, the shm/file/spsc/bcast variants and the zero-copy
+// commits of other modules are not seen.
+typedef struct cbuf_stats {
+  uint64_t bytesIn;
+  uint64_t bytesOut;
+  uint64_t bytesDropped;  // overwritten by cbuf_write_overwrite()
+  uint64_t partialWrites; // fewer bytes written than requested
+  uint64_t partialReads;  // fewer bytes read than requested
+  uint64_t fullHits;      // writes that found no free space
+  uint64_t emptyHits;     // reads that found no data
+  uint64_t writeWraps;    // writes split at the end of buffer
+  uint64_t readWraps;     // reads split at the end of buffer
+  uint64_t highWatermark; // most bytes stored after a write
+  uint64_t occupancy[CBUF_STATS_BUCKETS]; // writes by fill level afterwards, in 1/CBUF_STATS_BUCKETS of capacity
+} cbuf_stats_t;
+
 typedef struct cbuf {
   uint8_t *bufPtr;
   uint64_t writePos;
   uint64_t readPos;
   uint64_t size;
+  uint64_t mask;     // (size - 1) if set up with cbuf_init_pow2(), 0 otherwise
+  uint32_t flags;    // CBUF_FLAG_*
+  uint32_t waiters;  // CBUF_WAITER_* of threads sleeping in cbuf_read_wait()/cbuf_write_wait()
+  cbuf_stats_t *stats; // NULL unless cbuf_stats_attach(), so the layout does not depend on CBUF_ENABLE_STATS
 } cbuf_t;
 
-//extern cbuf_t * cb_init_dynamic(cbuf_t *cb, uint16_t const max_number_elements);
+#define CBUF_FLAG_MIRRORED  (1u << 0) // bufPtr[size .. 2 * size) aliases bufPtr[0 .. size)
+#define CBUF_FLAG_ALLOCATED (1u << 1) // set up by cbuf_create(), release with cbuf_destroy()
+
+#define CBUF_CACHE_LINE 64 // Padding unit of the concurrent variants
+
+// Consumer for cbuf_scan(), returns the number of bytes of data it consumed
+typedef uint64_t (*cbuf_scan_fn)(void *ctx, uint8_t const *data, uint64_t len);
 
 bool     cbuf_init(cbuf_t *cb, void *buffer, uint64_t const sizeInBytes);
+bool     cbuf_init_pow2(cbuf_t *cb, void *buffer, uint64_t const sizeInBytes);
 bool     cbuf_reset(cbuf_t *cb);
 bool     cbuf_is_full(cbuf_t *cb);
 bool     cbuf_is_empty(cbuf_t *cb);
@@ -22,7 +55,27 @@ uint64_t cbuf_get_filled(cbuf_t *cb);
 uint64_t cbuf_write(cbuf_t *cb, void const *data, uint64_t numOfBytes);
 uint64_t cbuf_read(cbuf_t *cb, void * const buffer, uint64_t numOfBytes);
 uint64_t cbuf_peek(cbuf_t *cb, void * const buffer, uint64_t numOfBytes);
+uint64_t cbuf_peek_at(cbuf_t *cb, uint64_t offset, void * const buffer, uint64_t numOfBytes);
+int      cbuf_byte_at(cbuf_t *cb, uint64_t offset);
+uint64_t cbuf_skip(cbuf_t *cb, uint64_t numOfBytes);
+uint64_t cbuf_write_overwrite(cbuf_t *cb, void const *data, uint64_t numOfBytes);
 uint8_t  cbuf_write_single(cbuf_t *cb, uint8_t data);
 uint8_t  cbuf_read_single(cbuf_t *cb, uint8_t *buffer);
+bool     cbuf_stats_attach(cbuf_t *cb, cbuf_stats_t *stats);
+bool     cbuf_get_stats(cbuf_t *cb, cbuf_stats_t *stats);
+
+// Lock-free single-producer/single-consumer entry points
+uint64_t cbuf_write_spsc(cbuf_t *cb, void const *data, uint64_t numOfBytes);
+uint64_t cbuf_read_spsc(cbuf_t *cb, void * const buffer, uint64_t numOfBytes);
+
+// Zero-copy access, each call describes up to two spans of the buffer
+uint64_t cbuf_write_reserve(cbuf_t *cb, uint64_t numOfBytes, uint8_t *ptr[2], uint64_t len[2]);
+uint64_t cbuf_write_commit(cbuf_t *cb, uint64_t numOfBytes);
+uint64_t cbuf_read_acquire(cbuf_t *cb, uint8_t const *ptr[2], uint64_t len[2]);
+uint64_t cbuf_read_release(cbuf_t *cb, uint64_t numOfBytes);
+
+// Batched consumers, one call per record or per contiguous span instead of per byte
+uint64_t cbuf_read_until(cbuf_t *cb, uint8_t delim, void * const buffer, uint64_t maxBytes);
+uint64_t cbuf_scan(cbuf_t *cb, cbuf_scan_fn callback, void *ctx);
 
 #endif // CBUF_H
@@ -0,0 +1,177 @@
+#ifndef CBUF_HPP
+#define CBUF_HPP
+
+// Header-only typed rings for C++11 and later.
+// cbuf::ring<T, N> keeps N elements in place (N a power of two, so the wrap
+// mask is a compile-time constant), cbuf::ring<T> (dynamic_extent) takes
+// its capacity at construction and allocates once. Indices follow the
+// cbuf_init_pow2() scheme of cbuf.c: free-running, masked on access, the
+// whole storage usable. One producer and one consumer thread may use a ring
+// concurrently, each publishing its index with release semantics like
+// cbuf_write_spsc()/cbuf_read_spsc().
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace cbuf {
+
+static constexpr std::size_t dynamic_extent = 0;
+static constexpr std::size_t cache_line = 64;
+
+namespace detail {
+
+constexpr bool is_pow2(std::size_t n) {
+    return n >= 2 && 0 == (n & (n - 1));
+}
+
+// In-place storage for N elements
+template <typename T, std::size_t N>
+class storage {
+    static_assert(is_pow2(N), "cbuf::ring capacity must be a power of two (>= 2)");
+
+public:
+    static constexpr std::size_t capacity() noexcept { return N; }
+    static constexpr std::size_t mask() noexcept { return N - 1; }
+    T *slot(std::uint64_t pos) noexcept {
+        return reinterpret_cast<T *>(&data_[(pos & (N - 1)) * sizeof(T)]);
+    }
+
+private:
+    alignas(T) unsigned char data_[N * sizeof(T)];
+};
+
+// Heap storage, allocated once, capacity rounded up to a power of two
+template <typename T>
+class storage<T, dynamic_extent> {
+public:
+    explicit storage(std::size_t capacity)
+        : capacity_(round_up(capacity)), data_(std::allocator<T>().allocate(capacity_)) {}
+    ~storage() { std::allocator<T>().deallocate(data_, capacity_); }
+    storage(storage const &) = delete;
+    storage &operator=(storage const &) = delete;
+
+    std::size_t capacity() const noexcept { return capacity_; }
+    std::size_t mask() const noexcept { return capacity_ - 1; }
+    T *slot(std::uint64_t pos) noexcept { return data_ + (pos & (capacity_ - 1)); }
+
+private:
+    // Next power of two >= n (at least 2), throws if that does not fit in size_t
+    static std::size_t round_up(std::size_t n) {
+        if (n > (std::numeric_limits<std::size_t>::max() >> 1) + 1) {
+            throw std::length_error("cbuf::ring capacity too large");
+        }
+        if (n <= 2) {
+            return 2;
+        }
+        --n;
+        for (unsigned shift = 1; shift < std::numeric_limits<std::size_t>::digits; shift <<= 1) {
+            n |= n >> shift;
+        }
+        return n + 1;
+    }
+
+    std::size_t capacity_;
+    T *data_;
+};
+
+} // namespace detail
+
+template <typename T, std::size_t N = dynamic_extent>
+class ring {
+public:
+    using value_type = T;
+    using size_type  = std::size_t;
+
+    ring() = default;
+    // Runtime-sized rings only, capacity is rounded up to a power of two,
+    // std::length_error if it cannot be
+    explicit ring(size_type capacity) : storage_(capacity) {}
+    ring(ring const &) = delete;
+    ring &operator=(ring const &) = delete;
+
+    ~ring() {
+        clear();
+    }
+
+    size_type capacity() const noexcept { return storage_.capacity(); }
+
+    size_type size() const noexcept {
+        std::uint64_t const readPos = readPos_.load(std::memory_order_acquire);
+        return static_cast<size_type>(writePos_.load(std::memory_order_acquire) - readPos);
+    }
+
+    bool empty() const noexcept { return 0 == size(); }
+    bool full() const noexcept { return capacity() == size(); }
+
+    // Producer side: construct an element in place, false if the ring is full
+    template <typename... Args>
+    bool emplace(Args &&...args) noexcept(std::is_nothrow_constructible<T, Args &&...>::value) {
+        std::uint64_t const writePos = writePos_.load(std::memory_order_relaxed);
+        if (writePos - readPos_.load(std::memory_order_acquire) == capacity()) {
+            return false;
+        }
+        ::new (static_cast<void *>(storage_.slot(writePos))) T(std::forward<Args>(args)...);
+        // Element must be constructed before the consumer can observe the new writePos
+        writePos_.store(writePos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(T const &value) noexcept(std::is_nothrow_copy_constructible<T>::value) {
+        return emplace(value);
+    }
+
+    bool try_push(T &&value) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        return emplace(std::move(value));
+    }
+
+    // Consumer side: move the oldest element into out, false if the ring is empty
+    bool try_pop(T &out) noexcept(std::is_nothrow_move_assignable<T>::value) {
+        T *elem = front();
+        if (nullptr == elem) {
+            return false;
+        }
+        out = std::move(*elem);
+        pop();
+        return true;
+    }
+
+    // Consumer side: oldest element for use in place, nullptr if the ring is empty
+    T *front() noexcept {
+        std::uint64_t const readPos = readPos_.load(std::memory_order_relaxed);
+        if (writePos_.load(std::memory_order_acquire) == readPos) {
+            return nullptr;
+        }
+        return storage_.slot(readPos);
+    }
+
+    // Consumer side: destroy the element returned by front()
+    void pop() noexcept {
+        std::uint64_t const readPos = readPos_.load(std::memory_order_relaxed);
+        storage_.slot(readPos)->~T();
+        // Slot must be released before the producer can observe the new readPos
+        readPos_.store(readPos + 1, std::memory_order_release);
+    }
+
+    // Destroy all stored elements, not concurrently with the producer
+    void clear() noexcept {
+        while (nullptr != front()) {
+            pop();
+        }
+    }
+
+private:
+    detail::storage<T, N> storage_;
+    alignas(cache_line) std::atomic<std::uint64_t> writePos_{0}; // Owned by producer
+    alignas(cache_line) std::atomic<std::uint64_t> readPos_{0};  // Owned by consumer
+};
+
+} // namespace cbuf
+
+#endif // CBUF_HPP
@@ -0,0 +1,199 @@
+#define _GNU_SOURCE // MAP_HUGETLB
+#include "cbuf_alloc.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#define CBUF_THP_SIZE  (2u * 1024 * 1024)
+#define CBUF_MAX_NODES 1024
+
+// cbuf_t handed out by cbuf_create(), followed by what is needed to free it
+typedef struct cbuf_alloc {
+  cbuf_t   cb;       // Must be first, cbuf_destroy() gets a pointer to it
+  uint64_t mapSize;  // 0 if bufPtr comes from malloc()
+  uint32_t createFlags;
+} cbuf_alloc_t;
+
+// Default hugepage size from /proc/meminfo, 2 MiB if unknown.
+static uint64_t cbuf_hugepage_size(void) {
+    uint64_t sizeKb = 0;
+    char line[128];
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (NULL != f) {
+        while (NULL != fgets(line, sizeof(line), f)) {
+            unsigned long long kb;
+            if (1 == sscanf(line, "Hugepagesize: %llu kB", &kb)) {
+                sizeKb = kb;
+                break;
+            }
+        }
+        fclose(f);
+    }
+    return (0 != sizeKb) ? sizeKb * 1024 : CBUF_THP_SIZE;
+}
+
+static uint64_t cbuf_round_up(uint64_t value, uint64_t granularity) {
+    return (value + granularity - 1) / granularity * granularity;
+}
+
+// Allocate the data area according to flags, sets *mapSize (0 for malloc()).
+static uint8_t *cbuf_alloc_buffer(uint64_t sizeInBytes, uint32_t flags, uint64_t *mapSize) {
+    uint8_t *base;
+
+    *mapSize = 0;
+    if (0 == (flags & (CBUF_CREATE_HUGETLB | CBUF_CREATE_THP | CBUF_CREATE_NUMA_BIND))) {
+        return malloc((size_t)sizeInBytes);
+    }
+
+    if (flags & CBUF_CREATE_HUGETLB) {
+        *mapSize = cbuf_round_up(sizeInBytes, cbuf_hugepage_size());
+        base = mmap(NULL, (size_t)*mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (MAP_FAILED == base) {
+            return NULL;
+        }
+    }
+    else if (flags & CBUF_CREATE_THP) {
+        // Over-allocate, then trim to a 2 MiB aligned range so whole hugepages can back it
+        *mapSize = cbuf_round_up(sizeInBytes, CBUF_THP_SIZE);
+        uint8_t *raw = mmap(NULL, (size_t)(*mapSize + CBUF_THP_SIZE), PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == raw) {
+            return NULL;
+        }
+        base = (uint8_t *)cbuf_round_up((uintptr_t)raw, CBUF_THP_SIZE);
+        if (base != raw) {
+            munmap(raw, (size_t)(base - raw));
+        }
+        if (base + *mapSize != raw + *mapSize + CBUF_THP_SIZE) {
+            munmap(base + *mapSize, (size_t)(raw + CBUF_THP_SIZE - base));
+        }
+        madvise(base, (size_t)*mapSize, MADV_HUGEPAGE); // Advisory, THP may be disabled
+    }
+    else {
+        *mapSize = cbuf_round_up(sizeInBytes, (uint64_t)sysconf(_SC_PAGESIZE));
+        base = mmap(NULL, (size_t)*mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == base) {
+            return NULL;
+        }
+    }
+
+    if (flags & CBUF_CREATE_NUMA_BIND) {
+        // Bound before first touch, pages are then faulted in on that node.
+        // The kernel only looks at maxnode - 1 bits, hence the + 1.
+        unsigned long node = flags >> 16;
+        unsigned long nodeMask[CBUF_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+        nodeMask[node / (8 * sizeof(unsigned long))] = 1ul << (node % (8 * sizeof(unsigned long)));
+        if (0 != syscall(SYS_mbind, base, (unsigned long)*mapSize, MPOL_BIND, nodeMask,
+                         (unsigned long)(8 * sizeof(nodeMask) + 1), MPOL_MF_STRICT)) {
+            munmap(base, (size_t)*mapSize);
+            return NULL;
+        }
+    }
+    return base;
+}
+
+static void cbuf_free_buffer(uint8_t *buffer, uint64_t mapSize) {
+    if (0 == mapSize) {
+        free(buffer);
+    }
+    else {
+        munmap(buffer, (size_t)mapSize);
+    }
+}
+
+// Set up cb over buffer, the index scheme depends on the size.
+static void cbuf_alloc_init(cbuf_t *cb, uint8_t *buffer, uint64_t sizeInBytes) {
+    if (0 == (sizeInBytes & (sizeInBytes - 1))) {
+        cbuf_init_pow2(cb, buffer, sizeInBytes);
+    }
+    else {
+        cbuf_init(cb, buffer, sizeInBytes);
+    }
+    cb->flags |= CBUF_FLAG_ALLOCATED;
+}
+
+/** \brief Allocate and initialize a circular buffer.
+ * 
+ * \param[in] sizeInBytes: size of buffer in bytes (>= 2).
+ * \param[in] flags: CBUF_CREATE_* options, 0 for a plain heap allocation.
+ * \return handle to the new cbuf_t, `NULL` on failure (including hugepages
+ *         or NUMA binding being unavailable when requested).
+ *
+ * Must be released with cbuf_destroy().
+ */
+cbuf_t *cbuf_create(uint64_t const sizeInBytes, uint32_t const flags) {
+    if (sizeInBytes < 2 || sizeInBytes > (uint64_t)SIZE_MAX - CBUF_THP_SIZE
+        || (flags >> 16) >= CBUF_MAX_NODES) {
+        return NULL;
+    }
+    cbuf_alloc_t *a = malloc(sizeof(*a));
+    if (NULL == a) {
+        return NULL;
+    }
+    uint8_t *buffer = cbuf_alloc_buffer(sizeInBytes, flags, &a->mapSize);
+    if (NULL == buffer) {
+        free(a);
+        return NULL;
+    }
+    a->createFlags = flags;
+    cbuf_alloc_init(&a->cb, buffer, sizeInBytes);
+    return &a->cb;
+}
+
+/** \brief Release a circular buffer allocated with cbuf_create().
+ * 
+ * \param[in] cb: handle to cbuf_t.
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_destroy(cbuf_t *cb) {
+    if (NULL == cb || !(cb->flags & CBUF_FLAG_ALLOCATED)) {
+        return false;
+    }
+    cbuf_alloc_t *a = (cbuf_alloc_t *)cb;
+    cbuf_free_buffer(cb->bufPtr, a->mapSize);
+    free(a);
+    return true;
+}
+
+/** \brief Resize a circular buffer allocated with cbuf_create().
+ * The stored data is moved to the start of the new buffer with a single
+ * pass over it, the allocation options of cbuf_create() and the counters
+ * attached with cbuf_stats_attach() are kept.
+ * Not for use while another thread accesses the buffer.
+ * 
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] newSizeInBytes: new size of buffer in bytes, large enough for the stored data.
+ * \return `true` if successful, `false` otherwise (buffer is left unchanged).
+ */
+bool cbuf_grow(cbuf_t *cb, uint64_t const newSizeInBytes) {
+    if (NULL == cb || !(cb->flags & CBUF_FLAG_ALLOCATED) || newSizeInBytes < 2
+        || newSizeInBytes > (uint64_t)SIZE_MAX - CBUF_THP_SIZE) {
+        return false;
+    }
+    cbuf_alloc_t *a = (cbuf_alloc_t *)cb;
+    uint64_t filled = cbuf_get_filled(cb);
+    bool pow2 = (0 == (newSizeInBytes & (newSizeInBytes - 1)));
+    if (filled > (pow2 ? newSizeInBytes : newSizeInBytes - 1)) {
+        return false;
+    }
+
+    uint64_t mapSize;
+    uint8_t *buffer = cbuf_alloc_buffer(newSizeInBytes, a->createFlags, &mapSize);
+    if (NULL == buffer) {
+        return false;
+    }
+    cbuf_peek(cb, buffer, filled);
+    cbuf_free_buffer(cb->bufPtr, a->mapSize);
+
+    cbuf_stats_t *const stats = cb->stats;
+    a->mapSize = mapSize;
+    cbuf_alloc_init(cb, buffer, newSizeInBytes);
+    cb->writePos = filled;
+    cb->stats = stats;
+    return true;
+}
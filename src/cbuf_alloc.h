@@ -0,0 +1,18 @@
+#ifndef CBUF_ALLOC_H
+#define CBUF_ALLOC_H
+
+#include "cbuf.h"
+
+// Options for cbuf_create()
+#define CBUF_CREATE_HUGETLB     (1u << 0) // MAP_HUGETLB, needs reserved hugepages (vm.nr_hugepages)
+#define CBUF_CREATE_THP         (1u << 1) // 2 MiB aligned, madvise(MADV_HUGEPAGE)
+#define CBUF_CREATE_NUMA_BIND   (1u << 2) // mbind() to the node in bits 16..31 (< 1024)
+#define CBUF_CREATE_NUMA(node)  (CBUF_CREATE_NUMA_BIND | ((uint32_t)(node) << 16))
+
+// Heap or mmap() backed circular buffers owned by the library (Linux).
+// A power-of-two size selects the masked index scheme of cbuf_init_pow2().
+cbuf_t  *cbuf_create(uint64_t const sizeInBytes, uint32_t const flags);
+bool     cbuf_destroy(cbuf_t *cb);
+bool     cbuf_grow(cbuf_t *cb, uint64_t const newSizeInBytes);
+
+#endif // CBUF_ALLOC_H
@@ -0,0 +1,225 @@
+#include "cbuf_bcast.h"
+#include "cbuf_internal.h"
+#include <stddef.h>
+#include <string.h>
+
+_Static_assert(offsetof(cbuf_bcast_t, writePos) == CBUF_CACHE_LINE, "writer fields on their own line");
+_Static_assert(sizeof(cbuf_bcast_cursor_t) == CBUF_CACHE_LINE, "one cursor per line");
+
+// Attaching pairs a seq_cst fence on both sides (reader: publish ACTIVE,
+// then load writePos; writer: publish writePos, then scan the cursors).
+// Either the writer sees the new reader, or the reader starts at a
+// writePos the writer has not yet lapped.
+
+// Position of the slowest active reader, w if there is none.
+static uint64_t cbuf_bcast_min_pos(cbuf_bcast_t *b, uint64_t w) {
+    uint64_t minPos = w;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < CBUF_BCAST_MAX_READERS; i++) {
+        cbuf_bcast_cursor_t *r = &b->readers[i];
+        if (CBUF_BCAST_ACTIVE == CBUF_LOAD_ACQUIRE(&r->state)) {
+            uint64_t pos = CBUF_LOAD_ACQUIRE(&r->pos);
+            if (w - pos > w - minPos) {
+                minPos = pos;
+            }
+        }
+    }
+    return minPos;
+}
+
+// Free bytes for the writer at w, given the slowest reader at minPos.
+static uint64_t cbuf_bcast_free_from(cbuf_bcast_t const *b, uint64_t w, uint64_t minPos) {
+    uint64_t lag = w - minPos;
+    return (lag < b->size) ? (b->size - lag) : 0; // a reader being attached may look further behind
+}
+
+static bool cbuf_bcast_valid_id(cbuf_bcast_t const *b, int id) {
+    return NULL != b && id >= 0 && id < CBUF_BCAST_MAX_READERS
+        && CBUF_BCAST_ACTIVE == CBUF_LOAD_RELAXED(&b->readers[id].state);
+}
+
+/** \brief Initialize a broadcast circular buffer with a given buffer.
+ *
+ * \param[in] b: handle to cbuf_bcast_t.
+ * \param[in] buffer: internal buffer to store data, must not be directly manipulated.
+ * \param[in] sizeInBytes: size of buffer in bytes, a power of two (>= 2).
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_bcast_init(cbuf_bcast_t *b, void *buffer, uint64_t const sizeInBytes) {
+    if (NULL == b || NULL == buffer || sizeInBytes < 2 || 0 != (sizeInBytes & (sizeInBytes - 1))) {
+        return false;
+    }
+    b->bufPtr = (uint8_t *)buffer;
+    b->size   = sizeInBytes;
+    b->mask   = sizeInBytes - 1;
+    b->cachedMinPos = 0;
+    for (int i = 0; i < CBUF_BCAST_MAX_READERS; i++) {
+        b->readers[i].pos = 0;
+        CBUF_STORE_RELEASE(&b->readers[i].state, CBUF_BCAST_FREE);
+    }
+    CBUF_STORE_RELEASE(&b->writePos, 0);
+    return true;
+}
+
+/** \brief Write data to broadcast circular buffer (single writer).
+ * Without attached readers data is accepted and dropped.
+ *
+ * \param[in] b: handle to cbuf_bcast_t.
+ * \param[in] data: pointer to data to be written into buffer.
+ * \param[in] numOfBytes: number of bytes to be written into buffer.
+ * \return number of bytes written, limited by the slowest reader.
+ */
+uint64_t cbuf_bcast_write(cbuf_bcast_t *b, void const *data, uint64_t numOfBytes) {
+    uint64_t const w = CBUF_LOAD_RELAXED(&b->writePos);
+    uint64_t freeBytes = cbuf_bcast_free_from(b, w, b->cachedMinPos);
+    if (freeBytes < numOfBytes) {
+        // Only scan the readers' lines when the cached view looks full
+        b->cachedMinPos = cbuf_bcast_min_pos(b, w);
+        freeBytes = cbuf_bcast_free_from(b, w, b->cachedMinPos);
+    }
+    uint64_t bytesToWrite = CBUF_MIN(numOfBytes, freeBytes);
+    if (0 == bytesToWrite) {
+        return 0;
+    }
+    uint64_t offset = w & b->mask;
+    uint64_t bytesTillEnd = CBUF_MIN(bytesToWrite, b->size - offset);
+    memcpy(&b->bufPtr[offset], data, bytesTillEnd);
+    memcpy(b->bufPtr, (uint8_t const *)data + bytesTillEnd, bytesToWrite - bytesTillEnd);
+    CBUF_STORE_RELEASE(&b->writePos, w + bytesToWrite);
+    return bytesToWrite;
+}
+
+/** \brief Get number of bytes the writer can store right now.
+ *
+ * \param[in] b: handle to cbuf_bcast_t.
+ * \return number of free bytes, bounded by the slowest reader.
+ */
+uint64_t cbuf_bcast_get_free(cbuf_bcast_t *b) {
+    uint64_t const w = CBUF_LOAD_RELAXED(&b->writePos);
+    return cbuf_bcast_free_from(b, w, cbuf_bcast_min_pos(b, w));
+}
+
+/** \brief Register a reader. It sees all data written from now on, and holds
+ * back the writer until it has read it or detaches.
+ * May be called from any thread, also while the writer is active.
+ *
+ * \param[in] b: handle to cbuf_bcast_t.
+ * \return reader id, `-1` if all CBUF_BCAST_MAX_READERS cursors are in use.
+ */
+int cbuf_bcast_attach(cbuf_bcast_t *b) {
+    if (NULL == b) {
+        return -1;
+    }
+    for (int i = 0; i < CBUF_BCAST_MAX_READERS; i++) {
+        cbuf_bcast_cursor_t *r = &b->readers[i];
+        uint32_t expected = CBUF_BCAST_FREE;
+        if (!__atomic_compare_exchange_n(&r->state, &expected, CBUF_BCAST_CLAIMED, false,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            continue;
+        }
+        CBUF_STORE_RELEASE(&r->pos, CBUF_LOAD_ACQUIRE(&b->writePos));
+        __atomic_store_n(&r->state, CBUF_BCAST_ACTIVE, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        // The writer may have moved on without seeing us, start where it is now
+        CBUF_STORE_RELEASE(&r->pos, CBUF_LOAD_ACQUIRE(&b->writePos));
+        return i;
+    }
+    return -1;
+}
+
+/** \brief Unregister a reader, the writer no longer waits for it.
+ *
+ * \param[in] b: handle to cbuf_bcast_t.
+ * \param[in] id: reader id from cbuf_bcast_attach().
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_bcast_detach(cbuf_bcast_t *b, int id) {
+    if (!cbuf_bcast_valid_id(b, id)) {
+        return false;
+    }
+    CBUF_STORE_RELEASE(&b->readers[id].state, CBUF_BCAST_FREE);
+    return true;
+}
+
+/** \brief Describe the data not yet read by a reader (zero-copy).
+ * Nothing is consumed, use cbuf_bcast_read_release() once the data is processed.
+ *
+ * \param[in] b: handle to cbuf_bcast_t.
+ * \param[in] id: reader id from cbuf_bcast_attach().
+ * \param[out] ptr: start of the (up to) two spans, `NULL` if a span is empty.
+ * \param[out] len: length in bytes of each span.
+ * \return number of bytes available (len[0] + len[1]).
+ */
+uint64_t cbuf_bcast_read_acquire(cbuf_bcast_t *b, int id, uint8_t const *ptr[2], uint64_t len[2]) {
+    ptr[0] = ptr[1] = NULL;
+    len[0] = len[1] = 0;
+    if (!cbuf_bcast_valid_id(b, id)) {
+        return 0;
+    }
+    uint64_t const pos = CBUF_LOAD_RELAXED(&b->readers[id].pos);
+    uint64_t filled = CBUF_LOAD_ACQUIRE(&b->writePos) - pos;
+    if (0 == filled) {
+        return 0;
+    }
+    uint64_t offset = pos & b->mask;
+    len[0] = CBUF_MIN(filled, b->size - offset);
+    len[1] = filled - len[0];
+    ptr[0] = &b->bufPtr[offset];
+    ptr[1] = (0 != len[1]) ? b->bufPtr : NULL;
+    return filled;
+}
+
+/** \brief Mark data described by cbuf_bcast_read_acquire() as read.
+ *
+ * \param[in] b: handle to cbuf_bcast_t.
+ * \param[in] id: reader id from cbuf_bcast_attach().
+ * \param[in] numOfBytes: number of bytes processed.
+ * \return number of bytes released, limited to the data available.
+ */
+uint64_t cbuf_bcast_read_release(cbuf_bcast_t *b, int id, uint64_t numOfBytes) {
+    if (!cbuf_bcast_valid_id(b, id)) {
+        return 0;
+    }
+    uint64_t const pos = CBUF_LOAD_RELAXED(&b->readers[id].pos);
+    uint64_t bytes = CBUF_MIN(numOfBytes, CBUF_LOAD_ACQUIRE(&b->writePos) - pos);
+    // Data must be processed before the writer can observe the new position
+    CBUF_STORE_RELEASE(&b->readers[id].pos, pos + bytes);
+    return bytes;
+}
+
+/** \brief Read data from broadcast circular buffer through one reader's cursor.
+ *
+ * \param[in] b: handle to cbuf_bcast_t.
+ * \param[in] id: reader id from cbuf_bcast_attach().
+ * \param[out] buffer: pointer to buffer for storing data to be read.
+ * \param[in] numOfBytes: number of bytes to be read.
+ * \return number of bytes read.
+ */
+uint64_t cbuf_bcast_read(cbuf_bcast_t *b, int id, void * const buffer, uint64_t numOfBytes) {
+    uint8_t const *ptr[2];
+    uint64_t len[2];
+    uint64_t bytesToRead = CBUF_MIN(numOfBytes, cbuf_bcast_read_acquire(b, id, ptr, len));
+    if (0 == bytesToRead) {
+        return 0;
+    }
+    uint64_t first = CBUF_MIN(bytesToRead, len[0]);
+    memcpy(buffer, ptr[0], first);
+    if (bytesToRead > first) {
+        memcpy((uint8_t *)buffer + first, ptr[1], bytesToRead - first);
+    }
+    return cbuf_bcast_read_release(b, id, bytesToRead);
+}
+
+/** \brief Get number of bytes not yet read by a reader.
+ *
+ * \param[in] b: handle to cbuf_bcast_t.
+ * \param[in] id: reader id from cbuf_bcast_attach().
+ * \return number of bytes available to that reader.
+ */
+uint64_t cbuf_bcast_get_filled(cbuf_bcast_t *b, int id) {
+    if (!cbuf_bcast_valid_id(b, id)) {
+        return 0;
+    }
+    uint64_t const pos = CBUF_LOAD_RELAXED(&b->readers[id].pos);
+    return CBUF_LOAD_ACQUIRE(&b->writePos) - pos;
+}
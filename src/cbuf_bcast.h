@@ -0,0 +1,50 @@
+#ifndef CBUF_BCAST_H
+#define CBUF_BCAST_H
+
+#include "cbuf.h"
+
+#ifndef CBUF_BCAST_MAX_READERS
+#define CBUF_BCAST_MAX_READERS 8
+#endif
+
+#define CBUF_BCAST_FREE     0u // cursor unused
+#define CBUF_BCAST_CLAIMED  1u // cursor taken, reader not registered yet
+#define CBUF_BCAST_ACTIVE   2u // writer waits for this reader
+
+// Read position of one reader, on its own cache line
+typedef struct cbuf_bcast_cursor {
+  uint64_t pos;
+  uint32_t state;      // CBUF_BCAST_*
+  uint8_t  pad[CBUF_CACHE_LINE - 12];
+} cbuf_bcast_cursor_t;
+
+// Single-writer, multi-reader ring: every attached reader sees every byte
+// written after it attached, through its own cursor. The writer's free
+// space is bounded by the slowest active reader. Size is a power of two,
+// positions run freely and are masked (cbuf_init_pow2() scheme).
+typedef struct cbuf_bcast {
+  // Read-only after cbuf_bcast_init()
+  uint8_t *bufPtr;
+  uint64_t size;
+  uint64_t mask;
+  uint8_t  pad0[CBUF_CACHE_LINE - 24];
+  // Writer line
+  uint64_t writePos;
+  uint64_t cachedMinPos; // slowest reader as last seen by the writer
+  uint8_t  pad1[CBUF_CACHE_LINE - 16];
+  cbuf_bcast_cursor_t readers[CBUF_BCAST_MAX_READERS];
+} __attribute__((aligned(CBUF_CACHE_LINE))) cbuf_bcast_t;
+
+bool     cbuf_bcast_init(cbuf_bcast_t *b, void *buffer, uint64_t const sizeInBytes);
+uint64_t cbuf_bcast_write(cbuf_bcast_t *b, void const *data, uint64_t numOfBytes);
+uint64_t cbuf_bcast_get_free(cbuf_bcast_t *b);
+
+// Reader side, id is returned by cbuf_bcast_attach()
+int      cbuf_bcast_attach(cbuf_bcast_t *b);
+bool     cbuf_bcast_detach(cbuf_bcast_t *b, int id);
+uint64_t cbuf_bcast_read(cbuf_bcast_t *b, int id, void * const buffer, uint64_t numOfBytes);
+uint64_t cbuf_bcast_read_acquire(cbuf_bcast_t *b, int id, uint8_t const *ptr[2], uint64_t len[2]);
+uint64_t cbuf_bcast_read_release(cbuf_bcast_t *b, int id, uint64_t numOfBytes);
+uint64_t cbuf_bcast_get_filled(cbuf_bcast_t *b, int id);
+
+#endif // CBUF_BCAST_H
@@ -0,0 +1,291 @@
+#include "cbuf_crc.h"
+#include "cbuf_internal.h"
+#include <pthread.h>
+#include <string.h>
+
+// Hardware CRC32C, selected at run time. Define CBUF_CRC_NO_HW to always use
+// the table driven version.
+#if !defined(CBUF_CRC_NO_HW) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define CBUF_CRC_HW 1
+#define CBUF_CRC_HW_TARGET      __attribute__((target("sse4.2")))
+#define CBUF_CRC_HW_U64(crc, w) ((uint32_t)_mm_crc32_u64((crc), (w)))
+#define CBUF_CRC_HW_U8(crc, b)  _mm_crc32_u8((crc), (b))
+#elif !defined(CBUF_CRC_NO_HW) && defined(__aarch64__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#define CBUF_CRC_HW 1
+#define CBUF_CRC_HW_TARGET      __attribute__((target("+crc")))
+#define CBUF_CRC_HW_U64(crc, w) __crc32cd((crc), (w))
+#define CBUF_CRC_HW_U8(crc, b)  __crc32cb((crc), (b))
+#endif
+
+#define CBUF_CRC32C_POLY 0x82f63b78u // bit-reflected Castagnoli polynomial
+
+// Lane lengths of the three-way interleaved kernel. The crc32 instruction has
+// a latency of about three cycles but issues every cycle, three independent
+// streams keep it busy. The lanes are joined with precomputed shift tables.
+#define CBUF_CRC_LONG  8192
+#define CBUF_CRC_SHORT 256
+#define CBUF_CRC_COPY_BLOCK (4 * CBUF_CRC_LONG) // fused copy granularity
+
+// All kernels work on the raw (not inverted) CRC state and copy to dst unless it is `NULL`
+typedef uint32_t (*cbuf_crc_copy_fn)(uint32_t crc, uint8_t *dst, uint8_t const *src, uint64_t len);
+
+static uint32_t crcTable[8][256];   // slicing-by-8
+static uint32_t crcLong[4][256];    // appends CBUF_CRC_LONG zero bytes to a CRC state
+static uint32_t crcShort[4][256];   // appends CBUF_CRC_SHORT zero bytes to a CRC state
+static cbuf_crc_copy_fn crcCopy;
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+
+// Table driven kernel, eight bytes per step.
+static uint32_t cbuf_crc_copy_sw(uint32_t crc, uint8_t *dst, uint8_t const *src, uint64_t len) {
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24);
+        uint32_t hi = (uint32_t)src[4] | (uint32_t)src[5] << 8 | (uint32_t)src[6] << 16 | (uint32_t)src[7] << 24;
+        crc = crcTable[7][lo & 0xff] ^ crcTable[6][(lo >> 8) & 0xff] ^ crcTable[5][(lo >> 16) & 0xff] ^ crcTable[4][lo >> 24] ^
+              crcTable[3][hi & 0xff] ^ crcTable[2][(hi >> 8) & 0xff] ^ crcTable[1][(hi >> 16) & 0xff] ^ crcTable[0][hi >> 24];
+        if (NULL != dst) {
+            memcpy(dst, src, 8);
+            dst += 8;
+        }
+        src += 8;
+        len -= 8;
+    }
+    while (len--) {
+        if (NULL != dst) {
+            *dst++ = *src;
+        }
+        crc = crcTable[0][(crc ^ *src++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+// CRC state after appending the zero bytes the table was built for.
+static inline uint32_t cbuf_crc_shift(uint32_t const table[4][256], uint32_t crc) {
+    return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^ table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+}
+
+#ifdef CBUF_CRC_HW
+// Three lanes of lane bytes each, joined into crc.
+CBUF_CRC_HW_TARGET __attribute__((always_inline))
+static inline uint32_t cbuf_crc_hw_3way(uint32_t crc, uint8_t const *src, uint64_t lane, uint32_t const shift[4][256]) {
+    uint32_t crc1 = 0, crc2 = 0;
+
+    for (uint64_t i = 0; i < lane; i += 8) {
+        uint64_t w0, w1, w2;
+        memcpy(&w0, &src[i], 8);
+        memcpy(&w1, &src[lane + i], 8);
+        memcpy(&w2, &src[2 * lane + i], 8);
+        crc  = CBUF_CRC_HW_U64(crc, w0);
+        crc1 = CBUF_CRC_HW_U64(crc1, w1);
+        crc2 = CBUF_CRC_HW_U64(crc2, w2);
+    }
+    crc = cbuf_crc_shift(shift, crc) ^ crc1;
+    return cbuf_crc_shift(shift, crc) ^ crc2;
+}
+
+// Hardware checksum: align the source, three-way lanes while long enough,
+// then a single stream.
+CBUF_CRC_HW_TARGET
+static uint32_t cbuf_crc_hw(uint32_t crc, uint8_t const *src, uint64_t len) {
+    while (0 != len && 0 != ((uintptr_t)src & 7)) {
+        crc = CBUF_CRC_HW_U8(crc, *src++);
+        len--;
+    }
+    while (len >= 3 * CBUF_CRC_LONG) {
+        crc = cbuf_crc_hw_3way(crc, src, CBUF_CRC_LONG, crcLong);
+        src += 3 * CBUF_CRC_LONG;
+        len -= 3 * CBUF_CRC_LONG;
+    }
+    while (len >= 3 * CBUF_CRC_SHORT) {
+        crc = cbuf_crc_hw_3way(crc, src, CBUF_CRC_SHORT, crcShort);
+        src += 3 * CBUF_CRC_SHORT;
+        len -= 3 * CBUF_CRC_SHORT;
+    }
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, src, 8);
+        crc = CBUF_CRC_HW_U64(crc, w);
+        src += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = CBUF_CRC_HW_U8(crc, *src++);
+    }
+    return crc;
+}
+
+// Hardware kernel. The copy follows the checksum in L1 sized blocks: data is
+// read from memory once, and memcpy() keeps its wide stores.
+static uint32_t cbuf_crc_copy_hw(uint32_t crc, uint8_t *dst, uint8_t const *src, uint64_t len) {
+    if (NULL == dst) {
+        return cbuf_crc_hw(crc, src, len);
+    }
+    while (0 != len) {
+        uint64_t n = CBUF_MIN(len, CBUF_CRC_COPY_BLOCK);
+        crc = cbuf_crc_hw(crc, src, n);
+        memcpy(dst, src, n);
+        dst += n;
+        src += n;
+        len -= n;
+    }
+    return crc;
+}
+
+static bool cbuf_crc_hw_supported(void) {
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return 0 != (getauxval(AT_HWCAP) & HWCAP_CRC32);
+#endif
+}
+#endif // CBUF_CRC_HW
+
+// Multiply a 32x32 matrix over GF(2) (one column per bit) with a vector.
+static uint32_t cbuf_gf2_times(uint32_t const mat[32], uint32_t vec) {
+    uint32_t sum = 0;
+    for (int n = 0; 0 != vec; n++, vec >>= 1) {
+        if (vec & 1) {
+            sum ^= mat[n];
+        }
+    }
+    return sum;
+}
+
+// Byte-wise lookup tables for appending len zero bytes (a power of two) to a CRC state.
+static void cbuf_crc_shift_table(uint32_t table[4][256], uint64_t len) {
+    uint32_t op[32], square[32];
+
+    // One zero bit, then square up to 8 * len bits
+    op[0] = CBUF_CRC32C_POLY;
+    for (int n = 1; n < 32; n++) {
+        op[n] = 1u << (n - 1);
+    }
+    for (uint64_t bits = 1; bits < 8 * len; bits <<= 1) {
+        for (int n = 0; n < 32; n++) {
+            square[n] = cbuf_gf2_times(op, op[n]);
+        }
+        memcpy(op, square, sizeof(op));
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        for (int k = 0; k < 4; k++) {
+            table[k][n] = cbuf_gf2_times(op, n << (8 * k));
+        }
+    }
+}
+
+static void cbuf_crc_init(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CBUF_CRC32C_POLY : crc >> 1;
+        }
+        crcTable[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        for (int k = 1; k < 8; k++) {
+            crcTable[k][n] = (crcTable[k - 1][n] >> 8) ^ crcTable[0][crcTable[k - 1][n] & 0xff];
+        }
+    }
+    cbuf_crc_shift_table(crcLong, CBUF_CRC_LONG);
+    cbuf_crc_shift_table(crcShort, CBUF_CRC_SHORT);
+
+    crcCopy = cbuf_crc_copy_sw;
+#ifdef CBUF_CRC_HW
+    if (cbuf_crc_hw_supported()) {
+        crcCopy = cbuf_crc_copy_hw;
+    }
+#endif
+}
+
+// Checksum (and copy to dst unless `NULL`) stored data starting offset bytes
+// after readPos, taking the wrap split into account.
+static uint64_t cbuf_crc_stored(cbuf_t *cb, uint64_t offset, uint8_t *dst, uint64_t numOfBytes, uint32_t *crc) {
+    uint8_t const *ptr[2];
+    uint64_t len[2];
+
+    uint64_t const filled = cbuf_read_acquire(cb, ptr, len);
+    if (offset >= filled) {
+        return 0;
+    }
+    uint64_t const bytesToRead = CBUF_MIN(numOfBytes, filled - offset);
+    uint64_t done = 0;
+    uint32_t state = ~*crc;
+
+    pthread_once(&crcOnce, cbuf_crc_init);
+    for (int i = 0; i < 2 && done < bytesToRead; i++) {
+        if (offset >= len[i]) {
+            offset -= len[i];
+            continue;
+        }
+        uint64_t n = CBUF_MIN(len[i] - offset, bytesToRead - done);
+        state = crcCopy(state, dst ? dst + done : NULL, ptr[i] + offset, n);
+        offset = 0;
+        done += n;
+    }
+    *crc = ~state;
+    return bytesToRead;
+}
+
+/** \brief Compute CRC32C over a memory block.
+ *
+ * \param[in] crc: CRC of the preceding data, CBUF_CRC32C_INIT to start.
+ * \param[in] data: pointer to data.
+ * \param[in] numOfBytes: number of bytes in data.
+ * \return CRC of the preceding data followed by data.
+ */
+uint32_t cbuf_crc32c(uint32_t crc, void const *data, uint64_t numOfBytes) {
+    pthread_once(&crcOnce, cbuf_crc_init);
+    return ~crcCopy(~crc, NULL, (uint8_t const *)data, numOfBytes);
+}
+
+/** \brief Read data from circular buffer, computing its CRC32C during the copy.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] buffer: pointer to buffer for storing data to be read.
+ * \param[in] numOfBytes: number of bytes to be read from circular buffer.
+ * \param[in,out] crc: CRC of the preceding data (CBUF_CRC32C_INIT to start),
+ *                updated with the bytes read.
+ * \return number of bytes read from buffer.
+ *
+ */
+uint64_t cbuf_read_crc32c(cbuf_t *cb, void * const buffer, uint64_t numOfBytes, uint32_t *crc) {
+    uint64_t bytesRead = cbuf_crc_stored(cb, 0, (uint8_t *)buffer, numOfBytes, crc);
+    cbuf_read_release(cb, bytesRead);
+    return bytesRead;
+}
+
+/** \brief Read data from circular buffer without consuming it, computing its
+ * CRC32C during the copy.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] buffer: pointer to buffer for storing data to be read.
+ * \param[in] numOfBytes: number of bytes to be read from circular buffer.
+ * \param[in,out] crc: CRC of the preceding data (CBUF_CRC32C_INIT to start),
+ *                updated with the bytes read.
+ * \return number of bytes read from buffer.
+ *
+ */
+uint64_t cbuf_peek_crc32c(cbuf_t *cb, void * const buffer, uint64_t numOfBytes, uint32_t *crc) {
+    return cbuf_crc_stored(cb, 0, (uint8_t *)buffer, numOfBytes, crc);
+}
+
+/** \brief Compute CRC32C over stored data in place, nothing is copied or consumed.
+ * Successive calls with increasing offsets checksum the whole content piece
+ * by piece, e.g. to verify a persisted ring without stalling its users.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] offset: number of stored bytes to pass over, counted from readPos.
+ * \param[in] numOfBytes: number of bytes to checksum.
+ * \param[in,out] crc: CRC of the preceding data (CBUF_CRC32C_INIT to start),
+ *                updated with the bytes covered.
+ * \return number of bytes covered, `0` if offset is not below cbuf_get_filled().
+ *
+ */
+uint64_t cbuf_crc32c_at(cbuf_t *cb, uint64_t offset, uint64_t numOfBytes, uint32_t *crc) {
+    return cbuf_crc_stored(cb, offset, NULL, numOfBytes, crc);
+}
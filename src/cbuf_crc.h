@@ -0,0 +1,20 @@
+#ifndef CBUF_CRC_H
+#define CBUF_CRC_H
+
+#include "cbuf.h"
+
+// CRC32C (Castagnoli) computed while data is copied out of the ring, so a
+// frame is checksummed without a second pass. The implementation is picked
+// once at run time: SSE4.2 or ARMv8 CRC instructions, table driven otherwise.
+//
+// CRCs are incremental: start with CBUF_CRC32C_INIT and feed the result of
+// one call into the next, the value equals the CRC of all data so far.
+
+#define CBUF_CRC32C_INIT 0u
+
+uint32_t cbuf_crc32c(uint32_t crc, void const *data, uint64_t numOfBytes);
+uint64_t cbuf_read_crc32c(cbuf_t *cb, void * const buffer, uint64_t numOfBytes, uint32_t *crc);
+uint64_t cbuf_peek_crc32c(cbuf_t *cb, void * const buffer, uint64_t numOfBytes, uint32_t *crc);
+uint64_t cbuf_crc32c_at(cbuf_t *cb, uint64_t offset, uint64_t numOfBytes, uint32_t *crc);
+
+#endif // CBUF_CRC_H
@@ -0,0 +1,214 @@
+#include "cbuf_file.h"
+#include "cbuf_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+_Static_assert(sizeof(cbuf_file_header_t) <= CBUF_FILE_HEADER_SIZE, "cbuf_file_header_t too large");
+
+static uint64_t cbuf_file_check(cbuf_file_header_t const *h) {
+    return h->magic ^ h->size ^ h->writePos ^ h->readPos;
+}
+
+// msync() the bytes [start, start + len) of the mapping, page aligned.
+static bool cbuf_file_msync(cbuf_file_t const *f, uint64_t start, uint64_t len) {
+    uint64_t const pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t first = start & ~(pageSize - 1);
+    if (0 == len) {
+        return true;
+    }
+    return 0 == msync((uint8_t *)f->header + first, (size_t)(start + len - first), MS_SYNC);
+}
+
+// Write back data between syncedWritePos and writePos, at most two ranges.
+static bool cbuf_file_sync_data(cbuf_file_t *f) {
+    cbuf_t const *cb = &f->cb;
+    uint64_t dirty = cb->writePos - f->syncedWritePos;
+    if (dirty >= cb->size) {
+        return cbuf_file_msync(f, CBUF_FILE_HEADER_SIZE, cb->size);
+    }
+    uint64_t offset = f->syncedWritePos & cb->mask;
+    uint64_t tillEnd = (dirty < cb->size - offset) ? dirty : (cb->size - offset);
+    return cbuf_file_msync(f, CBUF_FILE_HEADER_SIZE + offset, tillEnd)
+        && cbuf_file_msync(f, CBUF_FILE_HEADER_SIZE, dirty - tillEnd);
+}
+
+// Validate a persisted header against the file size.
+static bool cbuf_file_header_valid(cbuf_file_header_t const *h, uint64_t fileSize) {
+    return CBUF_FILE_MAGIC == h->magic && CBUF_FILE_VERSION == h->version
+        && CBUF_FILE_HEADER_SIZE == h->headerSize && h->size >= 2 && 0 == (h->size & (h->size - 1))
+        && fileSize >= CBUF_FILE_HEADER_SIZE && h->size == fileSize - CBUF_FILE_HEADER_SIZE;
+}
+
+// Map the file behind fd and set up its header (created) or check it.
+static bool cbuf_file_map(cbuf_file_t *f, int fd, bool created, uint64_t sizeInBytes) {
+    struct stat st;
+    if (0 != fstat(fd, &st) || (uint64_t)st.st_size < CBUF_FILE_HEADER_SIZE + 2) {
+        return false;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == base) {
+        return false;
+    }
+    f->header  = (cbuf_file_header_t *)base;
+    f->mapSize = (uint64_t)st.st_size;
+    f->fd      = fd;
+
+    cbuf_file_header_t *h = f->header;
+    if (created) {
+        h->version    = CBUF_FILE_VERSION;
+        h->headerSize = CBUF_FILE_HEADER_SIZE;
+        h->size       = sizeInBytes;
+        h->writePos   = 0;
+        h->readPos    = 0;
+        h->magic      = CBUF_FILE_MAGIC;
+        h->check      = cbuf_file_check(h);
+        if (!cbuf_file_msync(f, 0, CBUF_FILE_HEADER_SIZE)) {
+            munmap(base, (size_t)f->mapSize);
+            return false;
+        }
+    }
+    else if (!cbuf_file_header_valid(h, f->mapSize) || (0 != sizeInBytes && sizeInBytes != h->size)) {
+        munmap(base, (size_t)f->mapSize);
+        return false;
+    }
+    else if (cbuf_file_check(h) != h->check || h->writePos - h->readPos > h->size) {
+        // Torn or corrupted indices, nothing stored can be trusted
+        h->writePos = h->readPos = 0;
+        h->check = cbuf_file_check(h);
+    }
+
+    cbuf_init_pow2(&f->cb, (uint8_t *)base + CBUF_FILE_HEADER_SIZE, h->size);
+    f->cb.writePos    = h->writePos;
+    f->cb.readPos     = h->readPos;
+    f->syncedWritePos = h->writePos;
+    f->syncedReadPos  = h->readPos;
+    return true;
+}
+
+/** \brief Open a ring file, creating it if it does not exist.
+ * An existing file is recovered from the indices of its last cbuf_sync():
+ * data written after that is discarded, data read after that is seen again.
+ *
+ * \param[in] f: handle to cbuf_file_t, f->cb is then read with the cbuf_* calls
+ *            and written with cbuf_file_write().
+ * \param[in] path: file name.
+ * \param[in] sizeInBytes: size of data area, a power of two (>= 2). Must match
+ *            an existing file, 0 accepts the size of an existing file.
+ * \return `true` if successful, `false` otherwise (also if an existing file is not a ring file).
+ *
+ * Must be released with cbuf_file_close().
+ */
+bool cbuf_file_open(cbuf_file_t *f, char const *path, uint64_t const sizeInBytes) {
+    if (NULL == f || NULL == path || (0 != sizeInBytes && (sizeInBytes < 2 || 0 != (sizeInBytes & (sizeInBytes - 1))))) {
+        return false;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        if (0 == sizeInBytes || 0 != ftruncate(fd, (off_t)(CBUF_FILE_HEADER_SIZE + sizeInBytes))
+            || !cbuf_file_map(f, fd, true, sizeInBytes)) {
+            close(fd);
+            unlink(path);
+            return false;
+        }
+        return true;
+    }
+    if (EEXIST != errno) {
+        return false;
+    }
+    fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    if (!cbuf_file_map(f, fd, false, sizeInBytes)) {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+/** \brief Make the ring file state durable.
+ * Writes back the data written since the previous call, then persists the
+ * indices. Call it once per batch of writes/reads, not per call. Space read
+ * before the call becomes available to cbuf_file_write() afterwards.
+ *
+ * \param[in] f: handle to cbuf_file_t.
+ * \return `true` if successful, `false` otherwise (indices on disk are unchanged).
+ */
+bool cbuf_sync(cbuf_file_t *f) {
+    if (NULL == f || NULL == f->header) {
+        return false;
+    }
+    cbuf_file_header_t *h = f->header;
+    uint64_t const writePos = f->cb.writePos;
+    uint64_t const readPos  = f->cb.readPos;
+    // Data first, so the persisted writePos never covers data that is not on disk
+    if (!cbuf_file_sync_data(f)) {
+        return false;
+    }
+    h->writePos = writePos;
+    h->readPos  = readPos;
+    h->check    = cbuf_file_check(h);
+    if (!cbuf_file_msync(f, 0, CBUF_FILE_HEADER_SIZE)) {
+        return false;
+    }
+    f->syncedWritePos = writePos;
+    f->syncedReadPos  = readPos; // space read before is free for the producer now
+    return true;
+}
+
+// Free space as seen from the persisted readPos, at most what cbuf_get_free() reports.
+static uint64_t cbuf_file_free(cbuf_file_t const *f) {
+    return f->cb.size - (f->cb.writePos - f->syncedReadPos);
+}
+
+/** \brief Write data to a ring file.
+ * Like cbuf_write(), but space read since the last cbuf_sync() is not
+ * reused before the next one, so a crash in between cannot leave the
+ * persisted range overwritten with unsynced data.
+ *
+ * \param[in] f: handle to cbuf_file_t.
+ * \param[in] data: pointer to data to be written into buffer.
+ * \param[in] numOfBytes: number of bytes to be written into buffer.
+ * \return number of bytes written, limited to the free space behind the persisted readPos.
+ */
+uint64_t cbuf_file_write(cbuf_file_t *f, void const *data, uint64_t numOfBytes) {
+    return cbuf_write(&f->cb, data, CBUF_MIN(numOfBytes, cbuf_file_free(f)));
+}
+
+/** \brief Reserve space in a ring file for writing in place (zero-copy).
+ * Like cbuf_write_reserve(), limited the same way as cbuf_file_write().
+ * The bytes are committed with cbuf_write_commit() on f->cb, at most as
+ * many as were reserved.
+ *
+ * \param[in] f: handle to cbuf_file_t.
+ * \param[in] numOfBytes: number of bytes to reserve.
+ * \param[out] ptr: start of the (up to) two free spans, `NULL` if a span is empty.
+ * \param[out] len: length in bytes of each span.
+ * \return number of bytes reserved (len[0] + len[1]).
+ */
+uint64_t cbuf_file_write_reserve(cbuf_file_t *f, uint64_t numOfBytes, uint8_t *ptr[2], uint64_t len[2]) {
+    return cbuf_write_reserve(&f->cb, CBUF_MIN(numOfBytes, cbuf_file_free(f)), ptr, len);
+}
+
+/** \brief Sync and close a ring file.
+ *
+ * \param[in] f: handle to cbuf_file_t.
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_file_close(cbuf_file_t *f) {
+    if (NULL == f || NULL == f->header) {
+        return false;
+    }
+    bool ok = cbuf_sync(f);
+    ok = (0 == munmap(f->header, (size_t)f->mapSize)) && ok;
+    ok = (0 == close(f->fd)) && ok;
+    f->header = NULL;
+    f->cb.bufPtr = NULL;
+    f->fd = -1;
+    return ok;
+}
@@ -0,0 +1,44 @@
+#ifndef CBUF_FILE_H
+#define CBUF_FILE_H
+
+#include "cbuf.h"
+
+#define CBUF_FILE_MAGIC       0x314c494655424243ULL // "CBUFFIL1" in memory on little-endian
+#define CBUF_FILE_VERSION     1u
+#define CBUF_FILE_HEADER_SIZE 4096u                 // data starts page aligned
+
+// Header at the start of a ring file. Indices are free-running (size is a
+// power of two) and only updated by cbuf_sync(), after the data they cover
+// has been written back, so a reopened file never exposes unsynced data.
+typedef struct cbuf_file_header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t size;
+  uint64_t writePos;
+  uint64_t readPos;
+  uint64_t check;    // magic ^ size ^ writePos ^ readPos, detects a torn header
+} cbuf_file_header_t;
+
+// Ring file mapped into memory, its data lives in the page cache of the file.
+// cb is read with the regular cbuf_* calls, but written only through
+// cbuf_file_write()/cbuf_file_write_reserve(): the kernel may write dirty
+// pages back at any time, so space read since the last cbuf_sync() still
+// belongs to the persisted range and must not be reused before the next one.
+typedef struct cbuf_file {
+  cbuf_t cb;
+  cbuf_file_header_t *header;
+  uint64_t mapSize;
+  uint64_t syncedWritePos; // data before it is on disk
+  uint64_t syncedReadPos;  // readPos on disk, the producer stays behind it
+  int fd;
+} cbuf_file_t;
+
+// POSIX only.
+bool     cbuf_file_open(cbuf_file_t *f, char const *path, uint64_t const sizeInBytes);
+bool     cbuf_file_close(cbuf_file_t *f);
+bool     cbuf_sync(cbuf_file_t *f);
+uint64_t cbuf_file_write(cbuf_file_t *f, void const *data, uint64_t numOfBytes);
+uint64_t cbuf_file_write_reserve(cbuf_file_t *f, uint64_t numOfBytes, uint8_t *ptr[2], uint64_t len[2]);
+
+#endif // CBUF_FILE_H
@@ -0,0 +1,50 @@
+#ifndef CBUF_INDEX_H
+#define CBUF_INDEX_H
+
+// Index arithmetic of cbuf_t, shared by cbuf.c, the other modules and the
+// header versions in cbuf_inline.h.
+
+#include "cbuf.h"
+
+// Branch hint for the fast paths, full/empty is the rare case there
+#define CBUF_UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+// Two index schemes are supported:
+// - cbuf_init(): writePos/readPos are kept in [0, size), one slot is left
+//   unused to tell full from empty.
+// - cbuf_init_pow2(): size is a power of two, writePos/readPos run freely and
+//   are masked on access, the whole buffer can be used.
+// A non-zero mask selects the second scheme.
+// Independently of the scheme, a buffer set up with cbuf_init_mirrored() is
+// followed by a second mapping of itself, so no copy ever has to be split.
+
+// Offset into bufPtr for a position.
+static inline uint64_t cbuf_offset(cbuf_t const *cb, uint64_t pos) {
+    return cb->mask ? (pos & cb->mask) : pos;
+}
+
+// Move a position forward by n bytes (n <= size).
+static inline uint64_t cbuf_advance(cbuf_t const *cb, uint64_t pos, uint64_t n) {
+    pos += n;
+    if (cb->mask) {
+        return pos;
+    }
+    return (pos >= cb->size) ? (pos - cb->size) : pos;
+}
+
+// Maximum number of bytes that can be stored.
+static inline uint64_t cbuf_capacity(cbuf_t const *cb) {
+    return cb->mask ? cb->size : (cb->size - 1);
+}
+
+// Number of bytes stored between readPos and writePos.
+static inline uint64_t cbuf_filled_between(cbuf_t const *cb, uint64_t writePos, uint64_t readPos) {
+    if (cb->mask || writePos >= readPos) {
+        return (writePos - readPos);
+    }
+    else {
+        return (cb->size - readPos + writePos);
+    }
+}
+
+#endif // CBUF_INDEX_H
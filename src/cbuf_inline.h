@@ -0,0 +1,59 @@
+#ifndef CBUF_INLINE_H
+#define CBUF_INLINE_H
+
+#include "cbuf.h"
+#include "cbuf_index.h"
+
+// Header versions of the state queries and single-byte calls of cbuf.h, for
+// loops that move one byte at a time (ISRs, protocol decoders). Called across
+// translation units, cbuf_read_single() and friends always cost a function
+// call; these compile into the caller's loop instead. They behave exactly
+// like the out-of-line functions, which are implemented with them, so both
+// can be used on the same buffer. Not thread-safe, same as cbuf_read().
+// With CBUF_ENABLE_STATS only the out-of-line calls are counted.
+//
+// A byte store may alias any object, *cb included, so the positions are
+// loaded into locals once instead of being reloaded after each access.
+
+static inline bool cbuf_is_empty_inline(cbuf_t const *cb) {
+    return cb->writePos == cb->readPos;
+}
+
+static inline uint64_t cbuf_get_filled_inline(cbuf_t const *cb) {
+    return cbuf_filled_between(cb, cb->writePos, cb->readPos);
+}
+
+static inline uint64_t cbuf_get_free_inline(cbuf_t const *cb) {
+    return cbuf_capacity(cb) - cbuf_get_filled_inline(cb);
+}
+
+static inline bool cbuf_is_full_inline(cbuf_t const *cb) {
+    return cbuf_get_filled_inline(cb) == cbuf_capacity(cb);
+}
+
+// Returns `1` if the byte was written, `0` if the buffer is full.
+static inline uint8_t cbuf_write_single_inline(cbuf_t *cb, uint8_t data) {
+    uint64_t const writePos = cb->writePos;
+    uint64_t const filled = cbuf_filled_between(cb, writePos, cb->readPos);
+
+    if (CBUF_UNLIKELY(filled == cbuf_capacity(cb))) {
+        return 0;
+    }
+    cb->bufPtr[cbuf_offset(cb, writePos)] = data;
+    cb->writePos = cbuf_advance(cb, writePos, 1);
+    return 1;
+}
+
+// Returns `1` if a byte was read into *buffer, `0` if the buffer is empty.
+static inline uint8_t cbuf_read_single_inline(cbuf_t *cb, uint8_t *buffer) {
+    uint64_t const readPos = cb->readPos;
+
+    if (CBUF_UNLIKELY(cb->writePos == readPos)) {
+        return 0;
+    }
+    *buffer = cb->bufPtr[cbuf_offset(cb, readPos)];
+    cb->readPos = cbuf_advance(cb, readPos, 1);
+    return 1;
+}
+
+#endif // CBUF_INLINE_H
@@ -0,0 +1,148 @@
+#ifndef CBUF_INTERNAL_H
+#define CBUF_INTERNAL_H
+
+// Helpers shared by the cbuf modules, not part of the public API. The index
+// arithmetic itself is in cbuf_index.h.
+
+#include "cbuf.h"
+#include "cbuf_index.h"
+#include <string.h>
+
+#define CBUF_MIN(x,y) ((x) < (y) ? (x) : (y))
+
+// Index accessors used by the lock-free SPSC entry points.
+// Each side publishes its own index with release semantics and observes the
+// other side's index with acquire semantics (C11 memory model).
+#define CBUF_LOAD_RELAXED(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define CBUF_LOAD_ACQUIRE(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define CBUF_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+// Copy kernels. Up to CBUF_COPY_INLINE_MAX bytes are copied inline with two
+// fixed-size moves that overlap in the middle, so short records never pay for
+// a call. Medium lengths go to memcpy(), whose own dispatch is hard to beat
+// while the data is in L1. From CBUF_COPY_BULK_MIN on, copies go through
+// cbuf_copy_bulk, which cbuf.c points at a kernel for the CPU on first use;
+// copies larger than the L2 cache use non-temporal stores.
+// Define CBUF_COPY_NO_SIMD to hand all longer copies to memcpy(), and
+// CBUF_COPY_ENABLE_NEON to try the (untested) AArch64 kernel.
+#define CBUF_COPY_INLINE_MAX 128
+#define CBUF_COPY_BULK_MIN   (64u * 1024u)
+
+typedef void (*cbuf_copy_fn)(void *dst, void const *src, uint64_t n);
+extern cbuf_copy_fn cbuf_copy_bulk;
+uint32_t cbuf_copy_kernels(cbuf_copy_fn *kernels, uint32_t max);
+
+// Copy n bytes, the areas must not overlap.
+static inline void cbuf_copy_bytes(void *dst, void const *src, uint64_t n) {
+    uint8_t *d = (uint8_t *)dst;
+    uint8_t const *s = (uint8_t const *)src;
+
+    if (n > CBUF_COPY_INLINE_MAX) {
+        if (n < CBUF_COPY_BULK_MIN) {
+            memcpy(d, s, n);
+        }
+        else {
+            __atomic_load_n(&cbuf_copy_bulk, __ATOMIC_RELAXED)(dst, src, n);
+        }
+    }
+    else if (n > 32) {
+        if (n > 64) {
+            memcpy(d, s, 64);
+            memcpy(d + n - 64, s + n - 64, 64);
+        }
+        else {
+            memcpy(d, s, 32);
+            memcpy(d + n - 32, s + n - 32, 32);
+        }
+    }
+    else if (n > 16) {
+        memcpy(d, s, 16);
+        memcpy(d + n - 16, s + n - 16, 16);
+    }
+    else if (n >= 8) {
+        memcpy(d, s, 8);
+        memcpy(d + n - 8, s + n - 8, 8);
+    }
+    else if (n >= 4) {
+        memcpy(d, s, 4);
+        memcpy(d + n - 4, s + n - 4, 4);
+    }
+    else if (n > 0) {
+        d[0]     = s[0];
+        d[n / 2] = s[n / 2];
+        d[n - 1] = s[n - 1];
+    }
+}
+
+// Instrumentation hooks, expand to nothing unless built with CBUF_ENABLE_STATS.
+// Arguments are not evaluated then either. With it, they only count while
+// storage is attached with cbuf_stats_attach().
+#ifdef CBUF_ENABLE_STATS
+
+// Counters have a single writer each, so a plain (relaxed) load and store
+// suffices and cbuf_get_stats() can read them concurrently.
+static inline void cbuf_stat_add(uint64_t *counter, uint64_t n) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+// Did numOfBytes starting at pos cross the end of buffer?
+static inline bool cbuf_stat_wrapped(cbuf_t const *cb, uint64_t pos, uint64_t numOfBytes) {
+    return !(cb->flags & CBUF_FLAG_MIRRORED) && cbuf_offset(cb, pos) + numOfBytes > cb->size;
+}
+
+static inline void cbuf_stats_on_write(cbuf_t *cb, uint64_t pos, uint64_t requested, uint64_t written,
+                                       uint64_t filledBefore) {
+    cbuf_stats_t *s = cb->stats;
+    uint64_t filled = filledBefore + written;
+    if (NULL == s) {
+        return;
+    }
+    if (0 == written) {
+        cbuf_stat_add(&s->fullHits, 0 != requested);
+        return;
+    }
+    cbuf_stat_add(&s->bytesIn, written);
+    cbuf_stat_add(&s->partialWrites, written < requested);
+    cbuf_stat_add(&s->writeWraps, cbuf_stat_wrapped(cb, pos, written));
+    cbuf_stat_add(&s->occupancy[(filled * CBUF_STATS_BUCKETS) / (cbuf_capacity(cb) + 1)], 1);
+    if (filled > s->highWatermark) {
+        __atomic_store_n(&s->highWatermark, filled, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void cbuf_stats_on_read(cbuf_t *cb, uint64_t pos, uint64_t requested, uint64_t bytesRead) {
+    cbuf_stats_t *s = cb->stats;
+    if (NULL == s) {
+        return;
+    }
+    if (0 == bytesRead) {
+        cbuf_stat_add(&s->emptyHits, 0 != requested);
+        return;
+    }
+    cbuf_stat_add(&s->bytesOut, bytesRead);
+    cbuf_stat_add(&s->partialReads, bytesRead < requested);
+    cbuf_stat_add(&s->readWraps, cbuf_stat_wrapped(cb, pos, bytesRead));
+}
+
+static inline void cbuf_stats_on_drop(cbuf_t *cb, uint64_t dropped) {
+    if (NULL != cb->stats) {
+        cbuf_stat_add(&cb->stats->bytesDropped, dropped);
+    }
+}
+
+#define CBUF_STATS_ON_WRITE(cb, pos, requested, written, filledBefore) \
+    cbuf_stats_on_write((cb), (pos), (requested), (written), (filledBefore))
+#define CBUF_STATS_ON_READ(cb, pos, requested, bytesRead) \
+    cbuf_stats_on_read((cb), (pos), (requested), (bytesRead))
+#define CBUF_STATS_ON_DROP(cb, dropped) \
+    cbuf_stats_on_drop((cb), (dropped))
+
+#else
+
+#define CBUF_STATS_ON_WRITE(cb, pos, requested, written, filledBefore) ((void)0)
+#define CBUF_STATS_ON_READ(cb, pos, requested, bytesRead)              ((void)0)
+#define CBUF_STATS_ON_DROP(cb, dropped)                                ((void)0)
+
+#endif // CBUF_ENABLE_STATS
+
+#endif // CBUF_INTERNAL_H
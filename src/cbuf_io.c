@@ -0,0 +1,112 @@
+#include "cbuf_io.h"
+#include "cbuf_internal.h"
+#include <limits.h>
+#include <unistd.h>
+
+// Fill iov from up to two spans, returns the number of non-empty entries.
+static int cbuf_spans_to_iovecs(uint8_t *ptr[2], uint64_t len[2], struct iovec iov[2]) {
+    int count = 0;
+    for (int i = 0; i < 2; i++) {
+        if (0 != len[i]) {
+            iov[count].iov_base = ptr[i];
+            iov[count].iov_len  = (size_t)len[i];
+            count++;
+        }
+    }
+    return count;
+}
+
+// Limit spans to numOfBytes in total.
+static void cbuf_trim_spans(uint64_t len[2], uint64_t numOfBytes) {
+    if (len[0] >= numOfBytes) {
+        len[0] = numOfBytes;
+        len[1] = 0;
+    }
+    else if (len[0] + len[1] > numOfBytes) {
+        len[1] = numOfBytes - len[0];
+    }
+}
+
+/** \brief Describe the data stored in circular buffer as iovecs.
+ * Nothing is consumed, use cbuf_read_release() once the data is processed.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] iov: up to two regions holding the stored data, in order.
+ * \return number of entries used in iov (0, 1 or 2).
+ */
+int cbuf_get_read_iovecs(cbuf_t *cb, struct iovec iov[2]) {
+    uint8_t const *ptr[2];
+    uint64_t len[2];
+
+    cbuf_read_acquire(cb, ptr, len);
+    return cbuf_spans_to_iovecs((uint8_t **)ptr, len, iov);
+}
+
+/** \brief Describe the free space in circular buffer as iovecs.
+ * Nothing is stored, use cbuf_write_commit() once the regions are filled.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] iov: up to two free regions, in order.
+ * \return number of entries used in iov (0, 1 or 2).
+ */
+int cbuf_get_write_iovecs(cbuf_t *cb, struct iovec iov[2]) {
+    uint8_t *ptr[2];
+    uint64_t len[2];
+
+    cbuf_write_reserve(cb, UINT64_MAX, ptr, len);
+    return cbuf_spans_to_iovecs(ptr, len, iov);
+}
+
+/** \brief Read data from circular buffer straight into a file descriptor with writev().
+ * readPos is advanced by the number of bytes the descriptor accepted.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] fd: file descriptor to write to.
+ * \param[in] numOfBytes: maximum number of bytes to transfer.
+ * \return number of bytes transferred, or -1 with errno set by writev().
+ */
+ssize_t cbuf_read_to_fd(cbuf_t *cb, int fd, uint64_t numOfBytes) {
+    uint8_t const *ptr[2];
+    uint64_t len[2];
+    struct iovec iov[2];
+
+    cbuf_read_acquire(cb, ptr, len);
+    cbuf_trim_spans(len, CBUF_MIN(numOfBytes, (uint64_t)SSIZE_MAX));
+    int count = cbuf_spans_to_iovecs((uint8_t **)ptr, len, iov);
+    if (0 == count) {
+        return 0;
+    }
+    ssize_t ret = writev(fd, iov, count);
+    if (ret > 0) {
+        cbuf_read_release(cb, (uint64_t)ret);
+    }
+    return ret;
+}
+
+/** \brief Write data into circular buffer straight from a file descriptor with readv().
+ * writePos is advanced by the number of bytes received.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] fd: file descriptor to read from.
+ * \param[in] numOfBytes: maximum number of bytes to transfer.
+ * \return number of bytes transferred, or -1 with errno set by readv().
+ *
+ * A return value of 0 means either the buffer is full or end of file was reached,
+ * check cbuf_get_free() to tell them apart.
+ */
+ssize_t cbuf_write_from_fd(cbuf_t *cb, int fd, uint64_t numOfBytes) {
+    uint8_t *ptr[2];
+    uint64_t len[2];
+    struct iovec iov[2];
+
+    cbuf_write_reserve(cb, CBUF_MIN(numOfBytes, (uint64_t)SSIZE_MAX), ptr, len);
+    int count = cbuf_spans_to_iovecs(ptr, len, iov);
+    if (0 == count) {
+        return 0;
+    }
+    ssize_t ret = readv(fd, iov, count);
+    if (ret > 0) {
+        cbuf_write_commit(cb, (uint64_t)ret);
+    }
+    return ret;
+}
@@ -0,0 +1,15 @@
+#ifndef CBUF_IO_H
+#define CBUF_IO_H
+
+#include "cbuf.h"
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// POSIX scatter/gather access, data moves between the ring and a file
+// descriptor without a staging buffer.
+int     cbuf_get_read_iovecs(cbuf_t *cb, struct iovec iov[2]);
+int     cbuf_get_write_iovecs(cbuf_t *cb, struct iovec iov[2]);
+ssize_t cbuf_read_to_fd(cbuf_t *cb, int fd, uint64_t numOfBytes);
+ssize_t cbuf_write_from_fd(cbuf_t *cb, int fd, uint64_t numOfBytes);
+
+#endif // CBUF_IO_H
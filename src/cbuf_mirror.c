@@ -0,0 +1,86 @@
+#define _GNU_SOURCE // memfd_create()
+#include "cbuf_mirror.h"
+#include <stddef.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/** \brief Get the granularity for mirrored buffer sizes.
+ *
+ * \return page size in bytes, sizes passed to cbuf_init_mirrored() must be a multiple of it.
+ */
+uint64_t cbuf_mirror_granularity(void) {
+    long pageSize = sysconf(_SC_PAGESIZE);
+    return (pageSize > 0) ? (uint64_t)pageSize : 4096;
+}
+
+/** \brief Allocate and initialize a mirrored circular buffer.
+ * The same pages are mapped twice back to back, so bufPtr[size + i] aliases
+ * bufPtr[i]. Reads and writes never have to be split at the end of the buffer,
+ * and up to cbuf_get_filled() bytes starting at readPos are always contiguous.
+ * A power-of-two size selects the masked index scheme of cbuf_init_pow2().
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] sizeInBytes: size of buffer in bytes, multiple of cbuf_mirror_granularity().
+ * \return `true` if successful, `false` otherwise.
+ *
+ * Must be released with cbuf_destroy_mirrored().
+ */
+bool cbuf_init_mirrored(cbuf_t *cb, uint64_t const sizeInBytes) {
+    if (NULL == cb || 0 == sizeInBytes || 0 != (sizeInBytes % cbuf_mirror_granularity())
+        || sizeInBytes > (uint64_t)SIZE_MAX / 2) {
+        return false;
+    }
+
+    int fd = memfd_create("cbuf", MFD_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    if (0 != ftruncate(fd, (off_t)sizeInBytes)) {
+        close(fd);
+        return false;
+    }
+
+    // Reserve the address range for both halves first, then map the memfd over it
+    uint8_t *base = mmap(NULL, 2 * sizeInBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == base) {
+        close(fd);
+        return false;
+    }
+    if (MAP_FAILED == mmap(base, sizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)
+        || MAP_FAILED == mmap(base + sizeInBytes, sizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0)) {
+        munmap(base, 2 * sizeInBytes);
+        close(fd);
+        return false;
+    }
+    close(fd); // The mappings keep the memory alive
+
+    if (0 == (sizeInBytes & (sizeInBytes - 1))) {
+        cbuf_init_pow2(cb, base, sizeInBytes);
+    }
+    else {
+        cbuf_init(cb, base, sizeInBytes);
+    }
+    cb->flags |= CBUF_FLAG_MIRRORED;
+    return true;
+}
+
+/** \brief Release a circular buffer set up with cbuf_init_mirrored().
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_destroy_mirrored(cbuf_t *cb) {
+    if (NULL == cb || NULL == cb->bufPtr || !(cb->flags & CBUF_FLAG_MIRRORED)) {
+        return false;
+    }
+    if (0 != munmap(cb->bufPtr, 2 * cb->size)) {
+        return false;
+    }
+    cb->bufPtr   = NULL;
+    cb->size     = 0;
+    cb->mask     = 0;
+    cb->flags    = 0;
+    cb->writePos = 0;
+    cb->readPos  = 0;
+    return true;
+}
@@ -0,0 +1,12 @@
+#ifndef CBUF_MIRROR_H
+#define CBUF_MIRROR_H
+
+#include "cbuf.h"
+
+// Linux only: the buffer is a memfd mapped twice back to back, so data that
+// wraps around the end of the buffer is still contiguous in memory.
+bool     cbuf_init_mirrored(cbuf_t *cb, uint64_t const sizeInBytes);
+bool     cbuf_destroy_mirrored(cbuf_t *cb);
+uint64_t cbuf_mirror_granularity(void);
+
+#endif // CBUF_MIRROR_H
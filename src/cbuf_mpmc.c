@@ -0,0 +1,112 @@
+#include "cbuf_mpmc.h"
+#include <stddef.h>
+#include <string.h>
+
+_Static_assert(offsetof(cbuf_mpmc_t, enqueuePos) == CBUF_CACHE_LINE, "producer index on its own line");
+_Static_assert(offsetof(cbuf_mpmc_t, dequeuePos) == 2 * CBUF_CACHE_LINE, "consumer index on its own line");
+
+// Bounded MPMC queue after D. Vyukov: slot i initially holds sequence i.
+// A producer may fill a slot when its sequence equals the enqueue position,
+// then publishes it as (pos + 1). A consumer may empty it when the sequence
+// equals (pos + 1), then recycles it as (pos + number of slots).
+
+#define CBUF_MPMC_SEQ(q, pos) ((uint64_t *)&(q)->bufPtr[((pos) & (q)->mask) * (q)->slotSize])
+
+/** \brief Initialize a multi-producer/multi-consumer queue with a given buffer.
+ * The number of slots is sizeInBytes / CBUF_MPMC_SLOT_SIZE(elemSize) and must
+ * be a power of two, CBUF_MPMC_BUFFER_SIZE() gives a matching buffer size.
+ *
+ * \param[in] q: handle to cbuf_mpmc_t.
+ * \param[in] buffer: internal buffer to store slots, 8-byte aligned, must not be directly manipulated.
+ * \param[in] sizeInBytes: size of buffer in bytes.
+ * \param[in] elemSize: size of one element in bytes.
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_mpmc_init(cbuf_mpmc_t *q, void *buffer, uint64_t const sizeInBytes, uint64_t const elemSize) {
+    if (NULL == q || NULL == buffer || 0 == elemSize || 0 != ((uintptr_t)buffer & 7u)) {
+        return false;
+    }
+    uint64_t numSlots = sizeInBytes / CBUF_MPMC_SLOT_SIZE(elemSize);
+    if (numSlots < 2 || 0 != (numSlots & (numSlots - 1))) {
+        return false;
+    }
+    q->bufPtr   = (uint8_t *)buffer;
+    q->mask     = numSlots - 1;
+    q->slotSize = CBUF_MPMC_SLOT_SIZE(elemSize);
+    q->elemSize = elemSize;
+    for (uint64_t i = 0; i < numSlots; i++) {
+        __atomic_store_n(CBUF_MPMC_SEQ(q, i), i, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&q->enqueuePos, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&q->dequeuePos, 0, __ATOMIC_RELEASE);
+    return true;
+}
+
+/** \brief Push one element, may be called from any number of threads.
+ *
+ * \param[in] q: handle to cbuf_mpmc_t.
+ * \param[in] elem: element to be copied into the queue (elemSize bytes).
+ * \return `true` if successful, `false` if the queue is full.
+ */
+bool cbuf_mpmc_try_push(cbuf_mpmc_t *q, void const *elem) {
+    uint64_t pos = __atomic_load_n(&q->enqueuePos, __ATOMIC_RELAXED);
+    uint64_t *seq;
+    for (;;) {
+        seq = CBUF_MPMC_SEQ(q, pos);
+        int64_t diff = (int64_t)(__atomic_load_n(seq, __ATOMIC_ACQUIRE) - pos);
+        if (0 == diff) {
+            // Slot is free for this position, try to claim it
+            if (__atomic_compare_exchange_n(&q->enqueuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+        else if (diff < 0) { // Slot still holds the element from one lap ago
+            return false;
+        }
+        else { // Another producer took this position
+            pos = __atomic_load_n(&q->enqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+    memcpy(seq + 1, elem, q->elemSize);
+    __atomic_store_n(seq, pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/** \brief Pop one element, may be called from any number of threads.
+ *
+ * \param[in] q: handle to cbuf_mpmc_t.
+ * \param[out] elem: buffer for the element (elemSize bytes).
+ * \return `true` if successful, `false` if the queue is empty.
+ */
+bool cbuf_mpmc_try_pop(cbuf_mpmc_t *q, void *elem) {
+    uint64_t pos = __atomic_load_n(&q->dequeuePos, __ATOMIC_RELAXED);
+    uint64_t *seq;
+    for (;;) {
+        seq = CBUF_MPMC_SEQ(q, pos);
+        int64_t diff = (int64_t)(__atomic_load_n(seq, __ATOMIC_ACQUIRE) - (pos + 1));
+        if (0 == diff) {
+            // Slot holds the element for this position, try to claim it
+            if (__atomic_compare_exchange_n(&q->dequeuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+        else if (diff < 0) { // Slot not filled yet
+            return false;
+        }
+        else { // Another consumer took this position
+            pos = __atomic_load_n(&q->dequeuePos, __ATOMIC_RELAXED);
+        }
+    }
+    memcpy(elem, seq + 1, q->elemSize);
+    __atomic_store_n(seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/** \brief Get the maximum number of elements in queue.
+ *
+ * \param[in] q: handle to cbuf_mpmc_t.
+ * \return number of slots.
+ */
+uint64_t cbuf_mpmc_capacity(cbuf_mpmc_t const *q) {
+    return q->mask + 1;
+}
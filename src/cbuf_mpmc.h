@@ -0,0 +1,30 @@
+#ifndef CBUF_MPMC_H
+#define CBUF_MPMC_H
+
+#include "cbuf.h"
+
+// Each slot holds a sequence counter followed by one element, padded to 8 bytes
+#define CBUF_MPMC_SLOT_SIZE(elemSize)             ((8u + (uint64_t)(elemSize) + 7u) & ~(uint64_t)7u)
+#define CBUF_MPMC_BUFFER_SIZE(numSlots, elemSize) ((uint64_t)(numSlots) * CBUF_MPMC_SLOT_SIZE(elemSize))
+
+// Bounded multi-producer/multi-consumer queue of fixed-size elements.
+// Producers and consumers claim slots with a CAS on enqueuePos/dequeuePos,
+// and hand them over through the per-slot sequence counters.
+typedef struct cbuf_mpmc {
+  uint8_t *bufPtr;
+  uint64_t mask;       // number of slots - 1
+  uint64_t slotSize;
+  uint64_t elemSize;
+  uint8_t  pad0[CBUF_CACHE_LINE - 32];
+  uint64_t enqueuePos; // Shared by producers
+  uint8_t  pad1[CBUF_CACHE_LINE - 8];
+  uint64_t dequeuePos; // Shared by consumers
+  uint8_t  pad2[CBUF_CACHE_LINE - 8];
+} __attribute__((aligned(CBUF_CACHE_LINE))) cbuf_mpmc_t;
+
+bool     cbuf_mpmc_init(cbuf_mpmc_t *q, void *buffer, uint64_t const sizeInBytes, uint64_t const elemSize);
+bool     cbuf_mpmc_try_push(cbuf_mpmc_t *q, void const *elem);
+bool     cbuf_mpmc_try_pop(cbuf_mpmc_t *q, void *elem);
+uint64_t cbuf_mpmc_capacity(cbuf_mpmc_t const *q);
+
+#endif // CBUF_MPMC_H
@@ -0,0 +1,219 @@
+#include "cbuf_msg.h"
+#include "cbuf_internal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Bytes left before the end of buffer at offset, unlimited for mirrored buffers.
+static inline uint64_t cbuf_msg_till_end(cbuf_t const *cb, uint64_t offset) {
+    return (cb->flags & CBUF_FLAG_MIRRORED) ? UINT64_MAX : (cb->size - offset);
+}
+
+// Find room for a message of len bytes at writePos.
+// Returns the header location and the number of padding bytes before it,
+// or NULL if the message does not fit.
+static uint8_t *cbuf_msg_place(cbuf_t *cb, uint64_t writePos, uint64_t readPos, uint32_t len, uint64_t *padding) {
+    uint64_t const needed  = CBUF_MSG_HEADER_SIZE + (uint64_t)len;
+    uint64_t const free    = cbuf_capacity(cb) - cbuf_filled_between(cb, writePos, readPos);
+    uint64_t const offset  = cbuf_offset(cb, writePos);
+    uint64_t const tillEnd = cbuf_msg_till_end(cb, offset);
+
+    *padding = (tillEnd >= needed) ? 0 : tillEnd;
+    if (needed > free || *padding > free - needed) {
+        return NULL;
+    }
+    return *padding ? &cb->bufPtr[0] : &cb->bufPtr[offset];
+}
+
+// Find the next message at readPos.
+// Returns the header location and the number of padding bytes before it,
+// or NULL if there is no message.
+static uint8_t *cbuf_msg_locate(cbuf_t *cb, uint64_t writePos, uint64_t readPos, uint64_t *padding) {
+    if (0 == cbuf_filled_between(cb, writePos, readPos)) {
+        return NULL;
+    }
+    uint64_t const offset  = cbuf_offset(cb, readPos);
+    uint64_t const tillEnd = cbuf_msg_till_end(cb, offset);
+    uint32_t header;
+
+    *padding = 0;
+    if (tillEnd < CBUF_MSG_HEADER_SIZE) { // No room for a wrap marker
+        *padding = tillEnd;
+    }
+    else {
+        memcpy(&header, &cb->bufPtr[offset], sizeof(header));
+        if (CBUF_MSG_WRAP == header) {
+            *padding = tillEnd;
+        }
+    }
+    return *padding ? &cb->bufPtr[0] : &cb->bufPtr[offset];
+}
+
+/** \brief Reserve room for one message to be written in place (zero-copy).
+ * The payload is made visible with cbuf_msg_write_commit().
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] len: payload length in bytes.
+ * \return pointer to len contiguous bytes for the payload, `NULL` if the message does not fit.
+ *
+ * Messages up to about half the buffer size always fit into an empty buffer.
+ */
+uint8_t *cbuf_msg_write_reserve(cbuf_t *cb, uint32_t len) {
+    uint64_t padding;
+    if (CBUF_MSG_WRAP == len) {
+        return NULL;
+    }
+    uint8_t *header = cbuf_msg_place(cb, CBUF_LOAD_RELAXED(&cb->writePos), CBUF_LOAD_ACQUIRE(&cb->readPos), len, &padding);
+    return header ? (header + CBUF_MSG_HEADER_SIZE) : NULL;
+}
+
+/** \brief Commit a message written into space obtained with cbuf_msg_write_reserve().
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] payload: pointer returned by cbuf_msg_write_reserve().
+ * \param[in] len: payload length in bytes, not more than reserved.
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_msg_write_commit(cbuf_t *cb, uint8_t const *payload, uint32_t len) {
+    uint64_t const writePos = CBUF_LOAD_RELAXED(&cb->writePos); // Owned by producer
+    uint64_t const readPos  = CBUF_LOAD_ACQUIRE(&cb->readPos);
+    uint64_t const offset   = cbuf_offset(cb, writePos);
+    uint64_t padding = 0;
+    uint32_t const header = len;
+
+    if (NULL == payload || CBUF_MSG_WRAP == len) {
+        return false;
+    }
+    // The reservation either sits right at writePos or was moved to the start of buffer
+    if (payload != &cb->bufPtr[offset + CBUF_MSG_HEADER_SIZE]) {
+        padding = cb->size - offset;
+    }
+    if (payload != &cb->bufPtr[(padding ? 0 : offset) + CBUF_MSG_HEADER_SIZE]
+        || padding + CBUF_MSG_HEADER_SIZE + len > cbuf_capacity(cb) - cbuf_filled_between(cb, writePos, readPos)) {
+        return false;
+    }
+    if (padding >= CBUF_MSG_HEADER_SIZE) {
+        uint32_t const wrap = CBUF_MSG_WRAP;
+        memcpy(&cb->bufPtr[offset], &wrap, sizeof(wrap));
+    }
+    memcpy((uint8_t *)payload - CBUF_MSG_HEADER_SIZE, &header, sizeof(header));
+    CBUF_STORE_RELEASE(&cb->writePos, cbuf_advance(cb, writePos, padding + CBUF_MSG_HEADER_SIZE + len));
+    return true;
+}
+
+/** \brief Write one message into circular buffer, all or nothing.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] data: payload to be written.
+ * \param[in] len: payload length in bytes.
+ * \return `true` if the message was written, `false` if it does not fit.
+ */
+bool cbuf_msg_write(cbuf_t *cb, void const *data, uint32_t len) {
+    uint8_t *payload = cbuf_msg_write_reserve(cb, len);
+    if (NULL == payload) {
+        return false;
+    }
+    cbuf_copy_bytes(payload, data, len);
+    return cbuf_msg_write_commit(cb, payload, len);
+}
+
+/** \brief Get the next message for reading in place (zero-copy).
+ * The payload stays valid until cbuf_msg_read_release() is called.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] len: payload length in bytes.
+ * \return pointer to the contiguous payload, `NULL` if there is no message.
+ */
+uint8_t const *cbuf_msg_read_acquire(cbuf_t *cb, uint32_t *len) {
+    uint64_t padding;
+    uint8_t *header = cbuf_msg_locate(cb, CBUF_LOAD_ACQUIRE(&cb->writePos), CBUF_LOAD_RELAXED(&cb->readPos), &padding);
+    if (NULL == header) {
+        return NULL;
+    }
+    memcpy(len, header, sizeof(*len));
+    return header + CBUF_MSG_HEADER_SIZE;
+}
+
+/** \brief Consume the next message, freeing its space.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \return `true` if a message was released, `false` if there is no message.
+ */
+bool cbuf_msg_read_release(cbuf_t *cb) {
+    uint64_t const readPos  = CBUF_LOAD_RELAXED(&cb->readPos); // Owned by consumer
+    uint64_t padding;
+    uint32_t len;
+    uint8_t *header = cbuf_msg_locate(cb, CBUF_LOAD_ACQUIRE(&cb->writePos), readPos, &padding);
+    if (NULL == header) {
+        return false;
+    }
+    memcpy(&len, header, sizeof(len));
+    CBUF_STORE_RELEASE(&cb->readPos, cbuf_advance(cb, readPos, padding + CBUF_MSG_HEADER_SIZE + len));
+    return true;
+}
+
+/** \brief Get the payload length of the next message without consuming it.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] len: payload length in bytes.
+ * \return `true` if there is a message, `false` otherwise.
+ */
+bool cbuf_msg_peek_len(cbuf_t *cb, uint32_t *len) {
+    return NULL != cbuf_msg_read_acquire(cb, len);
+}
+
+/** \brief Read one message from circular buffer, all or nothing.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] buffer: buffer for the payload.
+ * \param[in] bufSize: size of buffer in bytes.
+ * \param[out] len: payload length in bytes, also set if buffer is too small.
+ * \return `true` if a message was read, `false` if there is no message or
+ * it is longer than bufSize (the message is then left in the buffer).
+ */
+bool cbuf_msg_read(cbuf_t *cb, void *buffer, uint32_t bufSize, uint32_t *len) {
+    uint8_t const *payload = cbuf_msg_read_acquire(cb, len);
+    if (NULL == payload || *len > bufSize) {
+        return false;
+    }
+    cbuf_copy_bytes(buffer, payload, *len);
+    return cbuf_msg_read_release(cb);
+}
+
+/** \brief Start a batched read: take a snapshot of the stored messages.
+ * Messages written afterwards are not seen by this iterator.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] it: iterator positioned at the oldest message.
+ */
+void cbuf_msg_iter_begin(cbuf_t *cb, cbuf_msg_iter_t *it) {
+    it->readPos  = CBUF_LOAD_RELAXED(&cb->readPos); // Owned by consumer
+    it->writePos = CBUF_LOAD_ACQUIRE(&cb->writePos);
+}
+
+/** \brief Get the next message of a batched read, without touching the indices.
+ * Payloads stay valid until the iterator is committed.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in,out] it: iterator, moved past the returned message.
+ * \param[out] len: payload length in bytes.
+ * \return pointer to the contiguous payload, `NULL` at the end of the snapshot.
+ */
+uint8_t const *cbuf_msg_iter_next(cbuf_t *cb, cbuf_msg_iter_t *it, uint32_t *len) {
+    uint64_t padding;
+    uint8_t *header = cbuf_msg_locate(cb, it->writePos, it->readPos, &padding);
+    if (NULL == header) {
+        return NULL;
+    }
+    memcpy(len, header, sizeof(*len));
+    it->readPos = cbuf_advance(cb, it->readPos, padding + CBUF_MSG_HEADER_SIZE + *len);
+    return header + CBUF_MSG_HEADER_SIZE;
+}
+
+/** \brief Consume all messages an iterator went past, with a single index update.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] it: iterator from cbuf_msg_iter_begin()/cbuf_msg_iter_next().
+ */
+void cbuf_msg_iter_commit(cbuf_t *cb, cbuf_msg_iter_t const *it) {
+    CBUF_STORE_RELEASE(&cb->readPos, it->readPos);
+}
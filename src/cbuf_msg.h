@@ -0,0 +1,36 @@
+#ifndef CBUF_MSG_H
+#define CBUF_MSG_H
+
+#include "cbuf.h"
+
+// Length-prefixed messages on top of cbuf_t. Each message is stored as a
+// 32-bit length followed by its payload, always contiguous in memory: if it
+// does not fit before the end of buffer, the tail is skipped (marked with
+// CBUF_MSG_WRAP when there is room for a header) and the message starts at
+// the beginning. Messages are published and consumed with a single index
+// update, so a producer and a consumer thread can use these without a lock.
+// A buffer used for messages must not be accessed with the byte API.
+
+#define CBUF_MSG_HEADER_SIZE 4u
+#define CBUF_MSG_WRAP        UINT32_MAX // Header value for a skipped tail
+
+// Consumer side snapshot for batched reads: the indices are loaded once by
+// cbuf_msg_iter_begin() and readPos is published once by cbuf_msg_iter_commit().
+typedef struct cbuf_msg_iter {
+  uint64_t readPos;
+  uint64_t writePos;
+} cbuf_msg_iter_t;
+
+bool           cbuf_msg_write(cbuf_t *cb, void const *data, uint32_t len);
+bool           cbuf_msg_read(cbuf_t *cb, void *buffer, uint32_t bufSize, uint32_t *len);
+bool           cbuf_msg_peek_len(cbuf_t *cb, uint32_t *len);
+uint8_t       *cbuf_msg_write_reserve(cbuf_t *cb, uint32_t len);
+bool           cbuf_msg_write_commit(cbuf_t *cb, uint8_t const *payload, uint32_t len);
+uint8_t const *cbuf_msg_read_acquire(cbuf_t *cb, uint32_t *len);
+bool           cbuf_msg_read_release(cbuf_t *cb);
+
+void           cbuf_msg_iter_begin(cbuf_t *cb, cbuf_msg_iter_t *it);
+uint8_t const *cbuf_msg_iter_next(cbuf_t *cb, cbuf_msg_iter_t *it, uint32_t *len);
+void           cbuf_msg_iter_commit(cbuf_t *cb, cbuf_msg_iter_t const *it);
+
+#endif // CBUF_MSG_H
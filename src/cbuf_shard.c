@@ -0,0 +1,256 @@
+#define _GNU_SOURCE // sched_getcpu()
+#include "cbuf_shard.h"
+#include "cbuf_internal.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CBUF_SHARD_TS_SIZE 8u // timestamp in front of the payload
+
+static uint64_t cbuf_shard_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/** \brief Set up a sharded ring set in one allocation.
+ * A power-of-two shard size selects the masked index scheme of
+ * cbuf_init_pow2(), otherwise cbuf_init() is used.
+ *
+ * \param[in] set: handle to cbuf_shard_set_t.
+ * \param[in] count: number of shards, `0` for one per configured CPU.
+ * \param[in] shardSize: size of data area of each shard in bytes.
+ * \param[in] flags: CBUF_SHARD_* or 0.
+ * \return `true` if successful, `false` otherwise.
+ *
+ * Must be released with cbuf_shard_set_destroy().
+ */
+bool cbuf_shard_set_init(cbuf_shard_set_t *set, uint32_t count, uint64_t shardSize, uint32_t flags) {
+    if (NULL == set || shardSize < 2) {
+        return false;
+    }
+    if (0 == count) {
+        long cpus = sysconf(_SC_NPROCESSORS_CONF);
+        count = (cpus > 0) ? (uint32_t)cpus : 1;
+    }
+    // Slices start on their own cache lines, writers of neighbouring shards never share one
+    uint64_t const stride = (shardSize + CBUF_CACHE_LINE - 1) & ~(uint64_t)(CBUF_CACHE_LINE - 1);
+    uint64_t const headerSize = (uint64_t)count * sizeof(cbuf_shard_t);
+    if (stride < shardSize || stride > (SIZE_MAX - headerSize) / count) {
+        return false;
+    }
+    uint8_t *base = aligned_alloc(CBUF_CACHE_LINE, (size_t)(headerSize + stride * count));
+    if (NULL == base) {
+        return false;
+    }
+    memset(base, 0, (size_t)headerSize);
+
+    set->shards    = (cbuf_shard_t *)base;
+    set->stride    = stride;
+    set->count     = count;
+    set->flags     = flags;
+    set->nextShard = 0;
+    bool const pow2 = 0 == (shardSize & (shardSize - 1));
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t *slice = base + headerSize + (uint64_t)i * stride;
+        if (pow2) {
+            cbuf_init_pow2(&set->shards[i].cb, slice, shardSize);
+        }
+        else {
+            cbuf_init(&set->shards[i].cb, slice, shardSize);
+        }
+    }
+    return true;
+}
+
+/** \brief Release a sharded ring set.
+ *
+ * \param[in] set: handle to cbuf_shard_set_t.
+ */
+void cbuf_shard_set_destroy(cbuf_shard_set_t *set) {
+    if (NULL == set) {
+        return;
+    }
+    free(set->shards);
+    memset(set, 0, sizeof(*set));
+}
+
+// Store one record, with a timestamp in front if the set asks for it.
+static bool cbuf_shard_put(cbuf_shard_set_t *set, cbuf_shard_t *shard, void const *data, uint32_t len) {
+    bool ok = false;
+
+    if (set->flags & CBUF_SHARD_TIMESTAMPS) {
+        uint8_t *payload = (len <= UINT32_MAX - 1 - CBUF_SHARD_TS_SIZE)
+                         ? cbuf_msg_write_reserve(&shard->cb, CBUF_SHARD_TS_SIZE + len) : NULL;
+        if (NULL != payload) {
+            uint64_t const now = cbuf_shard_now();
+            memcpy(payload, &now, CBUF_SHARD_TS_SIZE);
+            memcpy(payload + CBUF_SHARD_TS_SIZE, data, len);
+            ok = cbuf_msg_write_commit(&shard->cb, payload, CBUF_SHARD_TS_SIZE + len);
+        }
+    }
+    else {
+        ok = cbuf_msg_write(&shard->cb, data, len);
+    }
+    if (!ok) {
+        __atomic_fetch_add(&shard->dropped, 1, __ATOMIC_RELAXED);
+    }
+    return ok;
+}
+
+/** \brief Write one record into a shard owned by the caller.
+ * Only one thread may write to a given shard.
+ *
+ * \param[in] set: handle to cbuf_shard_set_t.
+ * \param[in] shard: shard index, below set->count.
+ * \param[in] data: record to be written.
+ * \param[in] len: record length in bytes.
+ * \return `true` if the record was written, `false` if it does not fit
+ * (counted in cbuf_shard_get_dropped()).
+ */
+bool cbuf_shard_write(cbuf_shard_set_t *set, uint32_t shard, void const *data, uint32_t len) {
+    if (shard >= set->count) {
+        return false;
+    }
+    return cbuf_shard_put(set, &set->shards[shard], data, len);
+}
+
+/** \brief Write one record into the shard of the CPU the caller runs on.
+ * A shard is held for the duration of the copy, to cover a thread being
+ * preempted mid-write. If it is held, the next shards are tried, a writer
+ * never waits. Records of one thread can thus land in different shards and
+ * are not drained in the order they were written.
+ *
+ * \param[in] set: handle to cbuf_shard_set_t.
+ * \param[in] data: record to be written.
+ * \param[in] len: record length in bytes.
+ * \return `true` if the record was written, `false` if it does not fit
+ * (counted in cbuf_shard_get_dropped()).
+ */
+bool cbuf_shard_write_cpu(cbuf_shard_set_t *set, void const *data, uint32_t len) {
+    int const cpu = sched_getcpu();
+    uint32_t const first = (cpu >= 0) ? (uint32_t)cpu % set->count : 0;
+
+    for (uint32_t i = 0; i < set->count; i++) {
+        cbuf_shard_t *shard = &set->shards[(first + i) % set->count];
+        if (0 == CBUF_LOAD_RELAXED(&shard->lock) && 0 == __atomic_exchange_n(&shard->lock, 1, __ATOMIC_ACQUIRE)) {
+            bool ok = cbuf_shard_put(set, shard, data, len);
+            CBUF_STORE_RELEASE(&shard->lock, 0);
+            return ok;
+        }
+    }
+    __atomic_fetch_add(&set->shards[first].dropped, 1, __ATOMIC_RELAXED);
+    return false;
+}
+
+// Next record of a shard's snapshot into its head, `false` if there is none.
+static bool cbuf_shard_fetch(cbuf_shard_t *shard) {
+    if (NULL == shard->head) {
+        shard->head = cbuf_msg_iter_next(&shard->cb, &shard->it, &shard->headLen);
+    }
+    return NULL != shard->head;
+}
+
+// Hand out the head of a shard.
+static void cbuf_shard_emit(cbuf_shard_set_t *set, uint32_t index, cbuf_shard_record_t *record) {
+    cbuf_shard_t *shard = &set->shards[index];
+
+    record->data      = shard->head;
+    record->len       = shard->headLen;
+    record->shard     = index;
+    record->timestamp = 0;
+    if (set->flags & CBUF_SHARD_TIMESTAMPS) {
+        memcpy(&record->timestamp, shard->head, CBUF_SHARD_TS_SIZE);
+        record->data += CBUF_SHARD_TS_SIZE;
+        record->len  -= CBUF_SHARD_TS_SIZE;
+    }
+    shard->consumed = shard->it;
+    shard->head     = NULL;
+}
+
+/** \brief Collect a batch of records from all shards, in place (zero-copy).
+ * Takes a snapshot of every shard. Without CBUF_SHARD_TIMESTAMPS the
+ * shards are emptied one after the other, starting at a different shard
+ * each time. With timestamps the records are merged by time, which is
+ * exact within the snapshot; records written meanwhile can be older than
+ * ones already handed out.
+ *
+ * \param[in] set: handle to cbuf_shard_set_t.
+ * \param[out] records: records in the order they are handed out.
+ * \param[in] maxRecords: size of records.
+ * \return number of entries used in records.
+ *
+ * Must be followed by cbuf_shard_drain_release() before the next drain.
+ */
+uint32_t cbuf_shard_drain(cbuf_shard_set_t *set, cbuf_shard_record_t *records, uint32_t maxRecords) {
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < set->count; i++) {
+        cbuf_shard_t *shard = &set->shards[i];
+        cbuf_msg_iter_begin(&shard->cb, &shard->it);
+        shard->consumed = shard->it;
+        shard->head     = NULL;
+    }
+
+    if (0 == (set->flags & CBUF_SHARD_TIMESTAMPS)) {
+        uint32_t const first = set->nextShard;
+        for (uint32_t i = 0; i < set->count && count < maxRecords; i++) {
+            uint32_t const index = (first + i) % set->count;
+            while (count < maxRecords && cbuf_shard_fetch(&set->shards[index])) {
+                cbuf_shard_emit(set, index, &records[count++]);
+            }
+        }
+        set->nextShard = (first + 1) % set->count;
+        return count;
+    }
+
+    // Oldest head first
+    while (count < maxRecords) {
+        uint32_t oldest = UINT32_MAX;
+        uint64_t oldestTs = UINT64_MAX;
+        for (uint32_t i = 0; i < set->count; i++) {
+            uint64_t ts;
+            if (cbuf_shard_fetch(&set->shards[i])) {
+                memcpy(&ts, set->shards[i].head, sizeof(ts));
+                if (ts < oldestTs || UINT32_MAX == oldest) {
+                    oldest = i;
+                    oldestTs = ts;
+                }
+            }
+        }
+        if (UINT32_MAX == oldest) {
+            break;
+        }
+        cbuf_shard_emit(set, oldest, &records[count++]);
+    }
+    return count;
+}
+
+/** \brief Free the space of the records handed out by the last cbuf_shard_drain().
+ * One index update per shard that had records in the batch.
+ *
+ * \param[in] set: handle to cbuf_shard_set_t.
+ */
+void cbuf_shard_drain_release(cbuf_shard_set_t *set) {
+    for (uint32_t i = 0; i < set->count; i++) {
+        cbuf_shard_t *shard = &set->shards[i];
+        if (shard->consumed.readPos != CBUF_LOAD_RELAXED(&shard->cb.readPos)) {
+            cbuf_msg_iter_commit(&shard->cb, &shard->consumed);
+        }
+    }
+}
+
+/** \brief Number of records dropped because their shard was full.
+ *
+ * \param[in] set: handle to cbuf_shard_set_t.
+ * \return sum over all shards.
+ */
+uint64_t cbuf_shard_get_dropped(cbuf_shard_set_t *set) {
+    uint64_t dropped = 0;
+    for (uint32_t i = 0; i < set->count; i++) {
+        dropped += __atomic_load_n(&set->shards[i].dropped, __ATOMIC_RELAXED);
+    }
+    return dropped;
+}
@@ -0,0 +1,57 @@
+#ifndef CBUF_SHARD_H
+#define CBUF_SHARD_H
+
+#include "cbuf.h"
+#include "cbuf_msg.h"
+
+#define CBUF_SHARD_TIMESTAMPS (1u << 0) // stamp records, drain merges them by time
+
+// Sharded front-end for many writers and one consumer. Each shard is a
+// cbuf_t over its own slice of one allocation and holds cbuf_msg records,
+// so writers on different shards never touch the same cache lines. The
+// consumer drains all shards in batches: per batch every shard's writePos
+// is loaded once and its readPos is published once.
+//
+// Writers either own a shard (cbuf_shard_write(), e.g. one per thread) or
+// go through the shard of the CPU they run on (cbuf_shard_write_cpu()).
+// The two must not be mixed on one set. Only owned shards keep the records
+// of one writer in order: with cbuf_shard_write_cpu() a thread's records
+// spread over several shards when it migrates or finds its shard held, and
+// the drain does not restore their order. CBUF_SHARD_TIMESTAMPS gives
+// each record a time to order them by.
+typedef struct cbuf_shard {
+  cbuf_t   cb;
+  uint32_t lock;               // held by cbuf_shard_write_cpu() during a write
+  uint64_t dropped;            // records that did not fit
+  // Drain state, only used by the consumer
+  cbuf_msg_iter_t it __attribute__((aligned(CBUF_CACHE_LINE))); // next record to look at
+  cbuf_msg_iter_t consumed;    // past the last record handed out
+  uint8_t const *head;         // looked at, not handed out yet (ordered drain)
+  uint32_t headLen;
+} __attribute__((aligned(CBUF_CACHE_LINE))) cbuf_shard_t;
+
+typedef struct cbuf_shard_set {
+  cbuf_shard_t *shards;        // followed by the data slices, one allocation
+  uint64_t stride;             // distance between slices
+  uint32_t count;
+  uint32_t flags;              // CBUF_SHARD_*
+  uint32_t nextShard;          // where the next unordered drain starts
+} cbuf_shard_set_t;
+
+// One record handed out by cbuf_shard_drain().
+typedef struct cbuf_shard_record {
+  uint8_t const *data;         // valid until cbuf_shard_drain_release()
+  uint64_t timestamp;          // CLOCK_MONOTONIC in ns, 0 without CBUF_SHARD_TIMESTAMPS
+  uint32_t len;
+  uint32_t shard;
+} cbuf_shard_record_t;
+
+bool     cbuf_shard_set_init(cbuf_shard_set_t *set, uint32_t count, uint64_t shardSize, uint32_t flags);
+void     cbuf_shard_set_destroy(cbuf_shard_set_t *set);
+bool     cbuf_shard_write(cbuf_shard_set_t *set, uint32_t shard, void const *data, uint32_t len);
+bool     cbuf_shard_write_cpu(cbuf_shard_set_t *set, void const *data, uint32_t len);
+uint32_t cbuf_shard_drain(cbuf_shard_set_t *set, cbuf_shard_record_t *records, uint32_t maxRecords);
+void     cbuf_shard_drain_release(cbuf_shard_set_t *set);
+uint64_t cbuf_shard_get_dropped(cbuf_shard_set_t *set);
+
+#endif // CBUF_SHARD_H
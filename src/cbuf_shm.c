@@ -0,0 +1,275 @@
+#define _GNU_SOURCE // memfd_create()
+#include "cbuf_shm.h"
+#include "cbuf_internal.h"
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(cbuf_shm_header_t) == 3 * CBUF_CACHE_LINE, "cbuf_shm_header_t layout");
+_Static_assert(offsetof(cbuf_shm_header_t, writePos) == CBUF_CACHE_LINE, "writePos on its own line");
+_Static_assert(offsetof(cbuf_shm_header_t, readPos) == 2 * CBUF_CACHE_LINE, "readPos on its own line");
+
+// Map the whole object and fill in the handle.
+static bool cbuf_shm_map(cbuf_shm_t *shm, int fd, uint64_t mapSize) {
+    void *base = mmap(NULL, (size_t)mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == base) {
+        return false;
+    }
+    shm->header  = (cbuf_shm_header_t *)base;
+    shm->bufPtr  = (uint8_t *)base + sizeof(cbuf_shm_header_t);
+    shm->mapSize = mapSize;
+    shm->fd      = fd;
+    return true;
+}
+
+// A cbuf_t over the shared data, from the size and mask checked at
+// create/attach time. Indices are filled in by the caller.
+static cbuf_t cbuf_shm_view(cbuf_shm_t const *shm) {
+    cbuf_t cb = {.bufPtr = shm->bufPtr, .size = shm->size, .mask = shm->mask};
+    return cb;
+}
+
+// Do indices loaded from shared memory fit the scheme? The other side may
+// write anything there, every copy is bounded by this check.
+static bool cbuf_shm_indices_valid(uint64_t size, uint64_t mask, uint64_t writePos, uint64_t readPos) {
+    if (0 == mask) {
+        return writePos < size && readPos < size;
+    }
+    return writePos - readPos <= size;
+}
+
+/** \brief Create a circular buffer in shared memory.
+ * A power-of-two size selects the masked index scheme of cbuf_init_pow2(),
+ * otherwise one byte is left unused as with cbuf_init().
+ *
+ * \param[in] shm: handle to cbuf_shm_t.
+ * \param[in] name: shm_open() name ("/name"), must not exist yet. `NULL`
+ *            creates an anonymous memfd instead.
+ * \param[in] sizeInBytes: size of data area in bytes.
+ * \return `true` if successful, `false` otherwise.
+ *
+ * Must be released with cbuf_shm_detach(), a named object is removed with
+ * cbuf_shm_unlink().
+ */
+bool cbuf_shm_create(cbuf_shm_t *shm, char const *name, uint64_t const sizeInBytes) {
+    if (NULL == shm || sizeInBytes < 2 || sizeInBytes > (uint64_t)SIZE_MAX - sizeof(cbuf_shm_header_t)) {
+        return false;
+    }
+
+    int fd = (NULL == name) ? memfd_create("cbuf_shm", MFD_CLOEXEC)
+                            : shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    uint64_t mapSize = sizeof(cbuf_shm_header_t) + sizeInBytes;
+    if (0 != ftruncate(fd, (off_t)mapSize) || !cbuf_shm_map(shm, fd, mapSize)) {
+        close(fd);
+        if (NULL != name) {
+            shm_unlink(name);
+        }
+        return false;
+    }
+
+    cbuf_shm_header_t *h = shm->header;
+    h->version    = CBUF_SHM_VERSION;
+    h->headerSize = sizeof(cbuf_shm_header_t);
+    h->dataOffset = sizeof(cbuf_shm_header_t);
+    h->size       = sizeInBytes;
+    h->mask       = (0 == (sizeInBytes & (sizeInBytes - 1))) ? (sizeInBytes - 1) : 0;
+    h->writePos   = 0;
+    h->readPos    = 0;
+    shm->size     = h->size;
+    shm->mask     = h->mask;
+    // Attaching processes check the magic first
+    CBUF_STORE_RELEASE(&h->magic, CBUF_SHM_MAGIC);
+    return true;
+}
+
+// Check a header written by another process before trusting it.
+static bool cbuf_shm_header_valid(cbuf_shm_header_t const *h, uint64_t mapSize) {
+    if (CBUF_SHM_MAGIC != CBUF_LOAD_ACQUIRE(&h->magic) || CBUF_SHM_VERSION != h->version
+        || sizeof(cbuf_shm_header_t) != h->headerSize || sizeof(cbuf_shm_header_t) != h->dataOffset) {
+        return false;
+    }
+    uint64_t const size = h->size;
+    uint64_t const mask = h->mask;
+    if (size < 2 || size != mapSize - h->dataOffset) {
+        return false;
+    }
+    if (0 != mask && (mask != size - 1 || 0 != (size & mask))) {
+        return false;
+    }
+    return cbuf_shm_indices_valid(size, mask, CBUF_LOAD_ACQUIRE(&h->writePos), CBUF_LOAD_ACQUIRE(&h->readPos));
+}
+
+/** \brief Attach to a circular buffer created with cbuf_shm_create() from an
+ * already open file descriptor, e.g. a memfd received from another process.
+ *
+ * \param[in] shm: handle to cbuf_shm_t.
+ * \param[in] fd: descriptor of the shared memory object, owned by shm on success.
+ * \return `true` if successful, `false` otherwise (header missing, or its size,
+ * mask or indices do not fit the mapping).
+ */
+bool cbuf_shm_attach_fd(cbuf_shm_t *shm, int fd) {
+    struct stat st;
+    if (NULL == shm || fd < 0 || 0 != fstat(fd, &st) || (uint64_t)st.st_size < sizeof(cbuf_shm_header_t)) {
+        return false;
+    }
+    if (!cbuf_shm_map(shm, fd, (uint64_t)st.st_size)) {
+        return false;
+    }
+
+    if (!cbuf_shm_header_valid(shm->header, shm->mapSize)) {
+        munmap(shm->header, (size_t)shm->mapSize);
+        shm->header = NULL;
+        shm->bufPtr = NULL;
+        return false;
+    }
+    shm->size = shm->header->size;
+    shm->mask = shm->header->mask;
+    return true;
+}
+
+/** \brief Attach to a named circular buffer created with cbuf_shm_create().
+ *
+ * \param[in] shm: handle to cbuf_shm_t.
+ * \param[in] name: shm_open() name used by the creator.
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_shm_attach(cbuf_shm_t *shm, char const *name) {
+    if (NULL == shm || NULL == name) {
+        return false;
+    }
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    if (!cbuf_shm_attach_fd(shm, fd)) {
+        close(fd);
+        return false;
+    }
+    return true;
+}
+
+/** \brief Unmap a circular buffer and close its descriptor.
+ * The shared memory stays alive while other processes have it mapped.
+ *
+ * \param[in] shm: handle to cbuf_shm_t.
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_shm_detach(cbuf_shm_t *shm) {
+    if (NULL == shm || NULL == shm->header) {
+        return false;
+    }
+    bool ok = (0 == munmap(shm->header, (size_t)shm->mapSize));
+    ok = (0 == close(shm->fd)) && ok;
+    shm->header  = NULL;
+    shm->bufPtr  = NULL;
+    shm->mapSize = 0;
+    shm->fd      = -1;
+    return ok;
+}
+
+/** \brief Remove the name of a shared circular buffer.
+ *
+ * \param[in] name: shm_open() name passed to cbuf_shm_create().
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_shm_unlink(char const *name) {
+    return (NULL != name) && (0 == shm_unlink(name));
+}
+
+/** \brief Write data to shared circular buffer (single producer).
+ * May run concurrently with cbuf_shm_read() in another thread or process.
+ *
+ * \param[in] shm: handle to cbuf_shm_t.
+ * \param[in] data: pointer to data to be written into buffer.
+ * \param[in] numOfBytes: number of bytes to be written into buffer.
+ * \return number of bytes written into buffer, `0` also if the shared indices are corrupt.
+ */
+uint64_t cbuf_shm_write(cbuf_shm_t *shm, void const *data, uint64_t numOfBytes) {
+    if (NULL == shm || NULL == shm->header) {
+        return 0;
+    }
+    cbuf_shm_header_t *h = shm->header;
+    cbuf_t cb = cbuf_shm_view(shm);
+    cb.writePos = CBUF_LOAD_RELAXED(&h->writePos);
+    cb.readPos  = CBUF_LOAD_ACQUIRE(&h->readPos);
+    if (!cbuf_shm_indices_valid(cb.size, cb.mask, cb.writePos, cb.readPos)) {
+        return 0;
+    }
+    uint64_t written = cbuf_write(&cb, data, numOfBytes);
+    if (0 != written) {
+        CBUF_STORE_RELEASE(&h->writePos, cb.writePos);
+    }
+    return written;
+}
+
+/** \brief Read data from shared circular buffer (single consumer).
+ * May run concurrently with cbuf_shm_write() in another thread or process.
+ *
+ * \param[in] shm: handle to cbuf_shm_t.
+ * \param[out] buffer: pointer to buffer for storing data to be read.
+ * \param[in] numOfBytes: number of bytes to be read from circular buffer.
+ * \return number of bytes read from buffer, `0` also if the shared indices are corrupt.
+ */
+uint64_t cbuf_shm_read(cbuf_shm_t *shm, void * const buffer, uint64_t numOfBytes) {
+    if (NULL == shm || NULL == shm->header) {
+        return 0;
+    }
+    cbuf_shm_header_t *h = shm->header;
+    cbuf_t cb = cbuf_shm_view(shm);
+    cb.readPos  = CBUF_LOAD_RELAXED(&h->readPos);
+    cb.writePos = CBUF_LOAD_ACQUIRE(&h->writePos);
+    if (!cbuf_shm_indices_valid(cb.size, cb.mask, cb.writePos, cb.readPos)) {
+        return 0;
+    }
+    uint64_t bytesRead = cbuf_read(&cb, buffer, numOfBytes);
+    if (0 != bytesRead) {
+        CBUF_STORE_RELEASE(&h->readPos, cb.readPos);
+    }
+    return bytesRead;
+}
+
+// Filled bytes for a snapshot of both indices, `false` if they are corrupt.
+static bool cbuf_shm_filled(cbuf_shm_t const *shm, uint64_t *filled) {
+    cbuf_t const cb = cbuf_shm_view(shm);
+    uint64_t const writePos = CBUF_LOAD_ACQUIRE(&shm->header->writePos);
+    uint64_t const readPos  = CBUF_LOAD_ACQUIRE(&shm->header->readPos);
+    if (!cbuf_shm_indices_valid(cb.size, cb.mask, writePos, readPos)) {
+        return false;
+    }
+    *filled = cbuf_filled_between(&cb, writePos, readPos);
+    return true;
+}
+
+/** \brief Get number of bytes stored in shared circular buffer.
+ *
+ * \param[in] shm: handle to cbuf_shm_t.
+ * \return number of bytes stored, a snapshot if the other side is active,
+ *         `0` if the shared indices are corrupt.
+ */
+uint64_t cbuf_shm_get_filled(cbuf_shm_t *shm) {
+    uint64_t filled;
+    if (NULL == shm || NULL == shm->header || !cbuf_shm_filled(shm, &filled)) {
+        return 0;
+    }
+    return filled;
+}
+
+/** \brief Get number of free bytes in shared circular buffer.
+ *
+ * \param[in] shm: handle to cbuf_shm_t.
+ * \return number of free bytes, a snapshot if the other side is active,
+ *         `0` if the shared indices are corrupt.
+ */
+uint64_t cbuf_shm_get_free(cbuf_shm_t *shm) {
+    uint64_t filled;
+    if (NULL == shm || NULL == shm->header || !cbuf_shm_filled(shm, &filled)) {
+        return 0;
+    }
+    cbuf_t const cb = cbuf_shm_view(shm);
+    return cbuf_capacity(&cb) - filled;
+}
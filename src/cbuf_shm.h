@@ -0,0 +1,52 @@
+#ifndef CBUF_SHM_H
+#define CBUF_SHM_H
+
+#include "cbuf.h"
+
+#define CBUF_SHM_MAGIC   0x314d485346554243ULL // "CBUFSHM1" in memory on little-endian
+#define CBUF_SHM_VERSION 1u
+
+// Position-independent ring placed at the start of a shared mapping, the
+// data follows at dataOffset. Only offsets are stored, so every process can
+// map it at a different address. The indices use the schemes of cbuf_init()
+// and cbuf_init_pow2() (selected by mask) and sit on their own cache lines.
+typedef struct cbuf_shm_header {
+  uint64_t magic;      // CBUF_SHM_MAGIC once the header is initialized
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t dataOffset; // from the start of the header
+  uint64_t size;
+  uint64_t mask;
+  uint8_t  pad0[CBUF_CACHE_LINE - 40];
+  uint64_t writePos;   // Owned by producer
+  uint8_t  pad1[CBUF_CACHE_LINE - 8];
+  uint64_t readPos;    // Owned by consumer
+  uint8_t  pad2[CBUF_CACHE_LINE - 8];
+} cbuf_shm_header_t;
+
+// Process-local handle to a mapped ring. size and mask are copied from the
+// header once it has been checked, so a peer cannot change them later.
+typedef struct cbuf_shm {
+  cbuf_shm_header_t *header;
+  uint8_t *bufPtr;
+  uint64_t mapSize;
+  uint64_t size;
+  uint64_t mask;
+  int fd;
+} cbuf_shm_t;
+
+// Linux/POSIX only. name selects a shm_open() object, `NULL` an anonymous
+// memfd that is shared through fork() or by passing shm->fd.
+bool     cbuf_shm_create(cbuf_shm_t *shm, char const *name, uint64_t const sizeInBytes);
+bool     cbuf_shm_attach(cbuf_shm_t *shm, char const *name);
+bool     cbuf_shm_attach_fd(cbuf_shm_t *shm, int fd);
+bool     cbuf_shm_detach(cbuf_shm_t *shm);
+bool     cbuf_shm_unlink(char const *name);
+
+// Single producer and single consumer, possibly in different processes.
+uint64_t cbuf_shm_write(cbuf_shm_t *shm, void const *data, uint64_t numOfBytes);
+uint64_t cbuf_shm_read(cbuf_shm_t *shm, void * const buffer, uint64_t numOfBytes);
+uint64_t cbuf_shm_get_filled(cbuf_shm_t *shm);
+uint64_t cbuf_shm_get_free(cbuf_shm_t *shm);
+
+#endif // CBUF_SHM_H
@@ -0,0 +1,92 @@
+#include "cbuf_spsc.h"
+#include "cbuf_internal.h"
+#include <stddef.h>
+#include <string.h>
+
+_Static_assert(offsetof(cbuf_spsc_t, writePos) == CBUF_CACHE_LINE, "producer fields on their own line");
+_Static_assert(offsetof(cbuf_spsc_t, readPos) == 2 * CBUF_CACHE_LINE, "consumer fields on their own line");
+
+/** \brief Initialize a cache-line separated SPSC circular buffer.
+ *
+ * \param[in] q: handle to cbuf_spsc_t, should be CBUF_CACHE_LINE aligned (static or aligned_alloc()).
+ * \param[in] buffer: internal buffer to store data, must not be directly manipulated.
+ * \param[in] sizeInBytes: size of buffer in bytes, a power of two (>= 2).
+ * \return `true` if successful, `false` otherwise.
+ */
+bool cbuf_spsc_init(cbuf_spsc_t *q, void *buffer, uint64_t const sizeInBytes) {
+    if (NULL == q || NULL == buffer || sizeInBytes < 2 || 0 != (sizeInBytes & (sizeInBytes - 1))) {
+        return false;
+    }
+    q->bufPtr = (uint8_t *)buffer;
+    q->size   = sizeInBytes;
+    q->mask   = sizeInBytes - 1;
+    q->cachedReadPos  = 0;
+    q->cachedWritePos = 0;
+    CBUF_STORE_RELEASE(&q->writePos, 0);
+    CBUF_STORE_RELEASE(&q->readPos, 0);
+    return true;
+}
+
+/** \brief Write data to circular buffer, may run concurrently with cbuf_spsc_read().
+ *
+ * \param[in] q: handle to cbuf_spsc_t.
+ * \param[in] data: pointer to data to be written into buffer.
+ * \param[in] numOfBytes: number of bytes to be written into buffer.
+ * \return number of bytes written into buffer.
+ */
+uint64_t cbuf_spsc_write(cbuf_spsc_t *q, void const *data, uint64_t numOfBytes) {
+    uint64_t const writePos = CBUF_LOAD_RELAXED(&q->writePos);
+    uint64_t freeBytes = q->size - (writePos - q->cachedReadPos);
+    if (freeBytes < numOfBytes) {
+        // Looks full, only now touch the consumer's line
+        q->cachedReadPos = CBUF_LOAD_ACQUIRE(&q->readPos);
+        freeBytes = q->size - (writePos - q->cachedReadPos);
+    }
+    uint64_t bytesToWrite = CBUF_MIN(numOfBytes, freeBytes);
+    if (0 == bytesToWrite) {
+        return 0;
+    }
+    uint64_t offset = writePos & q->mask;
+    uint64_t bytesTillEnd = CBUF_MIN(bytesToWrite, q->size - offset);
+    memcpy(&q->bufPtr[offset], data, bytesTillEnd);
+    memcpy(q->bufPtr, (uint8_t const *)data + bytesTillEnd, bytesToWrite - bytesTillEnd);
+    CBUF_STORE_RELEASE(&q->writePos, writePos + bytesToWrite);
+    return bytesToWrite;
+}
+
+/** \brief Read data from circular buffer, may run concurrently with cbuf_spsc_write().
+ *
+ * \param[in] q: handle to cbuf_spsc_t.
+ * \param[out] buffer: pointer to buffer for storing data to be read.
+ * \param[in] numOfBytes: number of bytes to be read from circular buffer.
+ * \return number of bytes read from buffer.
+ */
+uint64_t cbuf_spsc_read(cbuf_spsc_t *q, void * const buffer, uint64_t numOfBytes) {
+    uint64_t const readPos = CBUF_LOAD_RELAXED(&q->readPos);
+    uint64_t filled = q->cachedWritePos - readPos;
+    if (filled < numOfBytes) {
+        // Looks empty (or short), only now touch the producer's line
+        q->cachedWritePos = CBUF_LOAD_ACQUIRE(&q->writePos);
+        filled = q->cachedWritePos - readPos;
+    }
+    uint64_t bytesToRead = CBUF_MIN(numOfBytes, filled);
+    if (0 == bytesToRead) {
+        return 0;
+    }
+    uint64_t offset = readPos & q->mask;
+    uint64_t bytesTillEnd = CBUF_MIN(bytesToRead, q->size - offset);
+    memcpy(buffer, &q->bufPtr[offset], bytesTillEnd);
+    memcpy((uint8_t *)buffer + bytesTillEnd, q->bufPtr, bytesToRead - bytesTillEnd);
+    CBUF_STORE_RELEASE(&q->readPos, readPos + bytesToRead);
+    return bytesToRead;
+}
+
+/** \brief Get number of bytes stored in circular buffer.
+ *
+ * \param[in] q: handle to cbuf_spsc_t.
+ * \return number of bytes stored, a snapshot if the other side is active.
+ */
+uint64_t cbuf_spsc_get_filled(cbuf_spsc_t *q) {
+    uint64_t const readPos = CBUF_LOAD_ACQUIRE(&q->readPos);
+    return CBUF_LOAD_ACQUIRE(&q->writePos) - readPos;
+}
@@ -0,0 +1,34 @@
+#ifndef CBUF_SPSC_H
+#define CBUF_SPSC_H
+
+#include "cbuf.h"
+
+// Concurrent single-producer/single-consumer variant of cbuf_t.
+// cbuf_write_spsc()/cbuf_read_spsc() share one compact cbuf_t between both
+// cores, so every update of writePos invalidates the line holding readPos
+// and vice versa. Here each side owns a separate cache line holding its own
+// index plus a cached copy of the other side's index, which is only
+// reloaded when the ring looks full (producer) or empty (consumer).
+// The size must be a power of two, indices run freely and are masked.
+typedef struct cbuf_spsc {
+  // Read-only after cbuf_spsc_init()
+  uint8_t *bufPtr;
+  uint64_t size;
+  uint64_t mask;
+  uint8_t  pad0[CBUF_CACHE_LINE - 24];
+  // Producer line
+  uint64_t writePos;
+  uint64_t cachedReadPos;
+  uint8_t  pad1[CBUF_CACHE_LINE - 16];
+  // Consumer line
+  uint64_t readPos;
+  uint64_t cachedWritePos;
+  uint8_t  pad2[CBUF_CACHE_LINE - 16];
+} __attribute__((aligned(CBUF_CACHE_LINE))) cbuf_spsc_t;
+
+bool     cbuf_spsc_init(cbuf_spsc_t *q, void *buffer, uint64_t const sizeInBytes);
+uint64_t cbuf_spsc_write(cbuf_spsc_t *q, void const *data, uint64_t numOfBytes);
+uint64_t cbuf_spsc_read(cbuf_spsc_t *q, void * const buffer, uint64_t numOfBytes);
+uint64_t cbuf_spsc_get_filled(cbuf_spsc_t *q);
+
+#endif // CBUF_SPSC_H
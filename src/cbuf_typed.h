@@ -0,0 +1,105 @@
+#ifndef CBUF_TYPED_H
+#define CBUF_TYPED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Generator for rings of fixed-size elements:
+//
+//     CBUF_DECLARE(sample_ring, uint32_t)
+//     static uint32_t storage[1024];
+//     sample_ring_t ring;
+//     sample_ring_init(&ring, storage, 1024);
+//
+// declares sample_ring_t and static inline sample_ring_*() functions that
+// work in elements instead of bytes. Storage is a typed array, so every
+// access is aligned; single elements are copied by assignment, batches with
+// at most two memcpy(). The element count must be a power of two, indices
+// run freely and are masked on access (cbuf_init_pow2() scheme), the whole
+// storage is usable. Not thread-safe, same as cbuf_write()/cbuf_read().
+
+#define CBUF_DECLARE(name, type)                                                            \
+typedef struct name {                                                                       \
+  type    *bufPtr;                                                                          \
+  uint64_t writePos;                                                                        \
+  uint64_t readPos;                                                                         \
+  uint64_t mask;       /* number of elements - 1 */                                         \
+} name##_t;                                                                                 \
+                                                                                            \
+static inline bool name##_init(name##_t *r, type *storage, uint64_t numElems) {             \
+    if (NULL == r || NULL == storage || numElems < 2 || 0 != (numElems & (numElems - 1))) { \
+        return false;                                                                       \
+    }                                                                                       \
+    r->bufPtr   = storage;                                                                  \
+    r->mask     = numElems - 1;                                                             \
+    r->writePos = 0;                                                                        \
+    r->readPos  = 0;                                                                        \
+    return true;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline uint64_t name##_capacity(name##_t const *r) {                                 \
+    return r->mask + 1;                                                                     \
+}                                                                                           \
+                                                                                            \
+static inline uint64_t name##_get_filled(name##_t const *r) {                               \
+    return r->writePos - r->readPos;                                                        \
+}                                                                                           \
+                                                                                            \
+static inline uint64_t name##_get_free(name##_t const *r) {                                 \
+    return name##_capacity(r) - name##_get_filled(r);                                       \
+}                                                                                           \
+                                                                                            \
+static inline bool name##_is_empty(name##_t const *r) {                                     \
+    return r->writePos == r->readPos;                                                       \
+}                                                                                           \
+                                                                                            \
+static inline bool name##_is_full(name##_t const *r) {                                      \
+    return name##_get_filled(r) > r->mask;                                                  \
+}                                                                                           \
+                                                                                            \
+static inline bool name##_push(name##_t *r, type const *elem) {                             \
+    if (name##_is_full(r)) {                                                                \
+        return false;                                                                       \
+    }                                                                                       \
+    r->bufPtr[r->writePos & r->mask] = *elem;                                               \
+    r->writePos++;                                                                          \
+    return true;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline bool name##_pop(name##_t *r, type *elem) {                                    \
+    if (name##_is_empty(r)) {                                                               \
+        return false;                                                                       \
+    }                                                                                       \
+    *elem = r->bufPtr[r->readPos & r->mask];                                                \
+    r->readPos++;                                                                           \
+    return true;                                                                            \
+}                                                                                           \
+                                                                                            \
+static inline uint64_t name##_push_n(name##_t *r, type const *elems, uint64_t n) {          \
+    uint64_t const freeElems = name##_get_free(r);                                          \
+    uint64_t const offset = r->writePos & r->mask;                                          \
+    uint64_t tillEnd;                                                                       \
+    n = (n < freeElems) ? n : freeElems;                                                    \
+    tillEnd = name##_capacity(r) - offset;                                                  \
+    tillEnd = (n < tillEnd) ? n : tillEnd;                                                  \
+    memcpy(&r->bufPtr[offset], elems, (size_t)tillEnd * sizeof(type));                      \
+    memcpy(r->bufPtr, &elems[tillEnd], (size_t)(n - tillEnd) * sizeof(type));               \
+    r->writePos += n;                                                                       \
+    return n;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline uint64_t name##_pop_n(name##_t *r, type *elems, uint64_t n) {                 \
+    uint64_t const filledElems = name##_get_filled(r);                                      \
+    uint64_t const offset = r->readPos & r->mask;                                           \
+    uint64_t tillEnd;                                                                       \
+    n = (n < filledElems) ? n : filledElems;                                                \
+    tillEnd = name##_capacity(r) - offset;                                                  \
+    tillEnd = (n < tillEnd) ? n : tillEnd;                                                  \
+    memcpy(elems, &r->bufPtr[offset], (size_t)tillEnd * sizeof(type));                      \
+    memcpy(&elems[tillEnd], r->bufPtr, (size_t)(n - tillEnd) * sizeof(type));               \
+    r->readPos += n;                                                                        \
+    return n;                                                                               \
+}
+
+#endif // CBUF_TYPED_H
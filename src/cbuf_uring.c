@@ -0,0 +1,501 @@
+#include "cbuf_uring.h"
+#include "cbuf_internal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+// Newer than some installed uapi headers (kernel 6.12)
+#ifndef IOU_PBUF_RING_INC
+#define IOU_PBUF_RING_INC 2
+#endif
+
+#define CBUF_URING_MAX_IO      (1u << 30)  // per operation, completions report an int32_t
+#define CBUF_URING_OP_MASK     7u          // op bits kept in the low bits of user_data
+#define CBUF_URING_MAX_ENTRIES 32768       // provided buffer ring limit
+
+_Static_assert(_Alignof(cbuf_uring_buf_t) > CBUF_URING_OP_MASK, "op bits fit below the handle address");
+
+// Fixed ABI layout of struct io_uring_buf_reg. Its field for IOU_PBUF_RING_INC
+// is `pad` in older uapi headers and `flags` since Linux 6.4, so neither name
+// is used.
+typedef struct cbuf_uring_buf_reg {
+  uint64_t ringAddr;
+  uint32_t ringEntries;
+  uint16_t bgid;
+  uint16_t flags;
+  uint64_t resv[3];
+} cbuf_uring_buf_reg_t;
+
+_Static_assert(sizeof(cbuf_uring_buf_reg_t) == sizeof(struct io_uring_buf_reg), "io_uring_buf_reg layout");
+
+static uint64_t cbuf_uring_max(uint64_t x, uint64_t y) {
+    return (x > y) ? x : y;
+}
+
+/** \brief Set up an io_uring instance.
+ *
+ * \param[in] u: handle to cbuf_uring_t.
+ * \param[in] entries: submission queue size, rounded up to a power of two by the kernel.
+ * \return `true` if successful, `false` otherwise (errno is kept).
+ *
+ * Must be released with cbuf_uring_exit(), also if it failed.
+ */
+bool cbuf_uring_init(cbuf_uring_t *u, uint32_t entries) {
+    struct io_uring_params params;
+
+    if (NULL == u) {
+        return false;
+    }
+    memset(u, 0, sizeof(*u));
+    u->fd = -1;
+    if (0 == entries) {
+        return false;
+    }
+    memset(&params, 0, sizeof(params));
+    u->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (u->fd < 0) {
+        return false;
+    }
+
+    u->sqMapSize   = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    u->cqMapSize   = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    u->sqesMapSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        u->sqMapSize = u->cqMapSize = cbuf_uring_max(u->sqMapSize, u->cqMapSize);
+    }
+
+    u->sqMap = mmap(NULL, (size_t)u->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    u->fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == u->sqMap) {
+        u->sqMap = NULL;
+        cbuf_uring_exit(u);
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cqMap = u->sqMap;
+    }
+    else {
+        u->cqMap = mmap(NULL, (size_t)u->cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        u->fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == u->cqMap) {
+            u->cqMap = NULL;
+            cbuf_uring_exit(u);
+            return false;
+        }
+    }
+    u->sqes = mmap(NULL, (size_t)u->sqesMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->fd, IORING_OFF_SQES);
+    if (MAP_FAILED == u->sqes) {
+        u->sqes = NULL;
+        cbuf_uring_exit(u);
+        return false;
+    }
+
+    uint8_t *sq = (uint8_t *)u->sqMap;
+    uint8_t *cq = (uint8_t *)u->cqMap;
+    u->sqHead    = (uint32_t *)(sq + params.sq_off.head);
+    u->sqTail    = (uint32_t *)(sq + params.sq_off.tail);
+    u->sqArray   = (uint32_t *)(sq + params.sq_off.array);
+    u->sqMask    = *(uint32_t *)(sq + params.sq_off.ring_mask);
+    u->sqEntries = params.sq_entries;
+    u->cqHead    = (uint32_t *)(cq + params.cq_off.head);
+    u->cqTail    = (uint32_t *)(cq + params.cq_off.tail);
+    u->cqMask    = *(uint32_t *)(cq + params.cq_off.ring_mask);
+    u->cqes      = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    // Slots are always handed out in order, the indirection array stays identity
+    for (uint32_t i = 0; i < u->sqEntries; i++) {
+        u->sqArray[i] = i;
+    }
+    return true;
+}
+
+/** \brief Tear down an io_uring instance.
+ * Operations still in flight are cancelled by the kernel, registered buffers
+ * are dropped. Provided buffer rings are freed with cbuf_uring_buf_release().
+ *
+ * \param[in] u: handle to cbuf_uring_t.
+ *
+ * Only valid on a handle passed to cbuf_uring_init() before, a zeroed
+ * handle would close fd 0.
+ */
+void cbuf_uring_exit(cbuf_uring_t *u) {
+    if (NULL == u) {
+        return;
+    }
+    if (NULL != u->sqes) {
+        munmap(u->sqes, (size_t)u->sqesMapSize);
+    }
+    if (NULL != u->cqMap && u->cqMap != u->sqMap) {
+        munmap(u->cqMap, (size_t)u->cqMapSize);
+    }
+    if (NULL != u->sqMap) {
+        munmap(u->sqMap, (size_t)u->sqMapSize);
+    }
+    if (u->fd >= 0) {
+        close(u->fd);
+    }
+    memset(u, 0, sizeof(*u));
+    u->fd = -1;
+}
+
+/** \brief Bind a circular buffer to a pump handle.
+ *
+ * \param[in] buf: handle to cbuf_uring_buf_t.
+ * \param[in] cb: handle to cbuf_t, any index scheme (multishot recv needs cbuf_init_pow2()).
+ * \param[in] userData: passed back through buf->userData.
+ */
+void cbuf_uring_buf_init(cbuf_uring_buf_t *buf, cbuf_t *cb, void *userData) {
+    memset(buf, 0, sizeof(*buf));
+    buf->cb       = cb;
+    buf->userData = userData;
+    buf->bufIndex = -1;
+}
+
+/** \brief Free the provided buffer ring of a handle, if any.
+ * Nothing may be in flight on the handle.
+ *
+ * \param[in] u: handle to cbuf_uring_t the buffers were provided to.
+ * \param[in] buf: handle to cbuf_uring_buf_t.
+ */
+void cbuf_uring_buf_release(cbuf_uring_t *u, cbuf_uring_buf_t *buf) {
+    if (NULL == buf->bufRing) {
+        return;
+    }
+    if (NULL != u && u->fd >= 0) {
+        cbuf_uring_buf_reg_t reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.bgid = buf->bufGroup;
+        syscall(__NR_io_uring_register, u->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+    munmap(buf->bufRing, (size_t)buf->bufRingSize);
+    buf->bufRing = NULL;
+}
+
+/** \brief Register the data areas of rings as fixed buffers.
+ * Fills and drains of registered rings skip the per-operation page pinning.
+ * Can be done once per io_uring instance, all rings at the same time.
+ *
+ * \param[in] u: handle to cbuf_uring_t.
+ * \param[in] bufs: handles to register, buffer index = position in bufs.
+ * \param[in] count: number of handles.
+ * \return `true` if successful, `false` otherwise (errno is kept).
+ */
+bool cbuf_uring_register_buffers(cbuf_uring_t *u, cbuf_uring_buf_t * const bufs[], uint32_t count) {
+    if (NULL == u || NULL == bufs || 0 == count) {
+        return false;
+    }
+    struct iovec *iov = malloc(count * sizeof(*iov));
+    if (NULL == iov) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        cbuf_t const *cb = bufs[i]->cb;
+        iov[i].iov_base = cb->bufPtr;
+        // A mirrored ring is registered with its second mapping, so every span fits
+        iov[i].iov_len  = (size_t)((cb->flags & CBUF_FLAG_MIRRORED) ? 2 * cb->size : cb->size);
+    }
+    long ret = syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_BUFFERS, iov, count);
+    free(iov);
+    if (ret < 0) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        bufs[i]->bufIndex = (int32_t)i;
+    }
+    return true;
+}
+
+// Next free submission slot, cleared, or `NULL` if the queue is full.
+static struct io_uring_sqe *cbuf_uring_get_sqe(cbuf_uring_t *u) {
+    uint32_t const tail = CBUF_LOAD_RELAXED(u->sqTail) + u->sqPending;
+    if (tail - CBUF_LOAD_ACQUIRE(u->sqHead) >= u->sqEntries) {
+        return NULL;
+    }
+    struct io_uring_sqe *sqe = &u->sqes[tail & u->sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    u->sqPending++;
+    return sqe;
+}
+
+// Fixed buffer transfer of the first span, or vectored transfer of both.
+static void cbuf_uring_prep_rw(struct io_uring_sqe *sqe, cbuf_uring_buf_t *buf, int fd, bool fill,
+                               uint8_t *ptr[2], uint64_t len[2], struct iovec iov[2]) {
+    sqe->fd  = fd;
+    sqe->off = (uint64_t)-1; // current file position, as read()/write()
+    if (buf->bufIndex >= 0) {
+        sqe->opcode    = fill ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->addr      = (uintptr_t)ptr[0];
+        sqe->len       = (uint32_t)len[0];
+        sqe->buf_index = (uint16_t)buf->bufIndex;
+        return;
+    }
+    uint32_t count = 0;
+    for (int i = 0; i < 2; i++) {
+        if (0 != len[i]) {
+            iov[count].iov_base = ptr[i];
+            iov[count].iov_len  = (size_t)len[i];
+            count++;
+        }
+    }
+    sqe->opcode = fill ? IORING_OP_READV : IORING_OP_WRITEV;
+    sqe->addr   = (uintptr_t)iov;
+    sqe->len    = count;
+}
+
+/** \brief Queue a read from a file descriptor into the free space of a ring.
+ * writePos is advanced by cbuf_uring_reap() once the read completes. A
+ * registered ring is filled up to the end of buffer per operation, an
+ * unregistered one across the wrap with a vectored read.
+ *
+ * \param[in] u: handle to cbuf_uring_t.
+ * \param[in] buf: handle to cbuf_uring_buf_t.
+ * \param[in] fd: file descriptor to read from (file, pipe, socket, ...).
+ * \param[in] numOfBytes: maximum number of bytes to transfer.
+ * \return `true` if queued, `false` if the ring is full, a fill is already
+ * in flight or the submission queue is full.
+ */
+bool cbuf_uring_prep_write_from_fd(cbuf_uring_t *u, cbuf_uring_buf_t *buf, int fd, uint64_t numOfBytes) {
+    uint8_t *ptr[2];
+    uint64_t len[2];
+
+    if (buf->inFlight & (CBUF_URING_OP_FILL | CBUF_URING_OP_RECV_MULTI)) {
+        return false;
+    }
+    if (0 == cbuf_write_reserve(buf->cb, CBUF_MIN(numOfBytes, CBUF_URING_MAX_IO), ptr, len)) {
+        return false;
+    }
+    struct io_uring_sqe *sqe = cbuf_uring_get_sqe(u);
+    if (NULL == sqe) {
+        return false;
+    }
+    cbuf_uring_prep_rw(sqe, buf, fd, true, ptr, len, buf->fillIov);
+    sqe->user_data = (uintptr_t)buf | CBUF_URING_OP_FILL;
+    buf->inFlight |= CBUF_URING_OP_FILL;
+    return true;
+}
+
+/** \brief Queue a write of the data stored in a ring to a file descriptor.
+ * readPos is advanced by cbuf_uring_reap() once the write completes.
+ *
+ * \param[in] u: handle to cbuf_uring_t.
+ * \param[in] buf: handle to cbuf_uring_buf_t.
+ * \param[in] fd: file descriptor to write to.
+ * \param[in] numOfBytes: maximum number of bytes to transfer.
+ * \return `true` if queued, `false` if the ring is empty, a drain is already
+ * in flight or the submission queue is full.
+ */
+bool cbuf_uring_prep_read_to_fd(cbuf_uring_t *u, cbuf_uring_buf_t *buf, int fd, uint64_t numOfBytes) {
+    uint8_t const *ptr[2];
+    uint64_t len[2];
+
+    if (buf->inFlight & CBUF_URING_OP_DRAIN) {
+        return false;
+    }
+    uint64_t filled = cbuf_read_acquire(buf->cb, ptr, len);
+    if (0 == filled) {
+        return false;
+    }
+    // Same trimming as the fill side gets from cbuf_write_reserve()
+    uint64_t limit = CBUF_MIN(numOfBytes, CBUF_URING_MAX_IO);
+    len[0] = CBUF_MIN(len[0], limit);
+    len[1] = CBUF_MIN(len[1], limit - len[0]);
+    if (0 == len[0]) {
+        return false;
+    }
+    struct io_uring_sqe *sqe = cbuf_uring_get_sqe(u);
+    if (NULL == sqe) {
+        return false;
+    }
+    cbuf_uring_prep_rw(sqe, buf, fd, false, (uint8_t **)ptr, len, buf->drainIov);
+    sqe->user_data = (uintptr_t)buf | CBUF_URING_OP_DRAIN;
+    buf->inFlight |= CBUF_URING_OP_DRAIN;
+    return true;
+}
+
+// Hand out free space to the kernel in chunk sized pieces, in stream order.
+// Only pieces reaching the end of their chunk are provided, so at most
+// size / chunkSize + 1 entries are ever outstanding.
+static void cbuf_uring_provide(cbuf_uring_buf_t *buf) {
+    cbuf_t const *cb = buf->cb;
+    uint64_t const limit = CBUF_LOAD_ACQUIRE(&cb->readPos) + cb->size;
+    uint16_t tail = buf->bufTail;
+
+    for (;;) {
+        uint64_t offset = buf->providedPos & cb->mask;
+        uint64_t n = buf->chunkSize - (offset & (buf->chunkSize - 1));
+        if (buf->providedPos + n > limit) {
+            break;
+        }
+        struct io_uring_buf *entry = &buf->bufRing->bufs[tail & (buf->bufEntries - 1)];
+        entry->addr = (uintptr_t)&cb->bufPtr[offset];
+        entry->len  = (uint32_t)n;
+        entry->bid  = (uint16_t)(offset / buf->chunkSize);
+        tail++;
+        buf->providedPos += n;
+    }
+    if (tail != buf->bufTail) {
+        buf->bufTail = tail;
+        CBUF_STORE_RELEASE(&buf->bufRing->tail, tail);
+    }
+}
+
+// Set up the provided buffer ring backing multishot recv.
+static bool cbuf_uring_setup_buf_ring(cbuf_uring_t *u, cbuf_uring_buf_t *buf, uint32_t chunkSize) {
+    cbuf_t const *cb = buf->cb;
+    uint64_t entries = 1;
+
+    while (entries < cb->size / chunkSize + 1) {
+        entries <<= 1;
+    }
+    if (entries > CBUF_URING_MAX_ENTRIES) {
+        errno = EINVAL;
+        return false;
+    }
+    uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    buf->bufRingSize = (entries * sizeof(struct io_uring_buf) + pageSize - 1) / pageSize * pageSize;
+    void *ring = mmap(NULL, (size_t)buf->bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == ring) {
+        return false;
+    }
+
+    cbuf_uring_buf_reg_t reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ringAddr    = (uintptr_t)ring;
+    reg.ringEntries = (uint32_t)entries;
+    reg.bgid        = u->nextBufGroup;
+    reg.flags       = IOU_PBUF_RING_INC; // buffers are consumed in part
+    if (syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        int err = errno;
+        munmap(ring, (size_t)buf->bufRingSize);
+        errno = err;
+        return false;
+    }
+    buf->bufRing     = (struct io_uring_buf_ring *)ring;
+    buf->bufEntries  = (uint16_t)entries;
+    buf->bufTail     = 0;
+    buf->bufGroup    = u->nextBufGroup++;
+    buf->chunkSize   = chunkSize;
+    buf->providedPos = CBUF_LOAD_RELAXED(&cb->writePos);
+    return true;
+}
+
+/** \brief Arm a multishot recv that keeps filling a ring as data arrives.
+ * The free space is provided to the kernel as a buffer ring that is consumed
+ * incrementally, so received data lands back to back at writePos. Every
+ * completion advances writePos and hands freed space back to the kernel.
+ * When the ring runs full the recv ends with -ENOBUFS, and has to be armed
+ * again once the consumer made room.
+ *
+ * \param[in] u: handle to cbuf_uring_t.
+ * \param[in] buf: handle to cbuf_uring_buf_t, the ring must use cbuf_init_pow2().
+ * \param[in] fd: socket to receive from.
+ * \param[in] chunkSize: granularity free space is provided in, power of two
+ *            not larger than the ring. Only used when first armed.
+ * \return `true` if queued, `false` otherwise. errno is set to EINVAL if the
+ * kernel lacks incrementally consumed buffer rings (before 6.12), plain
+ * fills can be used instead then.
+ *
+ * Fills with cbuf_uring_prep_write_from_fd() must not be mixed in.
+ */
+bool cbuf_uring_prep_recv_multishot(cbuf_uring_t *u, cbuf_uring_buf_t *buf, int fd, uint32_t chunkSize) {
+    cbuf_t const *cb = buf->cb;
+
+    if (buf->inFlight & (CBUF_URING_OP_FILL | CBUF_URING_OP_RECV_MULTI)) {
+        return false;
+    }
+    if (NULL == buf->bufRing) {
+        if (0 == cb->mask || 0 == chunkSize || 0 != (chunkSize & (chunkSize - 1)) || chunkSize > cb->size) {
+            errno = EINVAL;
+            return false;
+        }
+        if (!cbuf_uring_setup_buf_ring(u, buf, chunkSize)) {
+            return false;
+        }
+    }
+    cbuf_uring_provide(buf);
+    struct io_uring_sqe *sqe = cbuf_uring_get_sqe(u);
+    if (NULL == sqe) {
+        return false;
+    }
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = fd;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->buf_group = buf->bufGroup;
+    sqe->user_data = (uintptr_t)buf | CBUF_URING_OP_RECV_MULTI;
+    buf->inFlight |= CBUF_URING_OP_RECV_MULTI;
+    return true;
+}
+
+/** \brief Submit the queued operations, optionally waiting for completions.
+ *
+ * \param[in] u: handle to cbuf_uring_t.
+ * \param[in] waitNr: number of completions to wait for, `0` to return immediately.
+ * \return number of operations submitted, or -1 with errno set by io_uring_enter().
+ */
+int cbuf_uring_submit(cbuf_uring_t *u, uint32_t waitNr) {
+    uint32_t const tail = CBUF_LOAD_RELAXED(u->sqTail) + u->sqPending;
+    CBUF_STORE_RELEASE(u->sqTail, tail);
+    u->sqPending = 0;
+
+    // Includes entries left over from an earlier failed call
+    uint32_t toSubmit = tail - CBUF_LOAD_ACQUIRE(u->sqHead);
+    if (0 == toSubmit && 0 == waitNr) {
+        return 0;
+    }
+    return (int)syscall(__NR_io_uring_enter, u->fd, toSubmit, waitNr,
+                        waitNr ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+/** \brief Reap completions and advance the ring indices accordingly.
+ * Fills advance writePos, drains advance readPos, by the number of bytes the
+ * kernel reported. Operations that ended are no longer in flight and can be
+ * queued again.
+ *
+ * \param[in] u: handle to cbuf_uring_t.
+ * \param[out] events: completions in the order the kernel posted them.
+ * \param[in] maxEvents: size of events.
+ * \return number of entries used in events.
+ */
+uint32_t cbuf_uring_reap(cbuf_uring_t *u, cbuf_uring_event_t *events, uint32_t maxEvents) {
+    uint32_t head = CBUF_LOAD_RELAXED(u->cqHead);
+    uint32_t const tail = CBUF_LOAD_ACQUIRE(u->cqTail);
+    uint32_t count = 0;
+
+    while (head != tail && count < maxEvents) {
+        struct io_uring_cqe const *cqe = &u->cqes[head & u->cqMask];
+        cbuf_uring_buf_t *buf = (cbuf_uring_buf_t *)(uintptr_t)(cqe->user_data & ~(uint64_t)CBUF_URING_OP_MASK);
+        uint32_t op = (uint32_t)(cqe->user_data & CBUF_URING_OP_MASK);
+        bool more = false;
+
+        if (CBUF_URING_OP_DRAIN == op) {
+            if (cqe->res > 0) {
+                cbuf_read_release(buf->cb, (uint64_t)cqe->res);
+            }
+        }
+        else {
+            if (cqe->res > 0) {
+                cbuf_write_commit(buf->cb, (uint64_t)cqe->res);
+            }
+            if (CBUF_URING_OP_RECV_MULTI == op) {
+                more = 0 != (cqe->flags & IORING_CQE_F_MORE);
+                cbuf_uring_provide(buf);
+            }
+        }
+        if (!more) {
+            buf->inFlight &= ~op;
+        }
+        events[count].buf  = buf;
+        events[count].res  = cqe->res;
+        events[count].op   = op;
+        events[count].more = more;
+        count++;
+        head++;
+    }
+    CBUF_STORE_RELEASE(u->cqHead, head);
+    return count;
+}
@@ -0,0 +1,90 @@
+#ifndef CBUF_URING_H
+#define CBUF_URING_H
+
+#include "cbuf.h"
+#include <sys/uio.h>
+
+// io_uring pump (Linux only, raw syscalls, no liburing needed).
+// Reads and writes are submitted straight against the free and filled
+// regions of a ring, the indices are advanced when the completions are
+// reaped. One thread can keep many rings busy with batched submissions.
+//
+// Every ring is bound to a cbuf_uring_buf_t. At most one fill (data into the
+// ring) and one drain (data out of the ring) can be in flight per ring, the
+// thread calling cbuf_uring_reap() acts as producer for fills and as
+// consumer for drains. Other threads may use the opposite side of the ring
+// through the `_spsc`/zero-copy calls.
+
+#define CBUF_URING_OP_FILL        (1u << 0) // cbuf_uring_prep_write_from_fd()
+#define CBUF_URING_OP_DRAIN       (1u << 1) // cbuf_uring_prep_read_to_fd()
+#define CBUF_URING_OP_RECV_MULTI  (1u << 2) // cbuf_uring_prep_recv_multishot()
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+typedef struct cbuf_uring {
+  int fd;
+  // Submission queue, shared with the kernel
+  uint32_t *sqHead;
+  uint32_t *sqTail;
+  uint32_t *sqArray;
+  uint32_t sqMask;
+  uint32_t sqEntries;
+  uint32_t sqPending;         // prepared, not yet handed to the kernel
+  struct io_uring_sqe *sqes;
+  // Completion queue, shared with the kernel
+  uint32_t *cqHead;
+  uint32_t *cqTail;
+  uint32_t cqMask;
+  struct io_uring_cqe *cqes;
+  void *sqMap;
+  void *cqMap;                // same as sqMap with IORING_FEAT_SINGLE_MMAP
+  uint64_t sqMapSize;
+  uint64_t cqMapSize;
+  uint64_t sqesMapSize;
+  uint16_t nextBufGroup;
+} cbuf_uring_t;
+
+// A ring as seen by the pump. Has to stay at the same address while
+// operations are in flight.
+typedef struct cbuf_uring_buf {
+  cbuf_t *cb;
+  void *userData;             // free for the caller
+  struct iovec fillIov[2];
+  struct iovec drainIov[2];
+  int32_t bufIndex;           // registered buffer, -1 if not registered
+  uint32_t inFlight;          // CBUF_URING_OP_* bits
+  // Provided buffers for multishot recv, set up on first use
+  struct io_uring_buf_ring *bufRing;
+  uint64_t bufRingSize;
+  uint64_t providedPos;       // stream position up to which space is handed out
+  uint32_t chunkSize;
+  uint16_t bufEntries;
+  uint16_t bufTail;
+  uint16_t bufGroup;
+} cbuf_uring_buf_t;
+
+// Completion, reported after the ring indices are advanced.
+typedef struct cbuf_uring_event {
+  cbuf_uring_buf_t *buf;
+  int32_t res;                // bytes moved, 0 at end of file, -errno on failure
+  uint32_t op;                // CBUF_URING_OP_*
+  bool more;                  // multishot recv stays armed
+} cbuf_uring_event_t;
+
+bool     cbuf_uring_init(cbuf_uring_t *u, uint32_t entries);
+void     cbuf_uring_exit(cbuf_uring_t *u);
+
+void     cbuf_uring_buf_init(cbuf_uring_buf_t *buf, cbuf_t *cb, void *userData);
+void     cbuf_uring_buf_release(cbuf_uring_t *u, cbuf_uring_buf_t *buf);
+bool     cbuf_uring_register_buffers(cbuf_uring_t *u, cbuf_uring_buf_t * const bufs[], uint32_t count);
+
+bool     cbuf_uring_prep_write_from_fd(cbuf_uring_t *u, cbuf_uring_buf_t *buf, int fd, uint64_t numOfBytes);
+bool     cbuf_uring_prep_read_to_fd(cbuf_uring_t *u, cbuf_uring_buf_t *buf, int fd, uint64_t numOfBytes);
+bool     cbuf_uring_prep_recv_multishot(cbuf_uring_t *u, cbuf_uring_buf_t *buf, int fd, uint32_t chunkSize);
+
+int      cbuf_uring_submit(cbuf_uring_t *u, uint32_t waitNr);
+uint32_t cbuf_uring_reap(cbuf_uring_t *u, cbuf_uring_event_t *events, uint32_t maxEvents);
+
+#endif // CBUF_URING_H
@@ -0,0 +1,187 @@
+#include "cbuf_wait.h"
+#include "cbuf_internal.h"
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+// Polls before going to sleep, the pause between polls doubles each round
+#define CBUF_WAIT_SPIN_ROUNDS    10
+#define CBUF_WAIT_MAX_PAUSE_BITS 6
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CBUF_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define CBUF_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define CBUF_CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+// Futexes are 32 bits wide, use the half of the index that changes.
+static uint32_t *cbuf_futex_word(uint64_t *pos) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return (uint32_t *)pos + 1;
+#else
+    return (uint32_t *)pos;
+#endif
+}
+
+// Wake the other side if it is sleeping on pos, which was just published.
+static void cbuf_wake(cbuf_t *cb, uint32_t waiter, uint64_t *pos) {
+    // Orders the index store before the waiters load, pairs with the fence
+    // in cbuf_sleep(): either the sleeper sees the new index or we see it.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&cb->waiters, __ATOMIC_RELAXED) & waiter) {
+        syscall(SYS_futex, cbuf_futex_word(pos), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+// Absolute CLOCK_MONOTONIC deadline, false if there is none.
+static bool cbuf_deadline(int timeoutMs, struct timespec *deadline) {
+    if (timeoutMs < 0) {
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec  += timeoutMs / 1000;
+    deadline->tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+    return true;
+}
+
+// Time left until deadline, false if it has passed.
+static bool cbuf_remaining(struct timespec const *deadline, struct timespec *left) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    left->tv_sec  = deadline->tv_sec - now.tv_sec;
+    left->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+    if (left->tv_nsec < 0) {
+        left->tv_sec--;
+        left->tv_nsec += 1000000000L;
+    }
+    return (left->tv_sec >= 0);
+}
+
+typedef uint64_t (*cbuf_xfer_fn)(cbuf_t *cb, void *data, uint64_t numOfBytes);
+
+static uint64_t cbuf_xfer_read(cbuf_t *cb, void *data, uint64_t numOfBytes) {
+    return cbuf_read_spsc(cb, data, numOfBytes);
+}
+
+static uint64_t cbuf_xfer_write(cbuf_t *cb, void *data, uint64_t numOfBytes) {
+    return cbuf_write_spsc(cb, data, numOfBytes);
+}
+
+// Common part of cbuf_read_wait()/cbuf_write_wait(). self is the caller's
+// CBUF_WAITER_* bit, sleepOn the index published by the other side and
+// wakeOn the index the caller publishes.
+static uint64_t cbuf_wait_xfer(cbuf_t *cb, cbuf_xfer_fn xfer, void *data, uint64_t numOfBytes, int timeoutMs,
+                               uint32_t self, uint64_t *sleepOn, uint64_t *wakeOn) {
+    uint32_t other = (CBUF_WAITER_READER == self) ? CBUF_WAITER_WRITER : CBUF_WAITER_READER;
+    struct timespec deadline, left;
+    bool timed;
+    uint64_t done;
+
+    if (NULL == cb || NULL == data || 0 == numOfBytes) {
+        return 0;
+    }
+
+    // Fast path, no syscall unless the other side sleeps
+    for (uint32_t round = 0; round < CBUF_WAIT_SPIN_ROUNDS; round++) {
+        done = xfer(cb, data, numOfBytes);
+        if (0 != done) {
+            cbuf_wake(cb, other, wakeOn);
+            return done;
+        }
+        if (0 == timeoutMs) {
+            return 0;
+        }
+        uint32_t pauses = 1u << CBUF_MIN(round, CBUF_WAIT_MAX_PAUSE_BITS);
+        for (uint32_t i = 0; i < pauses; i++) {
+            CBUF_CPU_RELAX();
+        }
+    }
+
+    timed = cbuf_deadline(timeoutMs, &deadline);
+    __atomic_fetch_or(&cb->waiters, self, __ATOMIC_SEQ_CST);
+    for (;;) {
+        uint32_t observed = __atomic_load_n(cbuf_futex_word(sleepOn), __ATOMIC_ACQUIRE);
+        // Pairs with the fence in cbuf_wake(), see there
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        done = xfer(cb, data, numOfBytes);
+        if (0 != done) {
+            break;
+        }
+        if (timed && !cbuf_remaining(&deadline, &left)) {
+            break;
+        }
+        // Returns right away if the index moved since it was observed
+        if (-1 == syscall(SYS_futex, cbuf_futex_word(sleepOn), FUTEX_WAIT_PRIVATE, observed,
+                          timed ? &left : NULL, NULL, 0) && ETIMEDOUT == errno) {
+            done = xfer(cb, data, numOfBytes);
+            break;
+        }
+    }
+    __atomic_fetch_and(&cb->waiters, ~self, __ATOMIC_SEQ_CST);
+
+    if (0 != done) {
+        cbuf_wake(cb, other, wakeOn);
+    }
+    return done;
+}
+
+/** \brief Read from circular buffer, waiting for data if it is empty.
+ * Same as cbuf_read_spsc(), except that the caller sleeps until at least
+ * one byte is available or the timeout expires.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[out] buffer: destination.
+ * \param[in] numOfBytes: maximum number of bytes to read.
+ * \param[in] timeoutMs: time to wait in milliseconds, 0 to not wait at all,
+ *            CBUF_WAIT_FOREVER to wait without limit.
+ * \return number of bytes read, 0 on timeout.
+ */
+uint64_t cbuf_read_wait(cbuf_t *cb, void * const buffer, uint64_t numOfBytes, int timeoutMs) {
+    if (NULL == cb) {
+        return 0;
+    }
+    return cbuf_wait_xfer(cb, cbuf_xfer_read, buffer, numOfBytes, timeoutMs,
+                          CBUF_WAITER_READER, &cb->writePos, &cb->readPos);
+}
+
+/** \brief Write to circular buffer, waiting for free space if it is full.
+ * Same as cbuf_write_spsc(), except that the caller sleeps until at least
+ * one byte can be written or the timeout expires.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ * \param[in] data: data to write.
+ * \param[in] numOfBytes: maximum number of bytes to write.
+ * \param[in] timeoutMs: time to wait in milliseconds, 0 to not wait at all,
+ *            CBUF_WAIT_FOREVER to wait without limit.
+ * \return number of bytes written, 0 on timeout.
+ */
+uint64_t cbuf_write_wait(cbuf_t *cb, void const * const data, uint64_t numOfBytes, int timeoutMs) {
+    if (NULL == cb) {
+        return 0;
+    }
+    return cbuf_wait_xfer(cb, cbuf_xfer_write, (void *)data, numOfBytes, timeoutMs,
+                          CBUF_WAITER_WRITER, &cb->readPos, &cb->writePos);
+}
+
+/** \brief Wake up threads sleeping in cbuf_read_wait()/cbuf_write_wait().
+ * For producers and consumers that move the indices with other calls, e.g.
+ * cbuf_write_commit(). Does not enter the kernel if nobody sleeps.
+ *
+ * \param[in] cb: handle to cbuf_t.
+ */
+void cbuf_wait_notify(cbuf_t *cb) {
+    if (NULL == cb) {
+        return;
+    }
+    cbuf_wake(cb, CBUF_WAITER_READER, &cb->writePos);
+    cbuf_wake(cb, CBUF_WAITER_WRITER, &cb->readPos);
+}
@@ -0,0 +1,21 @@
+#ifndef CBUF_WAIT_H
+#define CBUF_WAIT_H
+
+#include "cbuf.h"
+
+// Blocking single-producer/single-consumer access (Linux).
+// A caller first spins for a short time, then sleeps on a futex keyed on the
+// index word the other side publishes. The other side only enters the kernel
+// when a sleeper is registered in cb->waiters. Both sides have to use these
+// calls (or cbuf_wait_notify()) for sleepers to be woken up.
+
+#define CBUF_WAITER_READER (1u << 0)
+#define CBUF_WAITER_WRITER (1u << 1)
+
+#define CBUF_WAIT_FOREVER  (-1)
+
+uint64_t cbuf_read_wait(cbuf_t *cb, void * const buffer, uint64_t numOfBytes, int timeoutMs);
+uint64_t cbuf_write_wait(cbuf_t *cb, void const * const data, uint64_t numOfBytes, int timeoutMs);
+void     cbuf_wait_notify(cbuf_t *cb);
+
+#endif // CBUF_WAIT_H
@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include "cbuf.h"
+#include "cbuf_internal.h"
 
 void setUp(void)
 {
@@ -717,4 +718,430 @@ void test_cbuf_write_read(void) {
     TEST_ASSERT_EQUAL_UINT8_ARRAY(data6, &readBuf[sizeof(data5)], sizeof(data6));
     TEST_ASSERT_EQUAL_UINT8_ARRAY(readBuf, readBufSingle, sizeof(data5) + sizeof(data6));
 #undef DATA_SIZE
-}
\ No newline at end of file
+}
+
+//
+void test_cbuf_init_pow2(void) {
+    cbuf_t cb;
+    uint8_t buffer[16];
+
+    TEST_ASSERT_EQUAL(0, cbuf_init_pow2(NULL, buffer, 16));
+    TEST_ASSERT_EQUAL(0, cbuf_init_pow2(&cb, NULL, 16));
+    TEST_ASSERT_EQUAL(0, cbuf_init_pow2(&cb, buffer, 0));
+    TEST_ASSERT_EQUAL(0, cbuf_init_pow2(&cb, buffer, 1));
+    TEST_ASSERT_EQUAL(0, cbuf_init_pow2(&cb, buffer, 10)); // not a power of two
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, 16));
+    TEST_ASSERT_EQUAL_PTR(cb.bufPtr, buffer);
+    TEST_ASSERT_EQUAL(16, cb.size);
+    TEST_ASSERT_EQUAL(15, cb.mask);
+    TEST_ASSERT_EQUAL(0, cb.writePos);
+    TEST_ASSERT_EQUAL(0, cb.readPos);
+    TEST_ASSERT_EQUAL(16, cbuf_get_free(&cb)); // whole buffer usable
+
+    // cbuf_init() falls back to the modulo-free wrap scheme
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, 16));
+    TEST_ASSERT_EQUAL(0, cb.mask);
+    TEST_ASSERT_EQUAL(15, cbuf_get_free(&cb));
+}
+
+//
+void test_cbuf_pow2_single_write_read(void) {
+#define DATA_SIZE 8
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readByte = 0;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < DATA_SIZE + 5; i++) {
+        count += cbuf_write_single(&cb, 100 + i); // All DATA_SIZE bytes are written
+    }
+    TEST_ASSERT_EQUAL(DATA_SIZE, count);
+    TEST_ASSERT_EQUAL(true, cbuf_is_full(&cb));
+    TEST_ASSERT_EQUAL(DATA_SIZE, cb.writePos); // writePos is not wrapped
+    TEST_ASSERT_EQUAL(DATA_SIZE, cbuf_get_filled(&cb));
+    TEST_ASSERT_EQUAL(0, cbuf_get_free(&cb));
+
+    // Read a few, write a few: indices keep running past size
+    for (uint8_t round = 0; round < 3 * DATA_SIZE; round++) {
+        TEST_ASSERT_EQUAL(1, cbuf_read_single(&cb, &readByte));
+        TEST_ASSERT_EQUAL(100 + round, readByte);
+        TEST_ASSERT_EQUAL(1, cbuf_write_single(&cb, 100 + DATA_SIZE + round));
+        TEST_ASSERT_EQUAL(true, cbuf_is_full(&cb));
+    }
+    TEST_ASSERT_EQUAL(4 * DATA_SIZE, cb.writePos);
+    TEST_ASSERT_EQUAL(3 * DATA_SIZE, cb.readPos);
+
+    count = 0;
+    while (cbuf_read_single(&cb, &readByte)) {
+        TEST_ASSERT_EQUAL(100 + 3 * DATA_SIZE + count, readByte);
+        count++;
+    }
+    TEST_ASSERT_EQUAL(DATA_SIZE, count);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_pow2_write_read_peek(void) {
+#define DATA_SIZE 8
+    cbuf_t cb;
+    uint8_t const mockData[DATA_SIZE] = {32, 50, 81, 60, 48, 58, 29, 13};
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readBuffer[DATA_SIZE];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(DATA_SIZE, cbuf_write(&cb, mockData, DATA_SIZE + 3));
+    TEST_ASSERT_EQUAL(0, cbuf_write(&cb, mockData, 1)); // full
+    TEST_ASSERT_EQUAL(5, cbuf_read(&cb, readBuffer, 5));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, 5);
+
+    // [x - x - x - o - o - r - x - x], writes wrap around the end of buffer
+    TEST_ASSERT_EQUAL(5, cbuf_write(&cb, mockData, 5));
+    TEST_ASSERT_EQUAL(DATA_SIZE + 5, cb.writePos);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, buffer, 5);
+
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_EQUAL(DATA_SIZE, cbuf_peek(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(5, cb.readPos);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[5], readBuffer, 3);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, &readBuffer[3], 5);
+
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_EQUAL(DATA_SIZE, cbuf_read(&cb, readBuffer, DATA_SIZE + 1));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[5], readBuffer, 3);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, &readBuffer[3], 5);
+    TEST_ASSERT_EQUAL(cb.writePos, cb.readPos);
+
+    // Free-running indices close to overflow of uint64_t
+    cb.writePos = cb.readPos = UINT64_MAX - 2;
+    TEST_ASSERT_EQUAL(DATA_SIZE, cbuf_write(&cb, mockData, DATA_SIZE));
+    TEST_ASSERT_EQUAL(DATA_SIZE, cbuf_get_filled(&cb));
+    TEST_ASSERT_EQUAL(true, cbuf_is_full(&cb));
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_EQUAL(DATA_SIZE, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, DATA_SIZE);
+    TEST_ASSERT_EQUAL(DATA_SIZE - 3, cb.readPos);
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_write_overwrite(void) {
+#define DATA_SIZE 10
+    cbuf_t cb;
+    uint8_t const mockData[DATA_SIZE + 2] = {32, 50, 81, 60, 48, 58, 29, 13, 48, 57, 11, 12};
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readBuffer[DATA_SIZE];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_write_overwrite(&cb, mockData, 0));
+    TEST_ASSERT_EQUAL(0, cbuf_write_overwrite(&cb, mockData, 6)); // fits
+    TEST_ASSERT_EQUAL(6, cbuf_get_filled(&cb));
+
+    // [x - x - x - x - x - x - w - o - o - o] -> 3 free, 5 written, 2 oldest dropped
+    TEST_ASSERT_EQUAL(2, cbuf_write_overwrite(&cb, &mockData[6], 5));
+    TEST_ASSERT_EQUAL(2, cb.readPos);
+    TEST_ASSERT_EQUAL(1, cb.writePos);
+    TEST_ASSERT_EQUAL(true, cbuf_is_full(&cb));
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[2], readBuffer, DATA_SIZE - 1);
+
+    // Longer than capacity: the newest (size - 1) bytes are kept
+    TEST_ASSERT_EQUAL(0, cbuf_write_overwrite(&cb, mockData, 3));
+    TEST_ASSERT_EQUAL(3 + 3, cbuf_write_overwrite(&cb, mockData, DATA_SIZE + 2));
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[3], readBuffer, DATA_SIZE - 1);
+
+    // Whole buffer usable with cbuf_init_pow2()
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, 8));
+    TEST_ASSERT_EQUAL(0, cbuf_write_overwrite(&cb, mockData, 8));
+    TEST_ASSERT_EQUAL(3, cbuf_write_overwrite(&cb, &mockData[8], 3));
+    TEST_ASSERT_EQUAL(8, cbuf_get_filled(&cb));
+    TEST_ASSERT_EQUAL(8, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[3], readBuffer, 8);
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_peek_at_skip_byte_at(void) {
+#define DATA_SIZE 10
+    cbuf_t cb;
+    uint8_t const mockData[DATA_SIZE] = {32, 50, 81, 60, 48, 58, 29, 13, 48, 57};
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readBuffer[DATA_SIZE] = {0};
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_peek_at(&cb, 0, readBuffer, 1)); // empty
+    TEST_ASSERT_EQUAL(-1, cbuf_byte_at(&cb, 0));
+    TEST_ASSERT_EQUAL(0, cbuf_skip(&cb, 1));
+
+    // [x - x - w - o - o - o - r - x - x - x] -> stored data wraps around
+    cb.readPos = cb.writePos = 6;
+    TEST_ASSERT_EQUAL(6, cbuf_write(&cb, mockData, 6));
+    TEST_ASSERT_EQUAL(3, cbuf_peek_at(&cb, 2, readBuffer, 3)); // across the end of buffer
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[2], readBuffer, 3);
+    TEST_ASSERT_EQUAL(2, cbuf_peek_at(&cb, 4, readBuffer, DATA_SIZE)); // limited to stored data
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[4], readBuffer, 2);
+    TEST_ASSERT_EQUAL(0, cbuf_peek_at(&cb, 6, readBuffer, 1));
+    TEST_ASSERT_EQUAL(mockData[0], cbuf_byte_at(&cb, 0));
+    TEST_ASSERT_EQUAL(mockData[5], cbuf_byte_at(&cb, 5));
+    TEST_ASSERT_EQUAL(-1, cbuf_byte_at(&cb, 6));
+    TEST_ASSERT_EQUAL(6, cbuf_get_filled(&cb)); // nothing consumed
+    TEST_ASSERT_EQUAL(6, cb.readPos);
+
+    TEST_ASSERT_EQUAL(5, cbuf_skip(&cb, 5));
+    TEST_ASSERT_EQUAL(1, cb.readPos);
+    TEST_ASSERT_EQUAL(mockData[5], cbuf_byte_at(&cb, 0));
+    TEST_ASSERT_EQUAL(1, cbuf_skip(&cb, DATA_SIZE)); // limited to stored data
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+
+    // Free-running indices with cbuf_init_pow2()
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, 8));
+    cb.readPos = cb.writePos = 13;
+    TEST_ASSERT_EQUAL(8, cbuf_write(&cb, mockData, 8));
+    TEST_ASSERT_EQUAL(4, cbuf_peek_at(&cb, 1, readBuffer, 4));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[1], readBuffer, 4);
+    TEST_ASSERT_EQUAL(mockData[7], cbuf_byte_at(&cb, 7));
+    TEST_ASSERT_EQUAL(3, cbuf_skip(&cb, 3));
+    TEST_ASSERT_EQUAL(16, cb.readPos);
+    TEST_ASSERT_EQUAL(5, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[3], readBuffer, 5);
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_write_reserve_commit(void) {
+#define DATA_SIZE 10
+    cbuf_t cb;
+    uint8_t const mockData[DATA_SIZE] = {32, 50, 81, 60, 48, 58, 29, 13, 48, 57};
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readBuffer[DATA_SIZE];
+    uint8_t *ptr[2];
+    uint64_t len[2];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+
+    // Empty buffer: one span from writePos to the last usable slot
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, cbuf_write_reserve(&cb, DATA_SIZE + 5, ptr, len));
+    TEST_ASSERT_EQUAL_PTR(buffer, ptr[0]);
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, len[0]);
+    TEST_ASSERT_NULL(ptr[1]);
+    TEST_ASSERT_EQUAL(0, len[1]);
+
+    // Nothing is visible until committed
+    memcpy(ptr[0], mockData, 4);
+    TEST_ASSERT_EQUAL(0, cbuf_get_filled(&cb));
+    TEST_ASSERT_EQUAL(4, cbuf_write_commit(&cb, 4));
+    TEST_ASSERT_EQUAL(4, cb.writePos);
+    TEST_ASSERT_EQUAL(4, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, 4);
+
+    // [o - o - o - o - r/w - o - o - o - o - o] -> free region wraps around
+    TEST_ASSERT_EQUAL(8, cbuf_write_reserve(&cb, 8, ptr, len));
+    TEST_ASSERT_EQUAL_PTR(&buffer[4], ptr[0]);
+    TEST_ASSERT_EQUAL(6, len[0]);
+    TEST_ASSERT_EQUAL_PTR(&buffer[0], ptr[1]);
+    TEST_ASSERT_EQUAL(2, len[1]);
+    memcpy(ptr[0], mockData, len[0]);
+    memcpy(ptr[1], &mockData[len[0]], len[1]);
+    TEST_ASSERT_EQUAL(8, cbuf_write_commit(&cb, 8));
+    TEST_ASSERT_EQUAL(2, cb.writePos);
+    TEST_ASSERT_EQUAL(8, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, 8);
+
+    // Full buffer: nothing to reserve, commit is limited to free space
+    cbuf_reset(&cb);
+    TEST_ASSERT_EQUAL(3, cbuf_write_commit(&cb, 3));
+    TEST_ASSERT_EQUAL(DATA_SIZE - 4, cbuf_write_commit(&cb, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_write_reserve(&cb, 1, ptr, len));
+    TEST_ASSERT_NULL(ptr[0]);
+    TEST_ASSERT_NULL(ptr[1]);
+    TEST_ASSERT_EQUAL(0, cbuf_write_commit(&cb, 1));
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_read_acquire_release(void) {
+#define DATA_SIZE 8
+    cbuf_t cb;
+    uint8_t const mockData[DATA_SIZE] = {32, 50, 81, 60, 48, 58, 29, 13};
+    uint8_t buffer[DATA_SIZE];
+    uint8_t const *ptr[2];
+    uint64_t len[2];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_read_acquire(&cb, ptr, len)); // empty
+    TEST_ASSERT_NULL(ptr[0]);
+    TEST_ASSERT_EQUAL(0, cbuf_read_release(&cb, 1));
+
+    TEST_ASSERT_EQUAL(5, cbuf_write(&cb, mockData, 5));
+    TEST_ASSERT_EQUAL(5, cbuf_read_acquire(&cb, ptr, len));
+    TEST_ASSERT_EQUAL_PTR(buffer, ptr[0]);
+    TEST_ASSERT_EQUAL(5, len[0]);
+    TEST_ASSERT_EQUAL(0, len[1]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, ptr[0], 5);
+    TEST_ASSERT_EQUAL(5, cbuf_get_filled(&cb)); // still stored until released
+    TEST_ASSERT_EQUAL(3, cbuf_read_release(&cb, 3));
+    TEST_ASSERT_EQUAL(2, cbuf_get_filled(&cb));
+
+    // [x - x - x - r - x - w - o - o] -> filled region wraps around after next write
+    TEST_ASSERT_EQUAL(6, cbuf_write(&cb, mockData, 6));
+    TEST_ASSERT_EQUAL(8, cbuf_read_acquire(&cb, ptr, len));
+    TEST_ASSERT_EQUAL_PTR(&buffer[3], ptr[0]);
+    TEST_ASSERT_EQUAL(5, len[0]);
+    TEST_ASSERT_EQUAL_PTR(&buffer[0], ptr[1]);
+    TEST_ASSERT_EQUAL(3, len[1]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[3], ptr[0], 2);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, ptr[0] + 2, 3);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[3], ptr[1], 3);
+
+    TEST_ASSERT_EQUAL(8, cbuf_read_release(&cb, DATA_SIZE + 1)); // limited to filled bytes
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+    TEST_ASSERT_EQUAL(DATA_SIZE + 3, cb.readPos);
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_read_until(void) {
+#define DATA_SIZE 16
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    char line[DATA_SIZE];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_read_until(&cb, '\n', line, sizeof(line))); // empty
+
+    TEST_ASSERT_EQUAL(9, cbuf_write(&cb, "ab\ncde\nfg", 9));
+    TEST_ASSERT_EQUAL(3, cbuf_read_until(&cb, '\n', line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING_LEN("ab\n", line, 3);
+    TEST_ASSERT_EQUAL(0, cbuf_read_until(&cb, '\n', line, 3)); // "cde\n" does not fit in 3 bytes
+    TEST_ASSERT_EQUAL(4, cbuf_read_until(&cb, '\n', line, 4));
+    TEST_ASSERT_EQUAL_STRING_LEN("cde\n", line, 4);
+    TEST_ASSERT_EQUAL(0, cbuf_read_until(&cb, '\n', line, sizeof(line))); // incomplete line
+    TEST_ASSERT_EQUAL(2, cbuf_get_filled(&cb)); // nothing consumed
+
+    // [o - ... - r/f - g - x - x - x - x - x] line continues across the end of buffer
+    cbuf_reset(&cb);
+    cb.readPos = cb.writePos = 12;
+    TEST_ASSERT_EQUAL(9, cbuf_write(&cb, "wrapped\n!", 9));
+    memset(line, 0, sizeof(line));
+    TEST_ASSERT_EQUAL(8, cbuf_read_until(&cb, '\n', line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING_LEN("wrapped\n", line, 8);
+    TEST_ASSERT_EQUAL(4, cb.readPos);
+
+    // Delimiter found in the second span, limited by maxBytes
+    cb.readPos = cb.writePos = 14;
+    TEST_ASSERT_EQUAL(6, cbuf_write(&cb, "xyz;uv", 6));
+    TEST_ASSERT_EQUAL(0, cbuf_read_until(&cb, ';', line, 3));
+    TEST_ASSERT_EQUAL(4, cbuf_read_until(&cb, ';', line, 4));
+    TEST_ASSERT_EQUAL_STRING_LEN("xyz;", line, 4);
+    TEST_ASSERT_EQUAL(2, cbuf_get_filled(&cb));
+#undef DATA_SIZE
+}
+
+typedef struct {
+    uint8_t data[32];
+    uint64_t len;
+    uint64_t calls;
+    uint64_t limit; // stop consuming after this many bytes
+} scan_ctx_t;
+
+static uint64_t scan_collect(void *ctx, uint8_t const *data, uint64_t len) {
+    scan_ctx_t *s = (scan_ctx_t *)ctx;
+    uint64_t n = (s->len + len > s->limit) ? (s->limit - s->len) : len;
+    memcpy(&s->data[s->len], data, n);
+    s->len += n;
+    s->calls++;
+    return n;
+}
+
+//
+void test_cbuf_scan(void) {
+#define DATA_SIZE 16
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t const mockData[10] = {32, 50, 81, 60, 48, 58, 29, 13, 48, 57};
+    scan_ctx_t ctx = {{0}, 0, 0, UINT64_MAX};
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_scan(&cb, scan_collect, &ctx)); // empty, no call
+    TEST_ASSERT_EQUAL(0, ctx.calls);
+
+    // Two spans, two calls
+    cb.readPos = cb.writePos = 12;
+    TEST_ASSERT_EQUAL(10, cbuf_write(&cb, mockData, 10));
+    TEST_ASSERT_EQUAL(10, cbuf_scan(&cb, scan_collect, &ctx));
+    TEST_ASSERT_EQUAL(2, ctx.calls);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, ctx.data, 10);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+
+    // Partial consumption stops the scan, the rest stays in buffer
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.limit = 3;
+    cb.readPos = cb.writePos = 12;
+    TEST_ASSERT_EQUAL(10, cbuf_write(&cb, mockData, 10));
+    TEST_ASSERT_EQUAL(3, cbuf_scan(&cb, scan_collect, &ctx));
+    TEST_ASSERT_EQUAL(1, ctx.calls);
+    TEST_ASSERT_EQUAL(7, cbuf_get_filled(&cb));
+    TEST_ASSERT_EQUAL(15, cb.readPos);
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_get_stats_disabled(void) {
+    cbuf_t cb;
+    cbuf_stats_t stats;
+    uint8_t buffer[8];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(4, cbuf_write(&cb, buffer, 4));
+    memset(&stats, 0xFF, sizeof(stats));
+    // Built without CBUF_ENABLE_STATS, nothing is attached or counted
+    TEST_ASSERT_NULL(cb.stats);
+    TEST_ASSERT_EQUAL(0, cbuf_stats_attach(&cb, &stats));
+    TEST_ASSERT_NULL(cb.stats);
+    TEST_ASSERT_EQUAL(0, cbuf_get_stats(&cb, &stats));
+    TEST_ASSERT_EQUAL(0, stats.bytesIn);
+    TEST_ASSERT_EQUAL(0, stats.highWatermark);
+}
+
+//
+void test_cbuf_write_read_copy_lengths(void) {
+#define DATA_SIZE (3u * 1024 * 1024 + 1000)
+    static uint8_t buffer[DATA_SIZE];
+    static uint8_t data[DATA_SIZE + 4];
+    static uint8_t readBuffer[DATA_SIZE + 4];
+    uint64_t const lengths[] = {255, 256, 257, 1000, 4095, 65537, 1536 * 1024 + 3, DATA_SIZE - 1};
+    cbuf_copy_fn kernels[4];
+    cbuf_copy_fn const resolved = cbuf_copy_bulk;
+    cbuf_t cb;
+
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 7 + (i >> 11));
+    }
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+
+    // Each bulk kernel the CPU can run, not only the one picked for it
+    uint32_t const numKernels = cbuf_copy_kernels(kernels, 4);
+    TEST_ASSERT_TRUE(numKernels >= 1);
+    for (uint32_t k = 0; k < numKernels; k++) {
+        cbuf_copy_bulk = kernels[k];
+        // Every length the inline copies handle and a few around the kernel steps,
+        // written across the end of buffer and read into a misaligned destination
+        for (uint64_t len = 0; len < 150 + sizeof(lengths) / sizeof(lengths[0]); len++) {
+            uint64_t n = (len < 150) ? len : lengths[len - 150];
+            uint64_t align = len & 3;
+            cb.readPos = cb.writePos = DATA_SIZE - 1 - n / 3;
+            TEST_ASSERT_EQUAL(n, cbuf_write(&cb, &data[align], n));
+            memset(readBuffer, 0, n + 4);
+            TEST_ASSERT_EQUAL(n, cbuf_read(&cb, &readBuffer[align], n));
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(&data[align], &readBuffer[align], n);
+            TEST_ASSERT_EQUAL(0, readBuffer[align + n]); // nothing past the end
+        }
+    }
+    cbuf_copy_bulk = resolved;
+#undef DATA_SIZE
+}
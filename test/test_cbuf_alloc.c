@@ -0,0 +1,125 @@
+#include "unity.h"
+#include <string.h>
+
+#include "cbuf.h"
+#include "cbuf_alloc.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Write a counting pattern of len bytes starting at value first
+static void write_pattern(cbuf_t *cb, uint64_t len, uint8_t first) {
+    for (uint64_t i = 0; i < len; i++) {
+        TEST_ASSERT_EQUAL(1, cbuf_write_single(cb, (uint8_t)(first + i)));
+    }
+}
+
+static void check_pattern(cbuf_t *cb, uint64_t len, uint8_t first) {
+    uint8_t byte;
+    for (uint64_t i = 0; i < len; i++) {
+        TEST_ASSERT_EQUAL(1, cbuf_read_single(cb, &byte));
+        TEST_ASSERT_EQUAL_UINT8((uint8_t)(first + i), byte);
+    }
+}
+
+//
+void test_cbuf_create_destroy(void) {
+    uint8_t buffer[10];
+    cbuf_t local;
+
+    TEST_ASSERT_NULL(cbuf_create(1, 0));
+    TEST_ASSERT_NULL(cbuf_create(64, CBUF_CREATE_NUMA(4096))); // node out of range
+    TEST_ASSERT_EQUAL(0, cbuf_destroy(NULL));
+    TEST_ASSERT_EQUAL(1, cbuf_init(&local, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(0, cbuf_destroy(&local)); // not created by cbuf_create()
+    TEST_ASSERT_EQUAL(0, cbuf_grow(&local, 20));
+
+    cbuf_t *cb = cbuf_create(100, 0);
+    TEST_ASSERT_NOT_NULL(cb);
+    TEST_ASSERT_EQUAL(0, cb->mask);
+    TEST_ASSERT_EQUAL(99, cbuf_get_free(cb));
+    TEST_ASSERT_TRUE(cb->flags & CBUF_FLAG_ALLOCATED);
+    TEST_ASSERT_EQUAL(1, cbuf_destroy(cb));
+
+    cb = cbuf_create(4096, 0);
+    TEST_ASSERT_NOT_NULL(cb);
+    TEST_ASSERT_EQUAL(4095, cb->mask);
+    TEST_ASSERT_EQUAL(1, cbuf_destroy(cb));
+}
+
+//
+void test_cbuf_create_thp(void) {
+    uint64_t const size = 3 * 1024 * 1024;
+    cbuf_t *cb = cbuf_create(size, CBUF_CREATE_THP);
+
+    TEST_ASSERT_NOT_NULL(cb);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)cb->bufPtr % (2 * 1024 * 1024));
+    memset(cb->bufPtr, 0xA5, size); // whole range is mapped
+    write_pattern(cb, 1000, 3);
+    check_pattern(cb, 1000, 3);
+    TEST_ASSERT_EQUAL(1, cbuf_destroy(cb));
+}
+
+//
+void test_cbuf_create_hugetlb_numa(void) {
+    // Both depend on the machine, but must either work or fail cleanly
+    cbuf_t *cb = cbuf_create(1024 * 1024, CBUF_CREATE_HUGETLB);
+    if (NULL != cb) {
+        write_pattern(cb, 100, 1);
+        check_pattern(cb, 100, 1);
+        TEST_ASSERT_EQUAL(1, cbuf_destroy(cb));
+    }
+    cb = cbuf_create(64 * 1024, CBUF_CREATE_NUMA(0));
+    if (NULL != cb) {
+        write_pattern(cb, 100, 1);
+        check_pattern(cb, 100, 1);
+        TEST_ASSERT_EQUAL(1, cbuf_destroy(cb));
+    }
+}
+
+//
+void test_cbuf_grow(void) {
+    cbuf_t *cb = cbuf_create(16, 0);
+    TEST_ASSERT_NOT_NULL(cb);
+
+    // Stored data wraps around the end of buffer
+    write_pattern(cb, 10, 0);
+    check_pattern(cb, 10, 0);
+    write_pattern(cb, 16, 10);
+    TEST_ASSERT_EQUAL(true, cbuf_is_full(cb));
+
+    TEST_ASSERT_EQUAL(0, cbuf_grow(cb, 10)); // too small for the data
+    cbuf_stats_t stats;
+    cb->stats = &stats; // attached counters are carried over, enabled or not
+    TEST_ASSERT_EQUAL(1, cbuf_grow(cb, 100));
+    TEST_ASSERT_EQUAL_PTR(&stats, cb->stats);
+    cb->stats = NULL;
+    TEST_ASSERT_EQUAL(0, cb->mask);
+    TEST_ASSERT_EQUAL(0, cb->readPos); // relinearized
+    TEST_ASSERT_EQUAL(16, cbuf_get_filled(cb));
+    write_pattern(cb, 80, 26);
+    TEST_ASSERT_EQUAL(1, cbuf_grow(cb, 128)); // legacy to pow2 scheme, full buffer
+    TEST_ASSERT_EQUAL(127, cb->mask);
+    TEST_ASSERT_EQUAL(96, cbuf_get_filled(cb));
+    check_pattern(cb, 96, 10);
+
+    // Shrinking works as long as the data fits
+    write_pattern(cb, 30, 7);
+    TEST_ASSERT_EQUAL(1, cbuf_grow(cb, 31));
+    TEST_ASSERT_EQUAL(1, cbuf_is_full(cb));
+    check_pattern(cb, 30, 7);
+    TEST_ASSERT_EQUAL(1, cbuf_destroy(cb));
+
+    cb = cbuf_create(4096, CBUF_CREATE_THP);
+    TEST_ASSERT_NOT_NULL(cb);
+    write_pattern(cb, 4000, 5);
+    TEST_ASSERT_EQUAL(1, cbuf_grow(cb, 8 * 1024 * 1024));
+    TEST_ASSERT_EQUAL(0, (uintptr_t)cb->bufPtr % (2 * 1024 * 1024)); // options kept
+    check_pattern(cb, 4000, 5);
+    TEST_ASSERT_EQUAL(1, cbuf_destroy(cb));
+}
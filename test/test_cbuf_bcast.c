@@ -0,0 +1,171 @@
+#include "unity.h"
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "cbuf.h"
+#include "cbuf_bcast.h"
+
+#define BCAST_STREAM_BYTES (16 * 1024 * 1024)
+#define BCAST_NUM_READERS  3
+
+typedef struct {
+    cbuf_bcast_t *b;
+    int id;
+    uint64_t bytesDone;
+    uint64_t mismatches;
+    bool reattach; // detach and attach again halfway through
+} bcast_reader_t;
+
+static inline uint8_t stream_byte(uint64_t i) {
+    return (uint8_t)(i ^ (i >> 8) ^ (i >> 16));
+}
+
+static void *reader_thread(void *arg) {
+    bcast_reader_t *r = (bcast_reader_t *)arg;
+    uint8_t const *ptr[2];
+    uint64_t len[2];
+    uint64_t offset = 0;
+
+    while (offset < BCAST_STREAM_BYTES) {
+        if (r->reattach && offset >= BCAST_STREAM_BYTES / 2) {
+            // The stream goes on without us, positions equal stream offsets
+            if (!cbuf_bcast_detach(r->b, r->id)) {
+                r->mismatches++;
+            }
+            r->id = cbuf_bcast_attach(r->b);
+            r->reattach = false;
+            offset = __atomic_load_n(&r->b->readers[r->id].pos, __ATOMIC_ACQUIRE);
+            continue;
+        }
+        uint64_t n = cbuf_bcast_read_acquire(r->b, r->id, ptr, len);
+        if (0 == n) {
+            sched_yield();
+            continue;
+        }
+        for (int s = 0; s < 2; s++) {
+            for (uint64_t i = 0; i < len[s]; i++) {
+                if (ptr[s][i] != stream_byte(offset + i)) {
+                    r->mismatches++;
+                }
+            }
+            offset += len[s];
+        }
+        cbuf_bcast_read_release(r->b, r->id, n);
+    }
+    r->bytesDone = offset;
+    return NULL;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//
+void test_cbuf_bcast_init_attach(void) {
+    static cbuf_bcast_t b;
+    uint8_t buffer[16];
+    int ids[CBUF_BCAST_MAX_READERS];
+
+    TEST_ASSERT_EQUAL(0, cbuf_bcast_init(&b, buffer, 12)); // not a power of two
+    TEST_ASSERT_EQUAL(0, cbuf_bcast_init(NULL, buffer, 16));
+    TEST_ASSERT_EQUAL(1, cbuf_bcast_init(&b, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(-1, cbuf_bcast_attach(NULL));
+
+    for (int i = 0; i < CBUF_BCAST_MAX_READERS; i++) {
+        ids[i] = cbuf_bcast_attach(&b);
+        TEST_ASSERT_EQUAL(i, ids[i]);
+    }
+    TEST_ASSERT_EQUAL(-1, cbuf_bcast_attach(&b)); // all cursors in use
+    TEST_ASSERT_EQUAL(1, cbuf_bcast_detach(&b, ids[3]));
+    TEST_ASSERT_EQUAL(0, cbuf_bcast_detach(&b, ids[3])); // already detached
+    TEST_ASSERT_EQUAL(0, cbuf_bcast_detach(&b, CBUF_BCAST_MAX_READERS));
+    TEST_ASSERT_EQUAL(3, cbuf_bcast_attach(&b));
+}
+
+//
+void test_cbuf_bcast_slowest_reader(void) {
+    static cbuf_bcast_t b;
+    uint8_t buffer[16];
+    uint8_t const data[20] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+    uint8_t readBuffer[20] = {0};
+
+    TEST_ASSERT_EQUAL(1, cbuf_bcast_init(&b, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(5, cbuf_bcast_write(&b, data, 5)); // nobody listens, dropped
+    int fast = cbuf_bcast_attach(&b);
+    int slow = cbuf_bcast_attach(&b);
+    TEST_ASSERT_EQUAL(0, cbuf_bcast_get_filled(&b, fast));
+
+    TEST_ASSERT_EQUAL(16, cbuf_bcast_write(&b, data, 20)); // whole buffer usable
+    TEST_ASSERT_EQUAL(0, cbuf_bcast_write(&b, data, 1));
+    TEST_ASSERT_EQUAL(16, cbuf_bcast_read(&b, fast, readBuffer, 20));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBuffer, 16);
+    TEST_ASSERT_EQUAL(0, cbuf_bcast_get_free(&b)); // held back by the slow reader
+
+    TEST_ASSERT_EQUAL(6, cbuf_bcast_read(&b, slow, readBuffer, 6));
+    TEST_ASSERT_EQUAL(6, cbuf_bcast_get_free(&b));
+    TEST_ASSERT_EQUAL(4, cbuf_bcast_write(&b, &data[16], 4)); // wraps around
+    TEST_ASSERT_EQUAL(4, cbuf_bcast_get_filled(&b, fast));
+    TEST_ASSERT_EQUAL(14, cbuf_bcast_get_filled(&b, slow));
+
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_EQUAL(14, cbuf_bcast_read(&b, slow, readBuffer, 20));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&data[6], readBuffer, 14);
+
+    // Detaching the lagging reader releases its space
+    TEST_ASSERT_EQUAL(12, cbuf_bcast_get_free(&b));
+    TEST_ASSERT_EQUAL(1, cbuf_bcast_detach(&b, fast));
+    TEST_ASSERT_EQUAL(16, cbuf_bcast_get_free(&b));
+    TEST_ASSERT_EQUAL(0, cbuf_bcast_read(&b, fast, readBuffer, 1));
+
+    // Reattached reader only sees new data
+    fast = cbuf_bcast_attach(&b);
+    TEST_ASSERT_EQUAL(0, cbuf_bcast_get_filled(&b, fast));
+    TEST_ASSERT_EQUAL(3, cbuf_bcast_write(&b, data, 3));
+    TEST_ASSERT_EQUAL(3, cbuf_bcast_read(&b, fast, readBuffer, 20));
+    TEST_ASSERT_EQUAL(3, cbuf_bcast_read(&b, slow, readBuffer, 20));
+}
+
+//
+void test_cbuf_bcast_stream(void) {
+    static cbuf_bcast_t b;
+    static uint8_t buffer[4096];
+    pthread_t threads[BCAST_NUM_READERS];
+    bcast_reader_t readers[BCAST_NUM_READERS];
+    uint8_t chunk[1000];
+    uint64_t offset = 0;
+
+    TEST_ASSERT_EQUAL(1, cbuf_bcast_init(&b, buffer, sizeof(buffer)));
+    for (int i = 0; i < BCAST_NUM_READERS; i++) {
+        readers[i] = (bcast_reader_t){&b, cbuf_bcast_attach(&b), 0, 0, 2 == i};
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, reader_thread, &readers[i]));
+    }
+
+    while (offset < BCAST_STREAM_BYTES) {
+        uint64_t len = BCAST_STREAM_BYTES - offset;
+        if (len > sizeof(chunk)) {
+            len = sizeof(chunk);
+        }
+        for (uint64_t i = 0; i < len; i++) {
+            chunk[i] = stream_byte(offset + i);
+        }
+        uint64_t written = 0;
+        while (written < len) {
+            uint64_t n = cbuf_bcast_write(&b, &chunk[written], len - written);
+            if (0 == n) {
+                sched_yield();
+            }
+            written += n;
+        }
+        offset += len;
+    }
+    for (int i = 0; i < BCAST_NUM_READERS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_join(threads[i], NULL));
+        TEST_ASSERT_EQUAL_UINT64(BCAST_STREAM_BYTES, readers[i].bytesDone);
+        TEST_ASSERT_EQUAL_UINT64(0, readers[i].mismatches);
+    }
+}
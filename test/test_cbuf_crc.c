@@ -0,0 +1,123 @@
+#include "unity.h"
+#include <string.h>
+#include <stdlib.h>
+
+#include "cbuf.h"
+#include "cbuf_crc.h"
+
+// Bit at a time reference
+static uint32_t crc32c_ref(uint32_t crc, uint8_t const *data, uint64_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78u : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+static void fill_pattern(uint8_t *data, uint64_t len, uint32_t seed) {
+    for (uint64_t i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//
+void test_cbuf_crc32c_vectors(void) {
+    uint8_t zeros[32] = {0};
+    uint8_t ones[32];
+
+    memset(ones, 0xff, sizeof(ones));
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, cbuf_crc32c(CBUF_CRC32C_INIT, "", 0));
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283, cbuf_crc32c(CBUF_CRC32C_INIT, "123456789", 9));
+    // RFC 3720, B.4
+    TEST_ASSERT_EQUAL_HEX32(0x8A9136AA, cbuf_crc32c(CBUF_CRC32C_INIT, zeros, sizeof(zeros)));
+    TEST_ASSERT_EQUAL_HEX32(0x62A8AB43, cbuf_crc32c(CBUF_CRC32C_INIT, ones, sizeof(ones)));
+    // Incremental
+    uint32_t crc = cbuf_crc32c(CBUF_CRC32C_INIT, "1234", 4);
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283, cbuf_crc32c(crc, "56789", 5));
+}
+
+//
+void test_cbuf_crc32c_lengths_and_alignment(void) {
+    uint64_t const maxLen = 3 * 8192 * 2 + 3 * 256 + 100; // every kernel stage
+    uint8_t *data = malloc(maxLen + 8);
+    TEST_ASSERT_NOT_NULL(data);
+    fill_pattern(data, maxLen + 8, 1);
+
+    for (uint64_t align = 0; align < 8; align++) {
+        for (uint64_t len = 0; len < 1100; len += 1 + len / 8) {
+            TEST_ASSERT_EQUAL_HEX32(crc32c_ref(0, &data[align], len), cbuf_crc32c(0, &data[align], len));
+        }
+        TEST_ASSERT_EQUAL_HEX32(crc32c_ref(0, &data[align], maxLen), cbuf_crc32c(0, &data[align], maxLen));
+    }
+    free(data);
+}
+
+//
+void test_cbuf_read_peek_crc32c(void) {
+#define DATA_SIZE 10
+    cbuf_t cb;
+    uint8_t const mockData[DATA_SIZE] = {32, 50, 81, 60, 48, 58, 29, 13, 48, 57};
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readBuffer[DATA_SIZE] = {0};
+    uint32_t crc = CBUF_CRC32C_INIT;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_read_crc32c(&cb, readBuffer, DATA_SIZE, &crc)); // empty
+    TEST_ASSERT_EQUAL_HEX32(CBUF_CRC32C_INIT, crc);
+
+    // [x - x - w - o - o - o - r - x - x - x] -> stored data wraps around
+    cb.readPos = cb.writePos = 6;
+    TEST_ASSERT_EQUAL(6, cbuf_write(&cb, mockData, 6));
+    TEST_ASSERT_EQUAL(6, cbuf_peek_crc32c(&cb, readBuffer, DATA_SIZE, &crc));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, 6);
+    TEST_ASSERT_EQUAL_HEX32(crc32c_ref(0, mockData, 6), crc);
+    TEST_ASSERT_EQUAL(6, cbuf_get_filled(&cb));
+
+    // In two reads, the CRC carries over
+    crc = CBUF_CRC32C_INIT;
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_EQUAL(3, cbuf_read_crc32c(&cb, readBuffer, 3, &crc));
+    TEST_ASSERT_EQUAL(3, cbuf_read_crc32c(&cb, &readBuffer[3], DATA_SIZE, &crc));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, 6);
+    TEST_ASSERT_EQUAL_HEX32(crc32c_ref(0, mockData, 6), crc);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_crc32c_at_whole_content(void) {
+    static uint8_t buffer[64 * 1024];
+    static uint8_t data[64 * 1024];
+    cbuf_t cb;
+    uint32_t crc = CBUF_CRC32C_INIT;
+
+    fill_pattern(data, sizeof(data), 7);
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, sizeof(buffer)));
+    cb.readPos = cb.writePos = 40000; // content wraps around
+    TEST_ASSERT_EQUAL(sizeof(data), cbuf_write(&cb, data, sizeof(data)));
+
+    // Piece by piece, crossing the end of buffer inside a piece
+    uint64_t offset = 0;
+    while (offset < sizeof(data)) {
+        offset += cbuf_crc32c_at(&cb, offset, 5000, &crc);
+    }
+    TEST_ASSERT_EQUAL(0, cbuf_crc32c_at(&cb, offset, 1, &crc));
+    TEST_ASSERT_EQUAL_HEX32(crc32c_ref(0, data, sizeof(data)), crc);
+    TEST_ASSERT_EQUAL(sizeof(data), cbuf_get_filled(&cb)); // nothing consumed
+
+    crc = CBUF_CRC32C_INIT;
+    TEST_ASSERT_EQUAL(100, cbuf_crc32c_at(&cb, sizeof(data) - 100, 1000, &crc));
+    TEST_ASSERT_EQUAL_HEX32(crc32c_ref(0, &data[sizeof(data) - 100], 100), crc);
+}
@@ -0,0 +1,172 @@
+#include "unity.h"
+#include <string.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "cbuf.h"
+#include "cbuf_file.h"
+
+static char path[64];
+
+void setUp(void)
+{
+    snprintf(path, sizeof(path), "/tmp/cbuf_file_test_%d", (int)getpid());
+    unlink(path);
+}
+
+void tearDown(void)
+{
+    unlink(path);
+}
+
+//
+void test_cbuf_file_open_fail(void) {
+    cbuf_file_t f;
+
+    TEST_ASSERT_EQUAL(0, cbuf_file_open(NULL, path, 64));
+    TEST_ASSERT_EQUAL(0, cbuf_file_open(&f, path, 100)); // not a power of two
+    TEST_ASSERT_EQUAL(0, cbuf_file_open(&f, path, 0));   // size needed to create
+    TEST_ASSERT_EQUAL(-1, access(path, F_OK));           // nothing left behind
+    TEST_ASSERT_EQUAL(0, cbuf_sync(NULL));
+    TEST_ASSERT_EQUAL(0, cbuf_file_close(NULL));
+
+    TEST_ASSERT_EQUAL(1, cbuf_file_open(&f, path, 64));
+    TEST_ASSERT_EQUAL(1, cbuf_file_close(&f));
+    TEST_ASSERT_EQUAL(0, cbuf_file_open(&f, path, 128)); // size mismatch
+
+    // Not a ring file, left untouched
+    int fd = open(path, O_WRONLY | O_TRUNC);
+    TEST_ASSERT_TRUE(fd >= 0);
+    char junk[8192];
+    memset(junk, 'x', sizeof(junk));
+    TEST_ASSERT_EQUAL(sizeof(junk), write(fd, junk, sizeof(junk)));
+    close(fd);
+    TEST_ASSERT_EQUAL(0, cbuf_file_open(&f, path, 0));
+}
+
+//
+void test_cbuf_file_reopen(void) {
+    cbuf_file_t f;
+    uint8_t data[100];
+    uint8_t readBuffer[100] = {0};
+
+    for (int i = 0; i < 100; i++) {
+        data[i] = (uint8_t)(i * 3);
+    }
+    TEST_ASSERT_EQUAL(1, cbuf_file_open(&f, path, 64));
+    TEST_ASSERT_EQUAL(64, cbuf_get_free(&f.cb));
+    TEST_ASSERT_EQUAL(40, cbuf_file_write(&f, data, 40));
+    TEST_ASSERT_EQUAL(30, cbuf_read(&f.cb, readBuffer, 30));
+    TEST_ASSERT_EQUAL(24, cbuf_file_write(&f, &data[40], 50)); // read space not synced yet
+    TEST_ASSERT_EQUAL(1, cbuf_sync(&f));
+    TEST_ASSERT_EQUAL(26, cbuf_file_write(&f, &data[64], 26)); // wraps around
+    TEST_ASSERT_EQUAL(1, cbuf_file_close(&f));
+
+    TEST_ASSERT_EQUAL(1, cbuf_file_open(&f, path, 0));
+    TEST_ASSERT_EQUAL(64, f.cb.size);
+    TEST_ASSERT_EQUAL(60, cbuf_get_filled(&f.cb));
+    TEST_ASSERT_EQUAL(60, cbuf_read(&f.cb, readBuffer, sizeof(readBuffer)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&data[30], readBuffer, 60);
+    TEST_ASSERT_EQUAL(1, cbuf_file_close(&f));
+
+    TEST_ASSERT_EQUAL(1, cbuf_file_open(&f, path, 64));
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&f.cb));
+    TEST_ASSERT_EQUAL(1, cbuf_file_close(&f));
+}
+
+//
+void test_cbuf_file_crash_recovery(void) {
+    cbuf_file_t f;
+    uint8_t data[4096];
+    uint8_t readBuffer[4096];
+
+    for (int i = 0; i < 4096; i++) {
+        data[i] = (uint8_t)(i ^ (i >> 8));
+    }
+    fflush(stdout);
+    pid_t child = fork();
+    TEST_ASSERT_TRUE(child >= 0);
+    if (0 == child) {
+        // Synced data survives, later writes and reads are lost with the process
+        cbuf_file_t c;
+        if (!cbuf_file_open(&c, path, 8192) || 3000 != cbuf_file_write(&c, data, 3000)
+            || 1000 != cbuf_read(&c.cb, readBuffer, 1000) || !cbuf_sync(&c)
+            || 4096 != cbuf_file_write(&c, data, 4096) || 500 != cbuf_read(&c.cb, readBuffer, 500)) {
+            _exit(1);
+        }
+        _exit(0); // no cbuf_file_close()
+    }
+    int status;
+    TEST_ASSERT_EQUAL(child, waitpid(child, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status));
+    TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+
+    TEST_ASSERT_EQUAL(1, cbuf_file_open(&f, path, 8192));
+    TEST_ASSERT_EQUAL(2000, cbuf_get_filled(&f.cb));
+    TEST_ASSERT_EQUAL(2000, cbuf_read(&f.cb, readBuffer, sizeof(readBuffer)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&data[1000], readBuffer, 2000);
+
+    // Torn header: indices are dropped, the file stays usable
+    TEST_ASSERT_EQUAL(1, cbuf_file_close(&f));
+    int fd = open(path, O_RDWR);
+    TEST_ASSERT_TRUE(fd >= 0);
+    uint64_t bogus = 12345;
+    TEST_ASSERT_EQUAL(sizeof(bogus), pwrite(fd, &bogus, sizeof(bogus), offsetof(cbuf_file_header_t, writePos)));
+    close(fd);
+    TEST_ASSERT_EQUAL(1, cbuf_file_open(&f, path, 8192));
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&f.cb));
+    TEST_ASSERT_EQUAL(1, cbuf_file_close(&f));
+}
+
+//
+void test_cbuf_file_crash_reuse(void) {
+    cbuf_file_t f;
+    uint8_t fill[4096];
+    uint8_t readBuffer[4096];
+    uint8_t *ptr[2];
+    uint64_t len[2];
+
+    fflush(stdout);
+    pid_t child = fork();
+    TEST_ASSERT_TRUE(child >= 0);
+    if (0 == child) {
+        // Space read after a sync must not be overwritten before the next one
+        cbuf_file_t c;
+        memset(fill, 'A', sizeof(fill));
+        if (!cbuf_file_open(&c, path, 4096) || 4096 != cbuf_file_write(&c, fill, 4096) || !cbuf_sync(&c)
+            || 4096 != cbuf_read(&c.cb, readBuffer, 4096)) {
+            _exit(1);
+        }
+        memset(fill, 'B', sizeof(fill));
+        if (0 != cbuf_file_write(&c, fill, 4096) || 0 != cbuf_file_write_reserve(&c, 4096, ptr, len)
+            || 4096 != cbuf_get_free(&c.cb)) {
+            _exit(2);
+        }
+        _exit(0); // no cbuf_file_close()
+    }
+    int status;
+    TEST_ASSERT_EQUAL(child, waitpid(child, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status));
+    TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+
+    memset(fill, 'A', sizeof(fill));
+    TEST_ASSERT_EQUAL(1, cbuf_file_open(&f, path, 4096));
+    TEST_ASSERT_EQUAL(4096, cbuf_read(&f.cb, readBuffer, sizeof(readBuffer)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(fill, readBuffer, 4096);
+
+    // After the sync the space is free again, also for zero-copy writes
+    TEST_ASSERT_EQUAL(1, cbuf_sync(&f));
+    TEST_ASSERT_EQUAL(1000, cbuf_file_write_reserve(&f, 1000, ptr, len));
+    memset(ptr[0], 'C', (size_t)len[0]);
+    TEST_ASSERT_EQUAL(1000, cbuf_write_commit(&f.cb, 1000));
+    TEST_ASSERT_EQUAL(1, cbuf_file_close(&f));
+
+    memset(fill, 'C', sizeof(fill));
+    TEST_ASSERT_EQUAL(1, cbuf_file_open(&f, path, 4096));
+    TEST_ASSERT_EQUAL(1000, cbuf_read(&f.cb, readBuffer, sizeof(readBuffer)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(fill, readBuffer, 1000);
+    TEST_ASSERT_EQUAL(1, cbuf_file_close(&f));
+}
@@ -0,0 +1,65 @@
+#include "unity.h"
+#include <string.h>
+
+#include "cbuf.h"
+#include "cbuf_inline.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Inline and out-of-line calls take turns on one buffer and must agree
+static void check_single_ops(cbuf_t *cb) {
+    uint64_t const capacity = cbuf_get_free(cb);
+    uint8_t value;
+
+    for (uint32_t round = 0; round < 3; round++) { // positions wrap around
+        TEST_ASSERT_EQUAL(true, cbuf_is_empty_inline(cb));
+        TEST_ASSERT_EQUAL(0, cbuf_read_single_inline(cb, &value));
+        for (uint64_t i = 0; i < capacity; i++) {
+            uint8_t written = (i & 1) ? cbuf_write_single_inline(cb, (uint8_t)(i + round))
+                                      : cbuf_write_single(cb, (uint8_t)(i + round));
+            TEST_ASSERT_EQUAL(1, written);
+            TEST_ASSERT_EQUAL(cbuf_get_filled(cb), cbuf_get_filled_inline(cb));
+            TEST_ASSERT_EQUAL(cbuf_get_free(cb), cbuf_get_free_inline(cb));
+            TEST_ASSERT_EQUAL(cbuf_is_full(cb), cbuf_is_full_inline(cb));
+        }
+        TEST_ASSERT_EQUAL(true, cbuf_is_full_inline(cb));
+        TEST_ASSERT_EQUAL(0, cbuf_write_single_inline(cb, 0xAA));
+        TEST_ASSERT_EQUAL(capacity, cbuf_get_filled_inline(cb));
+
+        for (uint64_t i = 0; i < capacity; i++) {
+            value = 0;
+            TEST_ASSERT_EQUAL(1, (i & 2) ? cbuf_read_single_inline(cb, &value) : cbuf_read_single(cb, &value));
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)(i + round), value);
+            TEST_ASSERT_EQUAL(cbuf_is_empty(cb), cbuf_is_empty_inline(cb));
+        }
+        // Shift the start for the next round
+        TEST_ASSERT_EQUAL(1, cbuf_write_single_inline(cb, 0x55));
+        TEST_ASSERT_EQUAL(1, cbuf_read_single_inline(cb, &value));
+        TEST_ASSERT_EQUAL_UINT8(0x55, value);
+    }
+}
+
+//
+void test_cbuf_inline_matches_out_of_line(void) {
+    cbuf_t cb;
+    uint8_t buffer[10];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, sizeof(buffer)));
+    check_single_ops(&cb);
+}
+
+//
+void test_cbuf_inline_pow2(void) {
+    cbuf_t cb;
+    uint8_t buffer[16];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(16, cbuf_get_free_inline(&cb));
+    check_single_ops(&cb);
+}
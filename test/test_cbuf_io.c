@@ -0,0 +1,147 @@
+#include "unity.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "cbuf.h"
+#include "cbuf_io.h"
+
+static int fds[2];
+
+void setUp(void)
+{
+    fds[0] = fds[1] = -1;
+}
+
+void tearDown(void)
+{
+    if (fds[0] >= 0) close(fds[0]);
+    if (fds[1] >= 0) close(fds[1]);
+}
+
+//
+void test_cbuf_get_iovecs(void) {
+#define DATA_SIZE 10
+    cbuf_t cb;
+    uint8_t const mockData[DATA_SIZE] = {32, 50, 81, 60, 48, 58, 29, 13, 48, 57};
+    uint8_t buffer[DATA_SIZE];
+    struct iovec iov[2];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_get_read_iovecs(&cb, iov)); // empty
+    TEST_ASSERT_EQUAL(1, cbuf_get_write_iovecs(&cb, iov));
+    TEST_ASSERT_EQUAL_PTR(buffer, iov[0].iov_base);
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, iov[0].iov_len);
+
+    // [x - x - w - o - o - o - r - x - x - x]
+    cb.readPos = cb.writePos = 6;
+    TEST_ASSERT_EQUAL(6, cbuf_write(&cb, mockData, 6));
+    TEST_ASSERT_EQUAL(2, cbuf_get_read_iovecs(&cb, iov));
+    TEST_ASSERT_EQUAL_PTR(&buffer[6], iov[0].iov_base);
+    TEST_ASSERT_EQUAL(4, iov[0].iov_len);
+    TEST_ASSERT_EQUAL_PTR(&buffer[0], iov[1].iov_base);
+    TEST_ASSERT_EQUAL(2, iov[1].iov_len);
+
+    TEST_ASSERT_EQUAL(1, cbuf_get_write_iovecs(&cb, iov));
+    TEST_ASSERT_EQUAL_PTR(&buffer[2], iov[0].iov_base);
+    TEST_ASSERT_EQUAL(3, iov[0].iov_len);
+
+    // [o - o - o - r - x - x - x - w - o - o] -> free space wraps around
+    cb.readPos = 3;
+    cb.writePos = 7;
+    TEST_ASSERT_EQUAL(1, cbuf_get_read_iovecs(&cb, iov));
+    TEST_ASSERT_EQUAL(4, iov[0].iov_len);
+    TEST_ASSERT_EQUAL(2, cbuf_get_write_iovecs(&cb, iov));
+    TEST_ASSERT_EQUAL_PTR(&buffer[7], iov[0].iov_base);
+    TEST_ASSERT_EQUAL(3, iov[0].iov_len);
+    TEST_ASSERT_EQUAL_PTR(&buffer[0], iov[1].iov_base);
+    TEST_ASSERT_EQUAL(2, iov[1].iov_len);
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_fd_pipe(void) {
+#define DATA_SIZE 16
+    cbuf_t cb;
+    uint8_t const mockData[DATA_SIZE] = {32, 50, 81, 60, 48, 58, 29, 13, 48, 57, 1, 2, 3, 4, 5, 6};
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readBuffer[DATA_SIZE] = {0};
+
+    TEST_ASSERT_EQUAL(0, pipe(fds));
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+
+    // Wrapped data is drained into the pipe with a single writev()
+    cb.readPos = cb.writePos = 12;
+    TEST_ASSERT_EQUAL(10, cbuf_write(&cb, mockData, 10));
+    TEST_ASSERT_EQUAL(10, cbuf_read_to_fd(&cb, fds[1], 100));
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+    TEST_ASSERT_EQUAL(10, read(fds[0], readBuffer, sizeof(readBuffer)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, 10);
+
+    // numOfBytes limits the transfer
+    TEST_ASSERT_EQUAL(8, cbuf_write(&cb, mockData, 8));
+    TEST_ASSERT_EQUAL(3, cbuf_read_to_fd(&cb, fds[1], 3));
+    TEST_ASSERT_EQUAL(5, cbuf_get_filled(&cb));
+    TEST_ASSERT_EQUAL(5, cbuf_read(&cb, readBuffer, 5));
+
+    // Filled from the pipe with a single readv() across the end of buffer,
+    // 3 bytes are still queued in the pipe from above
+    TEST_ASSERT_EQUAL(DATA_SIZE, write(fds[1], mockData, DATA_SIZE));
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, cbuf_write_from_fd(&cb, fds[0], 100));
+    TEST_ASSERT_EQUAL(0, cbuf_get_free(&cb));
+    TEST_ASSERT_EQUAL(0, cbuf_write_from_fd(&cb, fds[0], 100)); // full, pipe not touched
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, 3);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, &readBuffer[3], DATA_SIZE - 4);
+
+    TEST_ASSERT_EQUAL(4, cbuf_write_from_fd(&cb, fds[0], 100)); // what is left in the pipe
+    TEST_ASSERT_EQUAL(4, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[DATA_SIZE - 4], readBuffer, 4);
+
+    // Empty non-blocking pipe reports EAGAIN, indices untouched
+    TEST_ASSERT_EQUAL(0, fcntl(fds[0], F_SETFL, O_NONBLOCK));
+    TEST_ASSERT_EQUAL(-1, cbuf_write_from_fd(&cb, fds[0], 100));
+    TEST_ASSERT_EQUAL(EAGAIN, errno);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+
+    // End of file
+    close(fds[1]);
+    fds[1] = -1;
+    TEST_ASSERT_EQUAL(0, cbuf_write_from_fd(&cb, fds[0], 100));
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_fd_socketpair(void) {
+#define DATA_SIZE 4096
+    static uint8_t bufferA[DATA_SIZE], bufferB[DATA_SIZE];
+    static uint8_t data[3 * DATA_SIZE], readBuffer[3 * DATA_SIZE];
+    cbuf_t cbA, cbB;
+    uint64_t sent = 0, received = 0, drained = 0;
+
+    for (uint64_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i ^ (i >> 8));
+    }
+    TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cbA, bufferA, DATA_SIZE));
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cbB, bufferB, DATA_SIZE - 3));
+
+    // cbA -> socket -> cbB, in odd sized steps so both rings wrap several times
+    while (drained < sizeof(data)) {
+        sent += cbuf_write(&cbA, &data[sent], (sizeof(data) - sent < 1000) ? sizeof(data) - sent : 1000);
+        ssize_t n = cbuf_read_to_fd(&cbA, fds[0], 777);
+        TEST_ASSERT_TRUE(n >= 0);
+        n = cbuf_write_from_fd(&cbB, fds[1], 1500);
+        TEST_ASSERT_TRUE(n >= 0);
+        received += (uint64_t)n;
+        drained += cbuf_read(&cbB, &readBuffer[drained], 1234);
+    }
+    TEST_ASSERT_EQUAL(sizeof(data), sent);
+    TEST_ASSERT_EQUAL(sizeof(data), received);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBuffer, sizeof(data));
+#undef DATA_SIZE
+}
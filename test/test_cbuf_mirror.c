@@ -0,0 +1,164 @@
+#include "unity.h"
+#include <string.h>
+#include <stdlib.h>
+
+#include "cbuf.h"
+#include "cbuf_mirror.h"
+
+static uint64_t pageSize;
+
+void setUp(void)
+{
+    pageSize = cbuf_mirror_granularity();
+}
+
+void tearDown(void)
+{
+}
+
+// Fill pattern that differs between pages
+static void fill_pattern(uint8_t *data, uint64_t len, uint8_t seed) {
+    for (uint64_t i = 0; i < len; i++) {
+        data[i] = (uint8_t)(seed + i + (i >> 12));
+    }
+}
+
+// Write and read wrapping data through a mirrored buffer of numPages pages
+static void check_wrapping_transfer(uint64_t numPages) {
+    cbuf_t cb;
+    uint64_t size = numPages * pageSize;
+    uint64_t capacity;
+    uint8_t *data = malloc(size);
+    uint8_t *readBuffer = malloc(size);
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_NOT_NULL(readBuffer);
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_mirrored(&cb, size));
+    TEST_ASSERT_EQUAL(size, cb.size);
+    TEST_ASSERT_TRUE(cb.flags & CBUF_FLAG_MIRRORED);
+    capacity = cbuf_get_free(&cb);
+
+    // Second half aliases the first one
+    cb.bufPtr[3] = 0x5A;
+    TEST_ASSERT_EQUAL_UINT8(0x5A, cb.bufPtr[size + 3]);
+    cb.bufPtr[size + size - 1] = 0xA5;
+    TEST_ASSERT_EQUAL_UINT8(0xA5, cb.bufPtr[size - 1]);
+
+    // Move positions close to the end of the buffer, then write across it
+    uint64_t startOffset = size - pageSize / 2 - 3;
+    memset(readBuffer, 0, size);
+    TEST_ASSERT_EQUAL(startOffset, cbuf_write(&cb, readBuffer, startOffset));
+    TEST_ASSERT_EQUAL(startOffset, cbuf_read(&cb, readBuffer, startOffset));
+
+    fill_pattern(data, size, (uint8_t)numPages);
+    TEST_ASSERT_EQUAL(capacity, cbuf_write(&cb, data, size));
+    TEST_ASSERT_EQUAL(capacity, cbuf_get_filled(&cb));
+    // Whole content is contiguous starting at readPos, including the wrapped part
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, &cb.bufPtr[startOffset], capacity);
+    // and the wrapped part landed at the start of the buffer
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&data[size - startOffset], cb.bufPtr, capacity - (size - startOffset));
+
+    memset(readBuffer, 0, size);
+    TEST_ASSERT_EQUAL(capacity / 2, cbuf_peek(&cb, readBuffer, capacity / 2));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBuffer, capacity / 2);
+    memset(readBuffer, 0, size);
+    TEST_ASSERT_EQUAL(capacity, cbuf_read(&cb, readBuffer, size));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBuffer, capacity);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+
+    TEST_ASSERT_EQUAL(1, cbuf_destroy_mirrored(&cb));
+    TEST_ASSERT_NULL(cb.bufPtr);
+    free(data);
+    free(readBuffer);
+}
+
+//
+void test_cbuf_init_mirrored_fail(void) {
+    cbuf_t cb;
+
+    TEST_ASSERT_EQUAL(0, cbuf_init_mirrored(NULL, pageSize));
+    TEST_ASSERT_EQUAL(0, cbuf_init_mirrored(&cb, 0));
+    TEST_ASSERT_EQUAL(0, cbuf_init_mirrored(&cb, pageSize + 1)); // not a multiple of page size
+    TEST_ASSERT_EQUAL(0, cbuf_destroy_mirrored(NULL));
+
+    uint8_t buffer[10];
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(0, cbuf_destroy_mirrored(&cb)); // not a mirrored buffer
+}
+
+//
+void test_cbuf_init_mirrored_pow2(void) {
+    cbuf_t cb;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_mirrored(&cb, 4 * pageSize));
+    TEST_ASSERT_EQUAL(4 * pageSize - 1, cb.mask); // masked, free-running indices
+    TEST_ASSERT_EQUAL(4 * pageSize, cbuf_get_free(&cb));
+    TEST_ASSERT_EQUAL(1, cbuf_destroy_mirrored(&cb));
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_mirrored(&cb, 3 * pageSize));
+    TEST_ASSERT_EQUAL(0, cb.mask);
+    TEST_ASSERT_EQUAL(3 * pageSize - 1, cbuf_get_free(&cb));
+    TEST_ASSERT_EQUAL(1, cbuf_destroy_mirrored(&cb));
+}
+
+//
+void test_cbuf_mirrored_one_page(void) {
+    check_wrapping_transfer(1);
+}
+
+//
+void test_cbuf_mirrored_three_pages(void) {
+    check_wrapping_transfer(3);
+}
+
+//
+void test_cbuf_mirrored_sixteen_pages(void) {
+    check_wrapping_transfer(16);
+}
+
+//
+void test_cbuf_mirrored_single_write_read(void) {
+    cbuf_t cb;
+    uint8_t readByte;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_mirrored(&cb, 2 * pageSize));
+    cb.writePos = cb.readPos = 2 * pageSize - 2;
+    for (uint8_t i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(1, cbuf_write_single(&cb, 10 + i));
+    }
+    TEST_ASSERT_EQUAL_UINT8(12, cb.bufPtr[0]); // wrapped into the first page
+    TEST_ASSERT_EQUAL_UINT8(12, cb.bufPtr[2 * pageSize]);
+    for (uint8_t i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(1, cbuf_read_single(&cb, &readByte));
+        TEST_ASSERT_EQUAL(10 + i, readByte);
+    }
+    TEST_ASSERT_EQUAL(0, cbuf_read_single(&cb, &readByte));
+    TEST_ASSERT_EQUAL(1, cbuf_destroy_mirrored(&cb));
+}
+
+//
+void test_cbuf_mirrored_zero_copy_single_span(void) {
+    cbuf_t cb;
+    uint8_t *wptr[2];
+    uint8_t const *rptr[2];
+    uint64_t len[2];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_mirrored(&cb, pageSize));
+    cb.writePos = cb.readPos = pageSize - 10;
+
+    // Free region wraps, but is handed out as a single span
+    TEST_ASSERT_EQUAL(100, cbuf_write_reserve(&cb, 100, wptr, len));
+    TEST_ASSERT_EQUAL_PTR(&cb.bufPtr[pageSize - 10], wptr[0]);
+    TEST_ASSERT_EQUAL(100, len[0]);
+    TEST_ASSERT_EQUAL(0, len[1]);
+    fill_pattern(wptr[0], 100, 7);
+    TEST_ASSERT_EQUAL(100, cbuf_write_commit(&cb, 100));
+
+    TEST_ASSERT_EQUAL(100, cbuf_read_acquire(&cb, rptr, len));
+    TEST_ASSERT_EQUAL(100, len[0]);
+    TEST_ASSERT_EQUAL(0, len[1]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(wptr[0], rptr[0], 100);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&rptr[0][10], cb.bufPtr, 90); // wrapped part
+    TEST_ASSERT_EQUAL(100, cbuf_read_release(&cb, 100));
+    TEST_ASSERT_EQUAL(1, cbuf_destroy_mirrored(&cb));
+}
@@ -0,0 +1,160 @@
+#include "unity.h"
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "cbuf_mpmc.h"
+
+#define MPMC_NUM_PRODUCERS 4
+#define MPMC_NUM_CONSUMERS 4
+#define MPMC_ITEMS_PER_PRODUCER 200000
+
+typedef struct {
+    uint32_t producer;
+    uint32_t seq;
+    uint64_t payload;
+} mpmc_item_t;
+
+typedef struct {
+    cbuf_mpmc_t *q;
+    uint32_t id;
+    uint64_t popped;
+    uint64_t payloadSum;
+    uint64_t orderErrors;
+} mpmc_worker_t;
+
+static uint64_t totalPopped;
+
+static void *producer(void *arg) {
+    mpmc_worker_t *w = (mpmc_worker_t *)arg;
+    for (uint32_t i = 0; i < MPMC_ITEMS_PER_PRODUCER; i++) {
+        mpmc_item_t item = {w->id, i, ((uint64_t)w->id << 32) | i};
+        while (!cbuf_mpmc_try_push(w->q, &item)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    mpmc_worker_t *w = (mpmc_worker_t *)arg;
+    int64_t lastSeq[MPMC_NUM_PRODUCERS];
+    mpmc_item_t item;
+
+    for (int i = 0; i < MPMC_NUM_PRODUCERS; i++) {
+        lastSeq[i] = -1;
+    }
+    while (__atomic_load_n(&totalPopped, __ATOMIC_RELAXED) < (uint64_t)MPMC_NUM_PRODUCERS * MPMC_ITEMS_PER_PRODUCER) {
+        if (!cbuf_mpmc_try_pop(w->q, &item)) {
+            sched_yield();
+            continue;
+        }
+        // Elements of one producer must be seen in order by any single consumer
+        if (item.producer >= MPMC_NUM_PRODUCERS || (int64_t)item.seq <= lastSeq[item.producer]
+            || item.payload != (((uint64_t)item.producer << 32) | item.seq)) {
+            w->orderErrors++;
+        }
+        else {
+            lastSeq[item.producer] = item.seq;
+        }
+        w->popped++;
+        w->payloadSum += item.payload;
+        __atomic_fetch_add(&totalPopped, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+void setUp(void)
+{
+    totalPopped = 0;
+}
+
+void tearDown(void)
+{
+}
+
+//
+void test_cbuf_mpmc_init(void) {
+    cbuf_mpmc_t q;
+    uint64_t buffer[CBUF_MPMC_BUFFER_SIZE(8, 12) / 8];
+
+    TEST_ASSERT_EQUAL(24, CBUF_MPMC_SLOT_SIZE(12)); // 8 bytes sequence + 12 bytes rounded up
+    TEST_ASSERT_EQUAL(0, cbuf_mpmc_init(NULL, buffer, sizeof(buffer), 12));
+    TEST_ASSERT_EQUAL(0, cbuf_mpmc_init(&q, NULL, sizeof(buffer), 12));
+    TEST_ASSERT_EQUAL(0, cbuf_mpmc_init(&q, buffer, sizeof(buffer), 0));
+    TEST_ASSERT_EQUAL(0, cbuf_mpmc_init(&q, (uint8_t *)buffer + 1, sizeof(buffer) - 8, 12)); // misaligned
+    TEST_ASSERT_EQUAL(0, cbuf_mpmc_init(&q, buffer, CBUF_MPMC_BUFFER_SIZE(6, 12), 12)); // 6 slots
+    TEST_ASSERT_EQUAL(0, cbuf_mpmc_init(&q, buffer, CBUF_MPMC_BUFFER_SIZE(1, 12), 12));
+
+    TEST_ASSERT_EQUAL(1, cbuf_mpmc_init(&q, buffer, sizeof(buffer), 12));
+    TEST_ASSERT_EQUAL(8, cbuf_mpmc_capacity(&q));
+    TEST_ASSERT_EQUAL_PTR(buffer, q.bufPtr);
+    TEST_ASSERT_EQUAL(0, q.enqueuePos);
+    TEST_ASSERT_EQUAL(0, q.dequeuePos);
+    // Indices shared by producers and consumers live on different cache lines
+    TEST_ASSERT_TRUE((uintptr_t)&q.dequeuePos - (uintptr_t)&q.enqueuePos >= CBUF_CACHE_LINE);
+}
+
+//
+void test_cbuf_mpmc_push_pop(void) {
+    cbuf_mpmc_t q;
+    uint64_t buffer[CBUF_MPMC_BUFFER_SIZE(4, sizeof(uint32_t)) / 8];
+    uint32_t value;
+
+    TEST_ASSERT_EQUAL(1, cbuf_mpmc_init(&q, buffer, sizeof(buffer), sizeof(uint32_t)));
+    TEST_ASSERT_EQUAL(0, cbuf_mpmc_try_pop(&q, &value)); // empty
+
+    // Several laps around the slots, FIFO order and full/empty detection
+    for (uint32_t lap = 0; lap < 5; lap++) {
+        for (uint32_t i = 0; i < 4; i++) {
+            value = lap * 100 + i;
+            TEST_ASSERT_EQUAL(1, cbuf_mpmc_try_push(&q, &value));
+        }
+        value = 0xDEAD;
+        TEST_ASSERT_EQUAL(0, cbuf_mpmc_try_push(&q, &value)); // full
+        for (uint32_t i = 0; i < 4; i++) {
+            TEST_ASSERT_EQUAL(1, cbuf_mpmc_try_pop(&q, &value));
+            TEST_ASSERT_EQUAL(lap * 100 + i, value);
+        }
+        TEST_ASSERT_EQUAL(0, cbuf_mpmc_try_pop(&q, &value)); // empty
+    }
+}
+
+//
+void test_cbuf_mpmc_threads(void) {
+    static uint64_t buffer[CBUF_MPMC_BUFFER_SIZE(64, sizeof(mpmc_item_t)) / 8];
+    cbuf_mpmc_t q;
+    pthread_t prodThreads[MPMC_NUM_PRODUCERS], consThreads[MPMC_NUM_CONSUMERS];
+    mpmc_worker_t prod[MPMC_NUM_PRODUCERS], cons[MPMC_NUM_CONSUMERS];
+    uint64_t popped = 0, payloadSum = 0, expectedSum = 0;
+
+    TEST_ASSERT_EQUAL(1, cbuf_mpmc_init(&q, buffer, sizeof(buffer), sizeof(mpmc_item_t)));
+    memset(prod, 0, sizeof(prod));
+    memset(cons, 0, sizeof(cons));
+    for (uint32_t i = 0; i < MPMC_NUM_CONSUMERS; i++) {
+        cons[i].q = &q;
+        TEST_ASSERT_EQUAL(0, pthread_create(&consThreads[i], NULL, consumer, &cons[i]));
+    }
+    for (uint32_t i = 0; i < MPMC_NUM_PRODUCERS; i++) {
+        prod[i].q = &q;
+        prod[i].id = i;
+        TEST_ASSERT_EQUAL(0, pthread_create(&prodThreads[i], NULL, producer, &prod[i]));
+    }
+    for (uint32_t i = 0; i < MPMC_NUM_PRODUCERS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_join(prodThreads[i], NULL));
+        for (uint64_t s = 0; s < MPMC_ITEMS_PER_PRODUCER; s++) {
+            expectedSum += ((uint64_t)i << 32) | s;
+        }
+    }
+    for (uint32_t i = 0; i < MPMC_NUM_CONSUMERS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_join(consThreads[i], NULL));
+        TEST_ASSERT_EQUAL_UINT64(0, cons[i].orderErrors);
+        popped += cons[i].popped;
+        payloadSum += cons[i].payloadSum;
+    }
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)MPMC_NUM_PRODUCERS * MPMC_ITEMS_PER_PRODUCER, popped);
+    TEST_ASSERT_EQUAL_UINT64(expectedSum, payloadSum);
+
+    mpmc_item_t item;
+    TEST_ASSERT_EQUAL(0, cbuf_mpmc_try_pop(&q, &item)); // nothing left
+}
@@ -0,0 +1,238 @@
+#include "unity.h"
+#include <string.h>
+
+#include "cbuf.h"
+#include "cbuf_msg.h"
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//
+void test_cbuf_msg_write_read(void) {
+#define DATA_SIZE 32
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t const msg1[5] = {1, 2, 3, 4, 5};
+    uint8_t const msg2[3] = {9, 8, 7};
+    uint8_t readBuffer[DATA_SIZE];
+    uint32_t len = 0;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_msg_peek_len(&cb, &len)); // empty
+    TEST_ASSERT_EQUAL(0, cbuf_msg_read(&cb, readBuffer, sizeof(readBuffer), &len));
+
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, msg1, sizeof(msg1)));
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, msg2, sizeof(msg2)));
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, NULL, 0)); // empty message is still a message
+    TEST_ASSERT_EQUAL(3 * CBUF_MSG_HEADER_SIZE + 8, cbuf_get_filled(&cb));
+
+    TEST_ASSERT_EQUAL(1, cbuf_msg_peek_len(&cb, &len));
+    TEST_ASSERT_EQUAL(5, len);
+    TEST_ASSERT_EQUAL(3 * CBUF_MSG_HEADER_SIZE + 8, cbuf_get_filled(&cb)); // nothing consumed
+
+    // Too small buffer: message stays in place, length is reported
+    TEST_ASSERT_EQUAL(0, cbuf_msg_read(&cb, readBuffer, 4, &len));
+    TEST_ASSERT_EQUAL(5, len);
+
+    TEST_ASSERT_EQUAL(1, cbuf_msg_read(&cb, readBuffer, sizeof(readBuffer), &len));
+    TEST_ASSERT_EQUAL(5, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(msg1, readBuffer, 5);
+    TEST_ASSERT_EQUAL(1, cbuf_msg_read(&cb, readBuffer, sizeof(readBuffer), &len));
+    TEST_ASSERT_EQUAL(3, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(msg2, readBuffer, 3);
+    TEST_ASSERT_EQUAL(1, cbuf_msg_read(&cb, readBuffer, sizeof(readBuffer), &len));
+    TEST_ASSERT_EQUAL(0, len);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_msg_all_or_nothing(void) {
+#define DATA_SIZE 16
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t const msg[DATA_SIZE] = {0};
+    uint32_t len;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_msg_write(&cb, msg, DATA_SIZE - CBUF_MSG_HEADER_SIZE)); // one byte short
+    TEST_ASSERT_EQUAL(0, cbuf_get_filled(&cb));
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, msg, 6));
+    TEST_ASSERT_EQUAL(0, cbuf_msg_write(&cb, msg, 6)); // 5 bytes left, not written partially
+    TEST_ASSERT_EQUAL(10, cbuf_get_filled(&cb));
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, msg, 1));
+    TEST_ASSERT_EQUAL(0, cbuf_get_free(&cb));
+    TEST_ASSERT_EQUAL(1, cbuf_msg_peek_len(&cb, &len));
+    TEST_ASSERT_EQUAL(6, len);
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_msg_wrap_marker(void) {
+#define DATA_SIZE 32
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t const msg[8] = {10, 11, 12, 13, 14, 15, 16, 17};
+    uint8_t const *payload;
+    uint32_t len, marker;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, DATA_SIZE));
+    cb.writePos = cb.readPos = 22; // 10 bytes before end: room for a marker, not for the message
+
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, msg, 8));
+    memcpy(&marker, &buffer[22], sizeof(marker));
+    TEST_ASSERT_EQUAL_HEX32(CBUF_MSG_WRAP, marker);
+    memcpy(&len, &buffer[0], sizeof(len));
+    TEST_ASSERT_EQUAL(8, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, &buffer[CBUF_MSG_HEADER_SIZE], 8); // contiguous
+    TEST_ASSERT_EQUAL(22 + 10 + CBUF_MSG_HEADER_SIZE + 8, cb.writePos); // single index update
+
+    payload = cbuf_msg_read_acquire(&cb, &len);
+    TEST_ASSERT_EQUAL_PTR(&buffer[CBUF_MSG_HEADER_SIZE], payload);
+    TEST_ASSERT_EQUAL(8, len);
+    TEST_ASSERT_EQUAL(1, cbuf_msg_read_release(&cb));
+    TEST_ASSERT_EQUAL(cb.writePos, cb.readPos);
+    TEST_ASSERT_EQUAL(0, cbuf_msg_read_release(&cb));
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_msg_wrap_no_room_for_marker(void) {
+#define DATA_SIZE 16
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t const msg[4] = {21, 22, 23, 24};
+    uint8_t readBuffer[4];
+    uint32_t len;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    cb.writePos = cb.readPos = 14; // only 2 bytes before end, implicit skip
+    memset(buffer, 0xEE, sizeof(buffer));
+
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, msg, 4));
+    TEST_ASSERT_EQUAL_UINT8(0xEE, buffer[14]); // tail is left untouched
+    TEST_ASSERT_EQUAL(8, cb.writePos);
+    TEST_ASSERT_EQUAL(1, cbuf_msg_read(&cb, readBuffer, sizeof(readBuffer), &len));
+    TEST_ASSERT_EQUAL(4, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, readBuffer, 4);
+    TEST_ASSERT_EQUAL(8, cb.readPos);
+
+    // Padding counts against free space: 15 usable, 10 till end, message needs 10 + 4 + 8
+    cb.writePos = cb.readPos = 6;
+    TEST_ASSERT_NULL(cbuf_msg_write_reserve(&cb, 8));
+    TEST_ASSERT_EQUAL(0, cbuf_msg_write(&cb, readBuffer, 8));
+    TEST_ASSERT_NOT_NULL(cbuf_msg_write_reserve(&cb, 6)); // fits before end, no padding
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_msg_reserve_commit(void) {
+#define DATA_SIZE 64
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readBuffer[DATA_SIZE];
+    uint8_t *payload;
+    uint32_t len;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_msg_write_commit(&cb, NULL, 1));
+
+    // Reserve for the worst case, commit what was actually produced
+    payload = cbuf_msg_write_reserve(&cb, 20);
+    TEST_ASSERT_EQUAL_PTR(&buffer[CBUF_MSG_HEADER_SIZE], payload);
+    memcpy(payload, "hello", 5);
+    TEST_ASSERT_EQUAL(0, cbuf_get_filled(&cb)); // not visible yet
+    TEST_ASSERT_EQUAL(0, cbuf_msg_write_commit(&cb, payload + 1, 5)); // not a reserved pointer
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write_commit(&cb, payload, 5));
+    TEST_ASSERT_EQUAL(CBUF_MSG_HEADER_SIZE + 5, cb.writePos);
+
+    TEST_ASSERT_EQUAL(1, cbuf_msg_read(&cb, readBuffer, sizeof(readBuffer), &len));
+    TEST_ASSERT_EQUAL(5, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY("hello", readBuffer, 5);
+
+    // Reservation moved to the start of buffer
+    cb.writePos = cb.readPos = 2 * DATA_SIZE + 50;
+    payload = cbuf_msg_write_reserve(&cb, 20);
+    TEST_ASSERT_EQUAL_PTR(&buffer[CBUF_MSG_HEADER_SIZE], payload);
+    memcpy(payload, "wrapped", 7);
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write_commit(&cb, payload, 7));
+    TEST_ASSERT_EQUAL(2 * DATA_SIZE + 50 + 14 + CBUF_MSG_HEADER_SIZE + 7, cb.writePos);
+    TEST_ASSERT_EQUAL(1, cbuf_msg_read(&cb, readBuffer, sizeof(readBuffer), &len));
+    TEST_ASSERT_EQUAL(7, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY("wrapped", readBuffer, 7);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_msg_many_laps(void) {
+#define DATA_SIZE 61 // odd size, cbuf_init() index scheme
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t msg[20], readBuffer[20];
+    uint32_t len, written = 0, read = 0;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    while (read < 1000) {
+        uint32_t msgLen = written % 20;
+        memset(msg, (int)written, msgLen);
+        if (cbuf_msg_write(&cb, msg, msgLen)) {
+            written++;
+            if (written % 3) {
+                continue; // let a few messages pile up
+            }
+        }
+        TEST_ASSERT_EQUAL(1, cbuf_msg_read(&cb, readBuffer, sizeof(readBuffer), &len));
+        TEST_ASSERT_EQUAL(read % 20, len);
+        memset(msg, (int)read, len);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, readBuffer, len);
+        read++;
+    }
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_msg_iter(void) {
+#define DATA_SIZE 32
+    cbuf_t cb;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t const msg[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    cbuf_msg_iter_t it;
+    uint8_t const *payload;
+    uint32_t len = 0;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    cbuf_msg_iter_begin(&cb, &it);
+    TEST_ASSERT_NULL(cbuf_msg_iter_next(&cb, &it, &len)); // empty
+
+    // Three messages, the third is written after the snapshot and wraps around
+    cb.readPos = cb.writePos = 10;
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, msg, 4));
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, &msg[4], 2));
+    cbuf_msg_iter_begin(&cb, &it);
+    TEST_ASSERT_EQUAL(1, cbuf_msg_write(&cb, &msg[5], 5));
+    payload = cbuf_msg_iter_next(&cb, &it, &len);
+    TEST_ASSERT_EQUAL(4, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, payload, 4);
+    payload = cbuf_msg_iter_next(&cb, &it, &len);
+    TEST_ASSERT_EQUAL(2, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&msg[4], payload, 2);
+    TEST_ASSERT_NULL(cbuf_msg_iter_next(&cb, &it, &len));
+    TEST_ASSERT_EQUAL(10, cb.readPos); // nothing consumed yet
+
+    cbuf_msg_iter_commit(&cb, &it);
+    TEST_ASSERT_EQUAL(24, cb.readPos);
+    cbuf_msg_iter_begin(&cb, &it);
+    payload = cbuf_msg_iter_next(&cb, &it, &len);
+    TEST_ASSERT_EQUAL(5, len);
+    TEST_ASSERT_EQUAL_PTR(&buffer[CBUF_MSG_HEADER_SIZE], payload); // wrapped to the start
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&msg[5], payload, 5);
+    cbuf_msg_iter_commit(&cb, &it);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+#undef DATA_SIZE
+}
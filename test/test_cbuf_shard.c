@@ -0,0 +1,238 @@
+#include "unity.h"
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "cbuf.h"
+#include "cbuf_msg.h"
+#include "cbuf_shard.h"
+
+#define STRESS_THREADS 4
+#define STRESS_RECORDS 200000
+
+static cbuf_shard_set_t set;
+
+typedef struct {
+    uint32_t thread;
+    bool perCpu;
+} writer_t;
+
+void setUp(void)
+{
+    memset(&set, 0, sizeof(set));
+}
+
+void tearDown(void)
+{
+    cbuf_shard_set_destroy(&set);
+}
+
+//
+void test_cbuf_shard_init(void) {
+    TEST_ASSERT_EQUAL(0, cbuf_shard_set_init(NULL, 2, 64, 0));
+    TEST_ASSERT_EQUAL(0, cbuf_shard_set_init(&set, 2, 1, 0));
+
+    TEST_ASSERT_EQUAL(1, cbuf_shard_set_init(&set, 3, 100, 0));
+    TEST_ASSERT_EQUAL(3, set.count);
+    TEST_ASSERT_EQUAL(128, set.stride);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)set.shards % CBUF_CACHE_LINE);
+    for (uint32_t i = 0; i < set.count; i++) {
+        TEST_ASSERT_EQUAL(100, set.shards[i].cb.size);
+        TEST_ASSERT_EQUAL(0, set.shards[i].cb.mask); // cbuf_init() scheme
+        TEST_ASSERT_EQUAL(0, (uintptr_t)set.shards[i].cb.bufPtr % CBUF_CACHE_LINE);
+    }
+    // Slices of one allocation, right after the shards
+    TEST_ASSERT_EQUAL_PTR((uint8_t *)&set.shards[3], set.shards[0].cb.bufPtr);
+    TEST_ASSERT_EQUAL_PTR(set.shards[0].cb.bufPtr + 128, set.shards[1].cb.bufPtr);
+    cbuf_shard_set_destroy(&set);
+
+    TEST_ASSERT_EQUAL(1, cbuf_shard_set_init(&set, 0, 256, 0)); // one per CPU
+    TEST_ASSERT_TRUE(set.count >= 1);
+    TEST_ASSERT_EQUAL(255, set.shards[0].cb.mask);
+}
+
+//
+void test_cbuf_shard_drain(void) {
+    cbuf_shard_record_t records[8];
+    char text[8];
+
+    TEST_ASSERT_EQUAL(1, cbuf_shard_set_init(&set, 3, 64, 0));
+    TEST_ASSERT_EQUAL(0, cbuf_shard_drain(&set, records, 8)); // empty
+    cbuf_shard_drain_release(&set);
+    TEST_ASSERT_EQUAL(0, cbuf_shard_write(&set, 3, "x", 1)); // no such shard
+
+    TEST_ASSERT_EQUAL(1, cbuf_shard_write(&set, 0, "a0", 2));
+    TEST_ASSERT_EQUAL(1, cbuf_shard_write(&set, 2, "c0", 2));
+    TEST_ASSERT_EQUAL(1, cbuf_shard_write(&set, 0, "a1", 2));
+    TEST_ASSERT_EQUAL(1, cbuf_shard_write(&set, 1, "b0", 2));
+
+    // Shard by shard, starting one further than the (empty) drain before
+    TEST_ASSERT_EQUAL(3, cbuf_shard_drain(&set, records, 3));
+    TEST_ASSERT_EQUAL(1, records[0].shard);
+    TEST_ASSERT_EQUAL_MEMORY("b0", records[0].data, 2);
+    TEST_ASSERT_EQUAL(2, records[0].len);
+    TEST_ASSERT_EQUAL(0, records[0].timestamp);
+    TEST_ASSERT_EQUAL(2, records[1].shard);
+    TEST_ASSERT_EQUAL_MEMORY("c0", records[1].data, 2);
+    TEST_ASSERT_EQUAL(0, records[2].shard);
+    TEST_ASSERT_EQUAL_MEMORY("a0", records[2].data, 2);
+    cbuf_shard_drain_release(&set);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&set.shards[1].cb));
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&set.shards[2].cb));
+
+    // A partial batch keeps the rest
+    TEST_ASSERT_EQUAL(1, cbuf_shard_write(&set, 0, "a2", 2));
+    TEST_ASSERT_EQUAL(2, cbuf_shard_drain(&set, records, 8));
+    TEST_ASSERT_EQUAL(0, records[0].shard);
+    TEST_ASSERT_EQUAL_MEMORY("a1", records[0].data, 2);
+    TEST_ASSERT_EQUAL_MEMORY("a2", records[1].data, 2);
+    cbuf_shard_drain_release(&set);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&set.shards[0].cb));
+
+    // Full shard drops the record and counts it
+    memset(text, 'x', sizeof(text));
+    uint32_t written = 0;
+    while (cbuf_shard_write(&set, 1, text, sizeof(text))) {
+        written++;
+    }
+    // 4 + 8 bytes each from offset 6, the fifth does not fit before the end and
+    // there is no room left to skip to the start
+    TEST_ASSERT_EQUAL(4, written);
+    TEST_ASSERT_EQUAL(1, cbuf_shard_get_dropped(&set));
+    TEST_ASSERT_EQUAL(4, cbuf_shard_drain(&set, records, 8));
+    cbuf_shard_drain_release(&set);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&set.shards[1].cb));
+}
+
+//
+void test_cbuf_shard_drain_timestamps(void) {
+    cbuf_shard_record_t records[8];
+    struct timespec pause = {0, 1000};
+
+    TEST_ASSERT_EQUAL(1, cbuf_shard_set_init(&set, 3, 256, CBUF_SHARD_TIMESTAMPS));
+    char const *order[6] = {"1", "22", "333", "4444", "55555", "666666"};
+    uint32_t const shardOf[6] = {2, 0, 0, 1, 2, 0};
+    for (int i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL(1, cbuf_shard_write(&set, shardOf[i], order[i], (uint32_t)strlen(order[i])));
+        nanosleep(&pause, NULL); // distinct timestamps
+    }
+
+    // Merged by time across shards, a partial batch keeps the rest
+    TEST_ASSERT_EQUAL(4, cbuf_shard_drain(&set, records, 4));
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(shardOf[i], records[i].shard);
+        TEST_ASSERT_EQUAL(strlen(order[i]), records[i].len);
+        TEST_ASSERT_EQUAL_MEMORY(order[i], records[i].data, records[i].len);
+        TEST_ASSERT_TRUE(i == 0 || records[i].timestamp > records[i - 1].timestamp);
+    }
+    cbuf_shard_drain_release(&set);
+    TEST_ASSERT_EQUAL(2, cbuf_shard_drain(&set, records, 8));
+    TEST_ASSERT_EQUAL_MEMORY(order[4], records[0].data, 5);
+    TEST_ASSERT_EQUAL_MEMORY(order[5], records[1].data, 6);
+    cbuf_shard_drain_release(&set);
+    for (uint32_t i = 0; i < set.count; i++) {
+        TEST_ASSERT_EQUAL(true, cbuf_is_empty(&set.shards[i].cb));
+    }
+}
+
+static void *writer(void *arg) {
+    writer_t const *w = (writer_t const *)arg;
+    uint32_t record[2] = {w->thread, 0};
+
+    while (record[1] < STRESS_RECORDS) {
+        bool ok = w->perCpu ? cbuf_shard_write_cpu(&set, record, sizeof(record))
+                            : cbuf_shard_write(&set, w->thread, record, sizeof(record));
+        if (ok) {
+            record[1]++;
+        }
+        else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// STRESS_THREADS writers, every record has to come out exactly once. With
+// owned shards the records of each thread also have to come out in order.
+static void run_stress(bool perCpu) {
+    static cbuf_shard_record_t records[256];
+    static uint8_t seen[STRESS_THREADS][STRESS_RECORDS];
+    pthread_t threads[STRESS_THREADS];
+    writer_t writers[STRESS_THREADS];
+    uint32_t next[STRESS_THREADS] = {0};
+    uint64_t total = 0, mismatches = 0, duplicates = 0;
+
+    memset(seen, 0, sizeof(seen));
+
+    for (uint32_t i = 0; i < STRESS_THREADS; i++) {
+        writers[i].thread = i;
+        writers[i].perCpu = perCpu;
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, writer, &writers[i]));
+    }
+    while (total < (uint64_t)STRESS_THREADS * STRESS_RECORDS) {
+        uint32_t count = cbuf_shard_drain(&set, records, 256);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t record[2];
+            TEST_ASSERT_EQUAL(sizeof(record), records[i].len);
+            memcpy(record, records[i].data, sizeof(record));
+            TEST_ASSERT_TRUE(record[0] < STRESS_THREADS);
+            TEST_ASSERT_TRUE(record[1] < STRESS_RECORDS);
+            duplicates += seen[record[0]][record[1]];
+            seen[record[0]][record[1]] = 1;
+            mismatches += (record[1] != next[record[0]]);
+            next[record[0]] = record[1] + 1;
+        }
+        cbuf_shard_drain_release(&set);
+        total += count;
+        if (0 == count) {
+            sched_yield();
+        }
+    }
+    for (uint32_t i = 0; i < STRESS_THREADS; i++) {
+        TEST_ASSERT_EQUAL(0, pthread_join(threads[i], NULL));
+    }
+    TEST_ASSERT_EQUAL_UINT64(0, duplicates); // with total, all records came out
+    if (!perCpu) {
+        TEST_ASSERT_EQUAL_UINT64(0, mismatches);
+    }
+    TEST_ASSERT_EQUAL(0, cbuf_shard_drain(&set, records, 256));
+}
+
+//
+void test_cbuf_shard_stress_per_thread(void) {
+    TEST_ASSERT_EQUAL(1, cbuf_shard_set_init(&set, STRESS_THREADS, 4096, 0));
+    run_stress(false);
+}
+
+//
+void test_cbuf_shard_stress_per_cpu(void) {
+    // Fewer shards than writers, so shards are shared and taken over
+    TEST_ASSERT_EQUAL(1, cbuf_shard_set_init(&set, 2, 4096, 0));
+    run_stress(true);
+}
+
+//
+void test_cbuf_shard_write_cpu_held(void) {
+    cbuf_shard_record_t records[8];
+    uint32_t const n = 4;
+
+    // Held shards are passed over, whichever CPU the thread runs on
+    TEST_ASSERT_EQUAL(1, cbuf_shard_set_init(&set, n, 64, 0));
+    for (uint32_t i = 0; i < n - 1; i++) {
+        set.shards[i].lock = 1;
+    }
+    TEST_ASSERT_EQUAL(1, cbuf_shard_write_cpu(&set, "r0", 2));
+    TEST_ASSERT_EQUAL(false, cbuf_is_empty(&set.shards[n - 1].cb));
+
+    // All shards held: dropped, never waits
+    set.shards[n - 1].lock = 1;
+    TEST_ASSERT_EQUAL(0, cbuf_shard_write_cpu(&set, "r1", 2));
+    TEST_ASSERT_EQUAL(1, cbuf_shard_get_dropped(&set));
+    for (uint32_t i = 0; i < n; i++) {
+        set.shards[i].lock = 0;
+    }
+    TEST_ASSERT_EQUAL(1, cbuf_shard_drain(&set, records, 8));
+    TEST_ASSERT_EQUAL_MEMORY("r0", records[0].data, 2);
+    cbuf_shard_drain_release(&set);
+}
@@ -0,0 +1,235 @@
+#define _GNU_SOURCE // memfd_create()
+#include "unity.h"
+#include <string.h>
+#include <stdio.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cbuf.h"
+#include "cbuf_shm.h"
+
+#define SHM_STREAM_BYTES (8 * 1024 * 1024)
+
+static char shmName[64];
+
+static inline uint8_t stream_byte(uint64_t i) {
+    return (uint8_t)(i ^ (i >> 8) ^ (i >> 16));
+}
+
+// Producer side of the cross-process tests, runs in the child.
+// Exits with 0 on success, no Unity assertions outside of the test process.
+static void child_produce(cbuf_shm_t *shm) {
+    uint8_t chunk[1500];
+    uint64_t offset = 0;
+
+    while (offset < SHM_STREAM_BYTES) {
+        uint64_t len = SHM_STREAM_BYTES - offset;
+        if (len > sizeof(chunk)) {
+            len = sizeof(chunk);
+        }
+        for (uint64_t i = 0; i < len; i++) {
+            chunk[i] = stream_byte(offset + i);
+        }
+        uint64_t written = 0;
+        while (written < len) {
+            uint64_t n = cbuf_shm_write(shm, &chunk[written], len - written);
+            if (0 == n) {
+                sched_yield();
+            }
+            written += n;
+        }
+        offset += len;
+    }
+    _exit(cbuf_shm_detach(shm) ? 0 : 1);
+}
+
+// Consumer side, runs in the test process
+static void parent_consume(cbuf_shm_t *shm, pid_t child) {
+    uint8_t chunk[1000];
+    uint64_t offset = 0, mismatches = 0;
+    int status;
+
+    while (offset < SHM_STREAM_BYTES) {
+        uint64_t n = cbuf_shm_read(shm, chunk, sizeof(chunk));
+        if (0 == n) {
+            sched_yield();
+            continue;
+        }
+        for (uint64_t i = 0; i < n; i++) {
+            if (chunk[i] != stream_byte(offset + i)) {
+                mismatches++;
+            }
+        }
+        offset += n;
+    }
+    TEST_ASSERT_EQUAL(child, waitpid(child, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status));
+    TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+    TEST_ASSERT_EQUAL_UINT64(SHM_STREAM_BYTES, offset);
+    TEST_ASSERT_EQUAL_UINT64(0, mismatches);
+    TEST_ASSERT_EQUAL(0, cbuf_shm_get_filled(shm));
+}
+
+void setUp(void)
+{
+    snprintf(shmName, sizeof(shmName), "/cbuf_test_%d", (int)getpid());
+}
+
+void tearDown(void)
+{
+    cbuf_shm_unlink(shmName);
+}
+
+//
+void test_cbuf_shm_create_fail(void) {
+    cbuf_shm_t shm, other;
+
+    TEST_ASSERT_EQUAL(0, cbuf_shm_create(NULL, NULL, 64));
+    TEST_ASSERT_EQUAL(0, cbuf_shm_create(&shm, NULL, 1));
+    TEST_ASSERT_EQUAL(0, cbuf_shm_attach(&shm, shmName)); // does not exist
+    TEST_ASSERT_EQUAL(0, cbuf_shm_detach(NULL));
+
+    TEST_ASSERT_EQUAL(1, cbuf_shm_create(&shm, shmName, 64));
+    TEST_ASSERT_EQUAL(0, cbuf_shm_create(&other, shmName, 64)); // exists already
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&shm));
+    TEST_ASSERT_EQUAL(1, cbuf_shm_unlink(shmName));
+
+    // Not a cbuf_shm object
+    int fd = memfd_create("not_cbuf", 0);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(0, ftruncate(fd, 4096));
+    TEST_ASSERT_EQUAL(0, cbuf_shm_attach_fd(&shm, fd));
+    close(fd);
+}
+
+//
+void test_cbuf_shm_attach_corrupt(void) {
+    cbuf_shm_t shm, other;
+
+    TEST_ASSERT_EQUAL(1, cbuf_shm_create(&shm, shmName, 64));
+    cbuf_shm_header_t *h = shm.header;
+    cbuf_shm_header_t const good = *h;
+    cbuf_shm_header_t bad[6];
+    for (int i = 0; i < 6; i++) {
+        bad[i] = good;
+    }
+    bad[0].mask     = 31;  // not size - 1
+    bad[1].size     = 128; // larger than the mapping
+    bad[1].mask     = 127;
+    bad[2].size     = 32;  // smaller than the mapping
+    bad[2].mask     = 31;
+    bad[3].writePos = 70;  // pow2: more filled than size
+    bad[3].readPos  = 5;
+    bad[4].mask     = 0;   // cbuf_init() scheme: indices beyond size
+    bad[4].readPos  = 64;
+    bad[5].mask     = 0;
+    bad[5].writePos = 100;
+
+    for (int i = 0; i < 6; i++) {
+        *h = bad[i];
+        TEST_ASSERT_EQUAL_MESSAGE(0, cbuf_shm_attach(&other, shmName), "corrupt header accepted");
+    }
+    *h = good;
+    h->writePos = 1000; // free-running pow2 indices are fine
+    h->readPos  = 990;
+    TEST_ASSERT_EQUAL(1, cbuf_shm_attach(&other, shmName));
+    TEST_ASSERT_EQUAL(10, cbuf_shm_get_filled(&other));
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&other));
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&shm));
+
+    // Changes after attach: size and mask stay as checked, bad indices are refused
+    uint8_t data[64] = {0};
+    TEST_ASSERT_EQUAL(1, cbuf_shm_create(&shm, NULL, 64));
+    h = shm.header;
+    TEST_ASSERT_EQUAL(10, cbuf_shm_write(&shm, data, 10));
+    h->size = 1u << 20;
+    h->mask = (1u << 20) - 1;
+    TEST_ASSERT_EQUAL(54, cbuf_shm_get_free(&shm));
+    TEST_ASSERT_EQUAL(54, cbuf_shm_write(&shm, data, sizeof(data)));
+    h->writePos = h->readPos + 1000; // pow2: more filled than size
+    TEST_ASSERT_EQUAL(0, cbuf_shm_get_filled(&shm));
+    TEST_ASSERT_EQUAL(0, cbuf_shm_get_free(&shm));
+    TEST_ASSERT_EQUAL(0, cbuf_shm_read(&shm, data, sizeof(data)));
+    TEST_ASSERT_EQUAL(0, cbuf_shm_write(&shm, data, 1));
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&shm));
+
+    TEST_ASSERT_EQUAL(1, cbuf_shm_create(&shm, NULL, 100));
+    h = shm.header;
+    h->readPos = 100; // cbuf_init() scheme: index beyond size
+    TEST_ASSERT_EQUAL(0, cbuf_shm_write(&shm, data, 10));
+    TEST_ASSERT_EQUAL(0, cbuf_shm_read(&shm, data, 10));
+    h->readPos  = 0;
+    h->writePos = 1000;
+    TEST_ASSERT_EQUAL(0, cbuf_shm_read(&shm, data, 10));
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&shm));
+}
+
+//
+void test_cbuf_shm_layout(void) {
+    cbuf_shm_t shm, other;
+    uint8_t const data[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    uint8_t readBuffer[10] = {0};
+
+    TEST_ASSERT_EQUAL(1, cbuf_shm_create(&shm, shmName, 64));
+    TEST_ASSERT_EQUAL(63, shm.header->mask); // power of two, whole buffer usable
+    TEST_ASSERT_EQUAL(64, cbuf_shm_get_free(&shm));
+    TEST_ASSERT_EQUAL_PTR((uint8_t *)shm.header + shm.header->dataOffset, shm.bufPtr);
+
+    // Second mapping in the same process lands at another address
+    TEST_ASSERT_EQUAL(1, cbuf_shm_attach(&other, shmName));
+    TEST_ASSERT_TRUE(other.header != shm.header);
+    TEST_ASSERT_EQUAL(10, cbuf_shm_write(&shm, data, sizeof(data)));
+    TEST_ASSERT_EQUAL(10, cbuf_shm_get_filled(&other));
+    TEST_ASSERT_EQUAL(10, cbuf_shm_read(&other, readBuffer, sizeof(readBuffer)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBuffer, sizeof(data));
+    TEST_ASSERT_EQUAL(0, cbuf_shm_get_filled(&shm));
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&other));
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&shm));
+
+    // Other sizes use the cbuf_init() scheme
+    TEST_ASSERT_EQUAL(1, cbuf_shm_create(&shm, NULL, 100));
+    TEST_ASSERT_EQUAL(0, shm.header->mask);
+    TEST_ASSERT_EQUAL(99, cbuf_shm_get_free(&shm));
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&shm));
+}
+
+//
+void test_cbuf_shm_fork_named(void) {
+    cbuf_shm_t shm;
+
+    TEST_ASSERT_EQUAL(1, cbuf_shm_create(&shm, shmName, 4096 + 5));
+    fflush(stdout);
+    pid_t child = fork();
+    TEST_ASSERT_TRUE(child >= 0);
+    if (0 == child) {
+        // Map it again by name, as an unrelated process would
+        cbuf_shm_t producer;
+        if (!cbuf_shm_attach(&producer, shmName)) {
+            _exit(2);
+        }
+        child_produce(&producer);
+    }
+    parent_consume(&shm, child);
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&shm));
+}
+
+//
+void test_cbuf_shm_fork_memfd(void) {
+    cbuf_shm_t shm;
+
+    TEST_ASSERT_EQUAL(1, cbuf_shm_create(&shm, NULL, 8192));
+    fflush(stdout);
+    pid_t child = fork();
+    TEST_ASSERT_TRUE(child >= 0);
+    if (0 == child) {
+        cbuf_shm_t producer;
+        if (!cbuf_shm_attach_fd(&producer, dup(shm.fd))) {
+            _exit(2);
+        }
+        child_produce(&producer);
+    }
+    parent_consume(&shm, child);
+    TEST_ASSERT_EQUAL(1, cbuf_shm_detach(&shm));
+}
@@ -0,0 +1,209 @@
+#include "unity.h"
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "cbuf.h"
+#include "cbuf_spsc.h"
+
+// Total number of bytes pushed through the ring by the stress test.
+// Can be overridden at compile time, e.g. -DSPSC_STRESS_TOTAL_BYTES=1000000
+#ifndef SPSC_STRESS_TOTAL_BYTES
+#define SPSC_STRESS_TOTAL_BYTES (4ULL * 1024 * 1024 * 1024)
+#endif
+
+#define SPSC_STRESS_BUF_SIZE (64 * 1024 + 7) // Not a power of two on purpose
+#define SPSC_STRESS_MAX_CHUNK 4096
+
+typedef struct {
+    cbuf_t *cb;
+    cbuf_spsc_t *q; // cbuf_spsc_write()/cbuf_spsc_read() instead if set
+    uint64_t totalBytes;
+    uint64_t bytesDone;
+    uint64_t mismatches;
+} spsc_stress_t;
+
+// Byte at stream offset i. Mixes in higher bits so that skipped or
+// duplicated blocks of 256 bytes are detected as well.
+static inline uint8_t stream_byte(uint64_t i) {
+    return (uint8_t)(i ^ (i >> 8) ^ (i >> 16) ^ (i >> 24));
+}
+
+// xorshift, gives each side its own sequence of chunk sizes
+static inline uint32_t next_rand(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void *producer(void *arg) {
+    spsc_stress_t *s = (spsc_stress_t *)arg;
+    uint8_t chunk[SPSC_STRESS_MAX_CHUNK];
+    uint32_t rng = 0x12345678;
+    uint64_t offset = 0;
+
+    while (offset < s->totalBytes) {
+        uint64_t len = 1 + next_rand(&rng) % SPSC_STRESS_MAX_CHUNK;
+        if (len > s->totalBytes - offset) {
+            len = s->totalBytes - offset;
+        }
+        for (uint64_t i = 0; i < len; i++) {
+            chunk[i] = stream_byte(offset + i);
+        }
+        uint64_t written = 0;
+        while (written < len) {
+            uint64_t n = s->q ? cbuf_spsc_write(s->q, &chunk[written], len - written)
+                              : cbuf_write_spsc(s->cb, &chunk[written], len - written);
+            if (0 == n) {
+                sched_yield();
+            }
+            written += n;
+        }
+        offset += len;
+    }
+    s->bytesDone = offset;
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    spsc_stress_t *s = (spsc_stress_t *)arg;
+    uint8_t chunk[SPSC_STRESS_MAX_CHUNK];
+    uint32_t rng = 0x9abcdef1;
+    uint64_t offset = 0;
+
+    while (offset < s->totalBytes) {
+        uint64_t len = 1 + next_rand(&rng) % SPSC_STRESS_MAX_CHUNK;
+        uint64_t n = s->q ? cbuf_spsc_read(s->q, chunk, len) : cbuf_read_spsc(s->cb, chunk, len);
+        if (0 == n) {
+            sched_yield();
+            continue;
+        }
+        for (uint64_t i = 0; i < n; i++) {
+            if (chunk[i] != stream_byte(offset + i)) {
+                s->mismatches++;
+            }
+        }
+        offset += n;
+    }
+    s->bytesDone = offset;
+    return NULL;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//
+void test_cbuf_spsc_single_thread(void) {
+#define DATA_SIZE 10
+    cbuf_t cb;
+    uint8_t const mockData[DATA_SIZE] = {32, 50, 81, 60, 48, 58, 29, 13, 48, 57};
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readBuffer[DATA_SIZE] = {0};
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_read_spsc(&cb, readBuffer, 5)); // empty
+    TEST_ASSERT_EQUAL(0, cbuf_write_spsc(&cb, mockData, 0));
+
+    // Only (size - 1) bytes fit, same as cbuf_write()
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, cbuf_write_spsc(&cb, mockData, DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_write_spsc(&cb, mockData, 1)); // full
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, cbuf_get_filled(&cb));
+
+    TEST_ASSERT_EQUAL(4, cbuf_read_spsc(&cb, readBuffer, 4));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, 4);
+
+    // [o - o - o - o - r - x - x - x - x - w] -> write wraps around
+    TEST_ASSERT_EQUAL(4, cbuf_write_spsc(&cb, mockData, 4));
+    TEST_ASSERT_EQUAL(3, cb.writePos);
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, cbuf_read_spsc(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&mockData[4], readBuffer, 5);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, &readBuffer[5], 4);
+    TEST_ASSERT_EQUAL(cb.writePos, cb.readPos);
+#undef DATA_SIZE
+}
+
+// Runs one producer and one consumer thread over cb (or q) until
+// SPSC_STRESS_TOTAL_BYTES went through, then checks the results.
+static void run_stress(cbuf_t *cb, cbuf_spsc_t *q) {
+    pthread_t prodThread, consThread;
+    spsc_stress_t prod = {0}, cons = {0};
+
+    prod.cb = cons.cb = cb;
+    prod.q = cons.q = q;
+    prod.totalBytes = cons.totalBytes = SPSC_STRESS_TOTAL_BYTES;
+
+    TEST_ASSERT_EQUAL(0, pthread_create(&consThread, NULL, consumer, &cons));
+    TEST_ASSERT_EQUAL(0, pthread_create(&prodThread, NULL, producer, &prod));
+    TEST_ASSERT_EQUAL(0, pthread_join(prodThread, NULL));
+    TEST_ASSERT_EQUAL(0, pthread_join(consThread, NULL));
+
+    TEST_ASSERT_EQUAL_UINT64(SPSC_STRESS_TOTAL_BYTES, prod.bytesDone);
+    TEST_ASSERT_EQUAL_UINT64(SPSC_STRESS_TOTAL_BYTES, cons.bytesDone);
+    TEST_ASSERT_EQUAL_UINT64(0, cons.mismatches);
+    TEST_ASSERT_EQUAL(0, q ? cbuf_spsc_get_filled(q) : cbuf_get_filled(cb));
+}
+
+//
+void test_cbuf_spsc_stress(void) {
+    static uint8_t buffer[SPSC_STRESS_BUF_SIZE];
+    cbuf_t cb;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, sizeof(buffer)));
+    run_stress(&cb, NULL);
+}
+
+//
+void test_cbuf_spsc_stress_pow2(void) {
+    static uint8_t buffer[64 * 1024];
+    cbuf_t cb;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, sizeof(buffer)));
+    run_stress(&cb, NULL);
+}
+
+//
+void test_cbuf_spsc_aligned_single_thread(void) {
+    static cbuf_spsc_t q;
+    uint8_t buffer[8];
+    uint8_t const mockData[6] = {1, 2, 3, 4, 5, 6};
+    uint8_t readBuffer[8] = {0};
+
+    TEST_ASSERT_EQUAL(0, cbuf_spsc_init(&q, buffer, 6)); // not a power of two
+    TEST_ASSERT_EQUAL(0, cbuf_spsc_init(NULL, buffer, 8));
+    TEST_ASSERT_EQUAL(1, cbuf_spsc_init(&q, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(0, (uintptr_t)&q % CBUF_CACHE_LINE);
+    TEST_ASSERT_EQUAL(0, cbuf_spsc_read(&q, readBuffer, 1)); // empty
+
+    TEST_ASSERT_EQUAL(6, cbuf_spsc_write(&q, mockData, 6));
+    TEST_ASSERT_EQUAL(2, cbuf_spsc_write(&q, mockData, 6)); // whole buffer usable
+    TEST_ASSERT_EQUAL(0, cbuf_spsc_write(&q, mockData, 1)); // full
+    TEST_ASSERT_EQUAL(8, cbuf_spsc_get_filled(&q));
+    TEST_ASSERT_EQUAL(5, cbuf_spsc_read(&q, readBuffer, 5));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, 5);
+
+    // Producer still caches the old readPos, reloads it once it looks full
+    TEST_ASSERT_EQUAL(0, q.cachedReadPos);
+    TEST_ASSERT_EQUAL(4, cbuf_spsc_write(&q, mockData, 4)); // wraps around
+    TEST_ASSERT_EQUAL(5, q.cachedReadPos);
+    TEST_ASSERT_EQUAL(7, cbuf_spsc_read(&q, readBuffer, 8));
+    TEST_ASSERT_EQUAL_UINT8(6, readBuffer[0]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, &readBuffer[1], 2);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, &readBuffer[3], 4);
+    TEST_ASSERT_EQUAL(0, cbuf_spsc_get_filled(&q));
+}
+
+//
+void test_cbuf_spsc_aligned_stress(void) {
+    static uint8_t buffer[64 * 1024];
+    static cbuf_spsc_t q;
+
+    TEST_ASSERT_EQUAL(1, cbuf_spsc_init(&q, buffer, sizeof(buffer)));
+    run_stress(NULL, &q);
+}
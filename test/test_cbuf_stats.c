@@ -0,0 +1,132 @@
+#include "unity.h"
+#include <string.h>
+#include <pthread.h>
+
+#include "cbuf.h"
+
+// Built with CBUF_ENABLE_STATS (see project.yml), like src/cbuf.c for this test
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//
+void test_cbuf_stats_write_read(void) {
+#define DATA_SIZE 17
+    cbuf_t cb;
+    cbuf_stats_t counters, stats;
+    uint8_t buffer[DATA_SIZE];
+    uint8_t data[DATA_SIZE] = {0};
+    uint8_t byte;
+
+    TEST_ASSERT_EQUAL(0, cbuf_get_stats(&cb, NULL));
+    TEST_ASSERT_EQUAL(0, cbuf_stats_attach(NULL, &counters));
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL(5, cbuf_write(&cb, data, 5)); // nothing attached, not counted
+    TEST_ASSERT_EQUAL(0, cbuf_get_stats(&cb, &stats));
+    TEST_ASSERT_EQUAL(5, cbuf_read(&cb, data, 5));
+    memset(&counters, 0xFF, sizeof(counters));
+    TEST_ASSERT_EQUAL(1, cbuf_stats_attach(&cb, &counters));
+    TEST_ASSERT_EQUAL(1, cbuf_get_stats(&cb, &stats));
+    TEST_ASSERT_EQUAL(0, stats.bytesIn);
+    cbuf_reset(&cb);
+
+    TEST_ASSERT_EQUAL(0, cbuf_read(&cb, data, 4));             // empty hit
+    TEST_ASSERT_EQUAL(10, cbuf_write(&cb, data, 10));
+    TEST_ASSERT_EQUAL(6, cbuf_write(&cb, data, 10));           // partial, buffer full
+    TEST_ASSERT_EQUAL(0, cbuf_write(&cb, data, 1));            // full hit
+    TEST_ASSERT_EQUAL(0, cbuf_write_single(&cb, 1));           // full hit
+    TEST_ASSERT_EQUAL(12, cbuf_read(&cb, data, 12));
+    TEST_ASSERT_EQUAL(8, cbuf_write(&cb, data, 8));            // wraps
+    TEST_ASSERT_EQUAL(12, cbuf_read(&cb, data, 20));           // wraps, partial
+    TEST_ASSERT_EQUAL(1, cbuf_write_single(&cb, 1));
+    TEST_ASSERT_EQUAL(1, cbuf_read_single(&cb, &byte));
+    TEST_ASSERT_EQUAL(0, cbuf_read_single(&cb, &byte));        // empty hit
+    TEST_ASSERT_EQUAL(0, cbuf_write_overwrite(&cb, data, 16));
+    TEST_ASSERT_EQUAL(5, cbuf_write_overwrite(&cb, data, 5));  // dropped
+
+    TEST_ASSERT_EQUAL(1, cbuf_get_stats(&cb, &stats));
+    TEST_ASSERT_EQUAL(10 + 6 + 8 + 1 + 16 + 5, stats.bytesIn);
+    TEST_ASSERT_EQUAL(12 + 12 + 1, stats.bytesOut);
+    TEST_ASSERT_EQUAL(5, stats.bytesDropped);
+    TEST_ASSERT_EQUAL(1, stats.partialWrites);
+    TEST_ASSERT_EQUAL(1, stats.partialReads);
+    TEST_ASSERT_EQUAL(2, stats.fullHits);
+    TEST_ASSERT_EQUAL(2, stats.emptyHits);
+    TEST_ASSERT_EQUAL(2, stats.writeWraps); // cbuf_write() of 8 and the first overwrite
+    TEST_ASSERT_EQUAL(1, stats.readWraps);
+    TEST_ASSERT_EQUAL(16, stats.highWatermark);
+
+    // One sample per successful write, full buffer lands in the last bucket
+    uint64_t samples = 0;
+    for (int i = 0; i < CBUF_STATS_BUCKETS; i++) {
+        samples += stats.occupancy[i];
+    }
+    TEST_ASSERT_EQUAL(6, samples);
+    TEST_ASSERT_EQUAL(3, stats.occupancy[CBUF_STATS_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL(1, stats.occupancy[(10 * CBUF_STATS_BUCKETS) / 17]);
+    TEST_ASSERT_EQUAL(1, stats.occupancy[(12 * CBUF_STATS_BUCKETS) / 17]);
+    TEST_ASSERT_EQUAL(1, stats.occupancy[(1 * CBUF_STATS_BUCKETS) / 17]);
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_stats_zero_copy(void) {
+    cbuf_t cb;
+    cbuf_stats_t counters, stats;
+    uint8_t buffer[16];
+    uint8_t *wptr[2];
+    uint8_t const *rptr[2];
+    uint64_t len[2];
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(1, cbuf_stats_attach(&cb, &counters));
+    TEST_ASSERT_EQUAL(16, cbuf_write_reserve(&cb, 20, wptr, len));
+    TEST_ASSERT_EQUAL(16, cbuf_write_commit(&cb, 20)); // partial
+    TEST_ASSERT_EQUAL(16, cbuf_read_acquire(&cb, rptr, len));
+    TEST_ASSERT_EQUAL(10, cbuf_read_release(&cb, 10));
+    TEST_ASSERT_EQUAL(1, cbuf_get_stats(&cb, &stats));
+    TEST_ASSERT_EQUAL(16, stats.bytesIn);
+    TEST_ASSERT_EQUAL(10, stats.bytesOut);
+    TEST_ASSERT_EQUAL(1, stats.partialWrites);
+    TEST_ASSERT_EQUAL(0, stats.partialReads);
+    TEST_ASSERT_EQUAL(1, stats.occupancy[CBUF_STATS_BUCKETS - 1]);
+}
+
+static void *stats_producer(void *arg) {
+    cbuf_t *cb = (cbuf_t *)arg;
+    uint8_t chunk[100] = {0};
+    for (uint64_t written = 0; written < 10000000; ) {
+        uint64_t len = (10000000 - written < sizeof(chunk)) ? 10000000 - written : sizeof(chunk);
+        written += cbuf_write_spsc(cb, chunk, len);
+    }
+    return NULL;
+}
+
+//
+void test_cbuf_stats_snapshot_concurrent(void) {
+    static uint8_t buffer[4096];
+    cbuf_t cb;
+    cbuf_stats_t counters, stats;
+    uint8_t chunk[64];
+    pthread_t thread;
+    uint64_t bytesRead = 0;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(1, cbuf_stats_attach(&cb, &counters));
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, stats_producer, &cb));
+    while (bytesRead < 10000000) {
+        bytesRead += cbuf_read_spsc(&cb, chunk, sizeof(chunk));
+        TEST_ASSERT_EQUAL(1, cbuf_get_stats(&cb, &stats)); // while the producer runs
+        TEST_ASSERT_TRUE(stats.bytesOut <= stats.bytesIn);
+        TEST_ASSERT_TRUE(stats.highWatermark <= sizeof(buffer));
+    }
+    TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL));
+    TEST_ASSERT_EQUAL(1, cbuf_get_stats(&cb, &stats));
+    TEST_ASSERT_EQUAL_UINT64(10000000, stats.bytesIn);
+    TEST_ASSERT_EQUAL_UINT64(10000000, stats.bytesOut);
+}
@@ -0,0 +1,96 @@
+#include "unity.h"
+#include <string.h>
+
+#include "cbuf_typed.h"
+
+typedef struct {
+    uint16_t channel;
+    int32_t value;
+    uint64_t timestamp;
+} sample_t;
+
+CBUF_DECLARE(u32_ring, uint32_t)
+CBUF_DECLARE(sample_ring, sample_t)
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//
+void test_cbuf_typed_init(void) {
+    uint32_t storage[8];
+    u32_ring_t r;
+
+    TEST_ASSERT_EQUAL(0, u32_ring_init(NULL, storage, 8));
+    TEST_ASSERT_EQUAL(0, u32_ring_init(&r, NULL, 8));
+    TEST_ASSERT_EQUAL(0, u32_ring_init(&r, storage, 6)); // not a power of two
+    TEST_ASSERT_EQUAL(0, u32_ring_init(&r, storage, 1));
+    TEST_ASSERT_EQUAL(1, u32_ring_init(&r, storage, 8));
+    TEST_ASSERT_EQUAL(8, u32_ring_capacity(&r));
+    TEST_ASSERT_EQUAL(8, u32_ring_get_free(&r));
+    TEST_ASSERT_EQUAL(true, u32_ring_is_empty(&r));
+}
+
+//
+void test_cbuf_typed_push_pop(void) {
+    sample_t storage[4];
+    sample_ring_t r;
+    sample_t s;
+
+    TEST_ASSERT_EQUAL(1, sample_ring_init(&r, storage, 4));
+    TEST_ASSERT_EQUAL(0, sample_ring_pop(&r, &s)); // empty
+    for (uint16_t i = 0; i < 4; i++) {
+        s = (sample_t){i, -(int32_t)i * 1000, 1000000ull * i};
+        TEST_ASSERT_EQUAL(1, sample_ring_push(&r, &s));
+    }
+    TEST_ASSERT_EQUAL(true, sample_ring_is_full(&r));
+    TEST_ASSERT_EQUAL(0, sample_ring_push(&r, &s));
+
+    for (uint16_t i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL(1, sample_ring_pop(&r, &s));
+        TEST_ASSERT_EQUAL(i, s.channel);
+        TEST_ASSERT_EQUAL(-(int32_t)i * 1000, s.value);
+        TEST_ASSERT_EQUAL_UINT64(1000000ull * i, s.timestamp);
+        // Keep the ring busy so positions wrap around
+        s = (sample_t){(uint16_t)(i + 4), -(int32_t)(i + 4) * 1000, 1000000ull * (i + 4)};
+        TEST_ASSERT_EQUAL(1, sample_ring_push(&r, &s));
+    }
+    TEST_ASSERT_EQUAL(4, sample_ring_get_filled(&r));
+}
+
+//
+void test_cbuf_typed_push_pop_n(void) {
+    uint32_t storage[16];
+    uint32_t data[20];
+    uint32_t readBuffer[20];
+    u32_ring_t r;
+
+    for (uint32_t i = 0; i < 20; i++) {
+        data[i] = 0xA0000000u + i;
+    }
+    TEST_ASSERT_EQUAL(1, u32_ring_init(&r, storage, 16));
+    TEST_ASSERT_EQUAL(16, u32_ring_push_n(&r, data, 20)); // truncated to free space
+    TEST_ASSERT_EQUAL(0, u32_ring_push_n(&r, data, 1));
+    TEST_ASSERT_EQUAL(11, u32_ring_pop_n(&r, readBuffer, 11));
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(data, readBuffer, 11);
+
+    // Wraps around the end of storage
+    TEST_ASSERT_EQUAL(10, u32_ring_push_n(&r, &data[10], 10));
+    TEST_ASSERT_EQUAL(data[10], storage[0]);
+    memset(readBuffer, 0, sizeof(readBuffer));
+    TEST_ASSERT_EQUAL(15, u32_ring_pop_n(&r, readBuffer, 20));
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(&data[11], readBuffer, 5);
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(&data[10], &readBuffer[5], 10);
+    TEST_ASSERT_EQUAL(0, u32_ring_pop_n(&r, readBuffer, 1));
+
+    // Free-running positions close to overflow of uint64_t
+    r.writePos = r.readPos = UINT64_MAX - 3;
+    TEST_ASSERT_EQUAL(16, u32_ring_push_n(&r, data, 16));
+    TEST_ASSERT_EQUAL(true, u32_ring_is_full(&r));
+    TEST_ASSERT_EQUAL(16, u32_ring_pop_n(&r, readBuffer, 16));
+    TEST_ASSERT_EQUAL_HEX32_ARRAY(data, readBuffer, 16);
+}
@@ -0,0 +1,274 @@
+#include "unity.h"
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "cbuf.h"
+#include "cbuf_uring.h"
+
+#define STREAM_BYTES (1024 * 1024)
+
+static cbuf_uring_t u;
+static int fds[4];
+
+// Byte at stream offset i, differs between 256 byte blocks
+static inline uint8_t stream_byte(uint64_t i) {
+    return (uint8_t)(i ^ (i >> 8) ^ (i >> 16));
+}
+
+// Submit, wait for one completion and return it
+static cbuf_uring_event_t wait_event(void) {
+    cbuf_uring_event_t ev;
+    TEST_ASSERT_TRUE(cbuf_uring_submit(&u, 1) >= 0);
+    while (0 == cbuf_uring_reap(&u, &ev, 1)) {
+        TEST_ASSERT_TRUE(cbuf_uring_submit(&u, 1) >= 0);
+    }
+    return ev;
+}
+
+void setUp(void)
+{
+    fds[0] = fds[1] = fds[2] = fds[3] = -1;
+    if (!cbuf_uring_init(&u, 64)) {
+        TEST_IGNORE_MESSAGE("io_uring not available");
+    }
+}
+
+void tearDown(void)
+{
+    cbuf_uring_exit(&u);
+    for (int i = 0; i < 4; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+}
+
+//
+void test_cbuf_uring_pipe_fill_drain(void) {
+#define DATA_SIZE 10
+    cbuf_t cb;
+    cbuf_uring_buf_t buf;
+    uint8_t const mockData[DATA_SIZE] = {32, 50, 81, 60, 48, 58, 29, 13, 48, 57};
+    uint8_t buffer[DATA_SIZE];
+    uint8_t readBuffer[DATA_SIZE] = {0};
+    cbuf_uring_event_t ev;
+
+    TEST_ASSERT_EQUAL(0, pipe(&fds[0]));
+    TEST_ASSERT_EQUAL(0, pipe(&fds[2]));
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, DATA_SIZE));
+    cbuf_uring_buf_init(&buf, &cb, NULL);
+    TEST_ASSERT_EQUAL(0, cbuf_uring_prep_read_to_fd(&u, &buf, fds[3], DATA_SIZE)); // empty
+
+    // [o - o - o - o - o - o - w - o - o - o] -> free space wraps, one vectored read
+    cb.readPos = cb.writePos = 6;
+    TEST_ASSERT_EQUAL(DATA_SIZE, write(fds[1], mockData, DATA_SIZE));
+    TEST_ASSERT_EQUAL(1, cbuf_uring_prep_write_from_fd(&u, &buf, fds[0], DATA_SIZE));
+    TEST_ASSERT_EQUAL(0, cbuf_uring_prep_write_from_fd(&u, &buf, fds[0], DATA_SIZE)); // in flight
+    ev = wait_event();
+    TEST_ASSERT_EQUAL_PTR(&buf, ev.buf);
+    TEST_ASSERT_EQUAL(CBUF_URING_OP_FILL, ev.op);
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, ev.res);
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, cbuf_get_filled(&cb));
+    TEST_ASSERT_EQUAL(0, buf.inFlight);
+    TEST_ASSERT_EQUAL(0, cbuf_uring_prep_write_from_fd(&u, &buf, fds[0], DATA_SIZE)); // full
+
+    // Drain 5 bytes, then the rest across the wrap
+    TEST_ASSERT_EQUAL(1, cbuf_uring_prep_read_to_fd(&u, &buf, fds[3], 5));
+    ev = wait_event();
+    TEST_ASSERT_EQUAL(CBUF_URING_OP_DRAIN, ev.op);
+    TEST_ASSERT_EQUAL(5, ev.res);
+    TEST_ASSERT_EQUAL(1, cbuf_uring_prep_read_to_fd(&u, &buf, fds[3], DATA_SIZE));
+    ev = wait_event();
+    TEST_ASSERT_EQUAL(4, ev.res);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+    TEST_ASSERT_EQUAL(DATA_SIZE - 1, read(fds[2], readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(mockData, readBuffer, DATA_SIZE - 1);
+
+    // Last byte left in the pipe
+    TEST_ASSERT_EQUAL(1, cbuf_uring_prep_write_from_fd(&u, &buf, fds[0], DATA_SIZE));
+    ev = wait_event();
+    TEST_ASSERT_EQUAL(1, ev.res);
+    TEST_ASSERT_EQUAL(1, cbuf_read(&cb, readBuffer, DATA_SIZE));
+    TEST_ASSERT_EQUAL_UINT8(mockData[DATA_SIZE - 1], readBuffer[0]);
+
+    // End of file
+    close(fds[1]);
+    fds[1] = -1;
+    TEST_ASSERT_EQUAL(1, cbuf_uring_prep_write_from_fd(&u, &buf, fds[0], DATA_SIZE));
+    ev = wait_event();
+    TEST_ASSERT_EQUAL(0, ev.res);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+#undef DATA_SIZE
+}
+
+//
+void test_cbuf_uring_registered_file(void) {
+    static uint8_t buffer[4096];
+    static uint8_t data[8192];
+    static uint8_t readBuffer[8192];
+    cbuf_t cb;
+    cbuf_uring_buf_t buf;
+    cbuf_uring_buf_t *bufs[1] = {&buf};
+    cbuf_uring_event_t ev;
+    FILE *in = tmpfile();
+    FILE *out = tmpfile();
+
+    TEST_ASSERT_NOT_NULL(in);
+    TEST_ASSERT_NOT_NULL(out);
+    for (uint64_t i = 0; i < sizeof(data); i++) {
+        data[i] = stream_byte(i);
+    }
+    TEST_ASSERT_EQUAL(sizeof(data), pwrite(fileno(in), data, sizeof(data), 0));
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, sizeof(buffer)));
+    cbuf_uring_buf_init(&buf, &cb, NULL);
+    TEST_ASSERT_EQUAL(1, cbuf_uring_register_buffers(&u, bufs, 1));
+    TEST_ASSERT_EQUAL(0, buf.bufIndex);
+
+    // Start close to the end, fixed reads stop at the end of buffer
+    cb.readPos = cb.writePos = sizeof(buffer) - 1000;
+    uint64_t done = 0, drained = 0;
+    while (drained < sizeof(data)) {
+        if (done < sizeof(data) && cbuf_uring_prep_write_from_fd(&u, &buf, fileno(in), sizeof(data))) {
+            ev = wait_event();
+            TEST_ASSERT_EQUAL(CBUF_URING_OP_FILL, ev.op);
+            TEST_ASSERT_TRUE(ev.res > 0);
+            TEST_ASSERT_TRUE(ev.res <= 4096);
+            done += (uint64_t)ev.res;
+        }
+        TEST_ASSERT_EQUAL(1, cbuf_uring_prep_read_to_fd(&u, &buf, fileno(out), 1500));
+        ev = wait_event();
+        TEST_ASSERT_EQUAL(CBUF_URING_OP_DRAIN, ev.op);
+        TEST_ASSERT_TRUE(ev.res > 0);
+        drained += (uint64_t)ev.res;
+    }
+    TEST_ASSERT_EQUAL(sizeof(data), done);
+    TEST_ASSERT_EQUAL(true, cbuf_is_empty(&cb));
+    TEST_ASSERT_EQUAL(sizeof(data), pread(fileno(out), readBuffer, sizeof(readBuffer), 0));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBuffer, sizeof(data));
+    fclose(in);
+    fclose(out);
+}
+
+static void *stream_sender(void *arg) {
+    int fd = *(int *)arg;
+    uint8_t chunk[3000];
+    uint64_t offset = 0;
+
+    while (offset < STREAM_BYTES) {
+        uint64_t len = (STREAM_BYTES - offset < sizeof(chunk)) ? STREAM_BYTES - offset : sizeof(chunk);
+        for (uint64_t i = 0; i < len; i++) {
+            chunk[i] = stream_byte(offset + i);
+        }
+        ssize_t n = send(fd, chunk, len, 0);
+        if (n <= 0) {
+            break;
+        }
+        offset += (uint64_t)n;
+    }
+    shutdown(fd, SHUT_WR);
+    return NULL;
+}
+
+//
+void test_cbuf_uring_recv_multishot_tcp(void) {
+    static uint8_t buffer[16 * 1024];
+    uint8_t readBuffer[1000];
+    cbuf_t cb;
+    cbuf_uring_buf_t buf;
+    cbuf_uring_event_t events[16];
+    struct sockaddr_in addr = {0};
+    socklen_t addrLen = sizeof(addr);
+    pthread_t thread;
+
+    // Loopback TCP connection
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT_TRUE(fds[0] >= 0);
+    TEST_ASSERT_EQUAL(0, bind(fds[0], (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL(0, listen(fds[0], 1));
+    TEST_ASSERT_EQUAL(0, getsockname(fds[0], (struct sockaddr *)&addr, &addrLen));
+    fds[1] = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT_EQUAL(0, connect(fds[1], (struct sockaddr *)&addr, sizeof(addr)));
+    fds[2] = accept(fds[0], NULL, NULL);
+    TEST_ASSERT_TRUE(fds[2] >= 0);
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, sizeof(buffer)));
+    cbuf_uring_buf_init(&buf, &cb, NULL);
+    if (!cbuf_uring_prep_recv_multishot(&u, &buf, fds[2], 4096)) {
+        TEST_ASSERT_EQUAL(EINVAL, errno);
+        TEST_IGNORE_MESSAGE("incrementally consumed buffer rings not supported");
+    }
+    TEST_ASSERT_EQUAL(0, cbuf_uring_prep_recv_multishot(&u, &buf, fds[2], 4096)); // armed already
+    TEST_ASSERT_EQUAL(0, cbuf_uring_prep_write_from_fd(&u, &buf, fds[2], 100));   // no mixing
+
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, stream_sender, &fds[1]));
+    uint64_t received = 0, consumed = 0, mismatches = 0;
+    bool eof = false;
+    while (!eof || !cbuf_is_empty(&cb)) {
+        if (!eof && 0 == buf.inFlight) {
+            TEST_ASSERT_EQUAL(1, cbuf_uring_prep_recv_multishot(&u, &buf, fds[2], 0));
+        }
+        if (!eof) {
+            TEST_ASSERT_TRUE(cbuf_uring_submit(&u, 1) >= 0);
+        }
+        uint32_t count = cbuf_uring_reap(&u, events, 16);
+        for (uint32_t i = 0; i < count; i++) {
+            TEST_ASSERT_EQUAL(CBUF_URING_OP_RECV_MULTI, events[i].op);
+            if (events[i].res > 0) {
+                received += (uint64_t)events[i].res;
+            }
+            else if (0 == events[i].res) {
+                eof = true;
+            }
+            else {
+                TEST_ASSERT_EQUAL(-ENOBUFS, events[i].res); // ring ran full, armed again above
+            }
+        }
+        // Consume slowly so the ring runs full from time to time
+        uint64_t n = cbuf_read(&cb, readBuffer, sizeof(readBuffer));
+        for (uint64_t i = 0; i < n; i++) {
+            mismatches += (readBuffer[i] != stream_byte(consumed + i));
+        }
+        consumed += n;
+    }
+    TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL));
+    TEST_ASSERT_EQUAL_UINT64(STREAM_BYTES, received);
+    TEST_ASSERT_EQUAL_UINT64(STREAM_BYTES, consumed);
+    TEST_ASSERT_EQUAL_UINT64(0, mismatches);
+    cbuf_uring_buf_release(&u, &buf);
+    TEST_ASSERT_NULL(buf.bufRing);
+}
+
+//
+void test_cbuf_uring_recv_multishot_fail(void) {
+    uint8_t buffer[100];
+    cbuf_t cb;
+    cbuf_uring_buf_t buf;
+
+    TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, &fds[0]));
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, sizeof(buffer)));
+    cbuf_uring_buf_init(&buf, &cb, NULL);
+    TEST_ASSERT_EQUAL(0, cbuf_uring_prep_recv_multishot(&u, &buf, fds[0], 32)); // not cbuf_init_pow2()
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, 64));
+    TEST_ASSERT_EQUAL(0, cbuf_uring_prep_recv_multishot(&u, &buf, fds[0], 0));
+    TEST_ASSERT_EQUAL(0, cbuf_uring_prep_recv_multishot(&u, &buf, fds[0], 24));  // not a power of two
+    TEST_ASSERT_EQUAL(0, cbuf_uring_prep_recv_multishot(&u, &buf, fds[0], 128)); // larger than ring
+    TEST_ASSERT_NULL(buf.bufRing);
+}
+
+//
+void test_cbuf_uring_init_fail(void) {
+    cbuf_uring_t failed;
+
+    memset(&failed, 0, sizeof(failed));
+    TEST_ASSERT_EQUAL(0, cbuf_uring_init(&failed, 0));
+    TEST_ASSERT_EQUAL(-1, failed.fd); // exit must not close fd 0
+    cbuf_uring_exit(&failed);
+}
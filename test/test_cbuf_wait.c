@@ -0,0 +1,186 @@
+#include "unity.h"
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cbuf.h"
+#include "cbuf_wait.h"
+
+#define WAIT_STREAM_BYTES (16 * 1024 * 1024)
+
+typedef struct {
+    cbuf_t *cb;
+    uint64_t bytesDone;
+    uint64_t mismatches;
+    useconds_t delayUs;
+} wait_thread_t;
+
+static inline uint8_t stream_byte(uint64_t i) {
+    return (uint8_t)(i ^ (i >> 8) ^ (i >> 16));
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec * 1e-6;
+}
+
+static void *delayed_writer(void *arg) {
+    wait_thread_t *t = (wait_thread_t *)arg;
+    uint8_t const data[3] = {7, 8, 9};
+    usleep(t->delayUs);
+    t->bytesDone = cbuf_write_wait(t->cb, data, sizeof(data), CBUF_WAIT_FOREVER);
+    return NULL;
+}
+
+static void *delayed_reader(void *arg) {
+    wait_thread_t *t = (wait_thread_t *)arg;
+    uint8_t data[4];
+    usleep(t->delayUs);
+    t->bytesDone = cbuf_read_wait(t->cb, data, sizeof(data), CBUF_WAIT_FOREVER);
+    return NULL;
+}
+
+static void *stream_producer(void *arg) {
+    wait_thread_t *t = (wait_thread_t *)arg;
+    uint8_t chunk[1000];
+    uint64_t offset = 0;
+
+    while (offset < WAIT_STREAM_BYTES) {
+        uint64_t len = WAIT_STREAM_BYTES - offset;
+        if (len > sizeof(chunk)) {
+            len = sizeof(chunk);
+        }
+        for (uint64_t i = 0; i < len; i++) {
+            chunk[i] = stream_byte(offset + i);
+        }
+        uint64_t written = 0;
+        while (written < len) {
+            written += cbuf_write_wait(t->cb, &chunk[written], len - written, CBUF_WAIT_FOREVER);
+        }
+        offset += len;
+    }
+    t->bytesDone = offset;
+    return NULL;
+}
+
+static void *stream_consumer(void *arg) {
+    wait_thread_t *t = (wait_thread_t *)arg;
+    uint8_t chunk[777];
+    uint64_t offset = 0;
+
+    while (offset < WAIT_STREAM_BYTES) {
+        uint64_t n = cbuf_read_wait(t->cb, chunk, sizeof(chunk), CBUF_WAIT_FOREVER);
+        for (uint64_t i = 0; i < n; i++) {
+            if (chunk[i] != stream_byte(offset + i)) {
+                t->mismatches++;
+            }
+        }
+        offset += n;
+    }
+    t->bytesDone = offset;
+    return NULL;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+//
+void test_cbuf_wait_no_wait_needed(void) {
+    cbuf_t cb;
+    uint8_t buffer[8];
+    uint8_t readBuffer[8];
+    uint8_t const data[5] = {1, 2, 3, 4, 5};
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(0, cbuf_read_wait(NULL, readBuffer, 1, 0));
+    TEST_ASSERT_EQUAL(0, cbuf_read_wait(&cb, readBuffer, 0, CBUF_WAIT_FOREVER));
+    TEST_ASSERT_EQUAL(0, cbuf_read_wait(&cb, readBuffer, 1, 0)); // empty, don't wait
+
+    TEST_ASSERT_EQUAL(5, cbuf_write_wait(&cb, data, 5, 0));
+    TEST_ASSERT_EQUAL(2, cbuf_write_wait(&cb, data, 5, 0)); // partial, like cbuf_write_spsc()
+    TEST_ASSERT_EQUAL(0, cbuf_write_wait(&cb, data, 5, 0)); // full
+    TEST_ASSERT_EQUAL(7, cbuf_read_wait(&cb, readBuffer, sizeof(readBuffer), 0));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, readBuffer, 5);
+    TEST_ASSERT_EQUAL(0, cb.waiters);
+    cbuf_wait_notify(&cb); // nobody to wake
+}
+
+//
+void test_cbuf_wait_timeout(void) {
+    cbuf_t cb;
+    uint8_t buffer[4];
+    uint8_t byte = 0;
+
+    TEST_ASSERT_EQUAL(1, cbuf_init_pow2(&cb, buffer, sizeof(buffer)));
+    double t0 = now_ms();
+    TEST_ASSERT_EQUAL(0, cbuf_read_wait(&cb, &byte, 1, 30));
+    TEST_ASSERT_TRUE(now_ms() - t0 >= 29.0);
+    TEST_ASSERT_EQUAL(0, cb.waiters);
+
+    TEST_ASSERT_EQUAL(4, cbuf_write_wait(&cb, buffer, 4, 0));
+    t0 = now_ms();
+    TEST_ASSERT_EQUAL(0, cbuf_write_wait(&cb, &byte, 1, 30));
+    TEST_ASSERT_TRUE(now_ms() - t0 >= 29.0);
+    TEST_ASSERT_EQUAL(0, cb.waiters);
+}
+
+//
+void test_cbuf_wait_reader_woken(void) {
+    cbuf_t cb;
+    uint8_t buffer[16];
+    uint8_t readBuffer[8] = {0};
+    pthread_t thread;
+    wait_thread_t writer = {&cb, 0, 0, 20000};
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, delayed_writer, &writer));
+    TEST_ASSERT_EQUAL(3, cbuf_read_wait(&cb, readBuffer, sizeof(readBuffer), 5000));
+    TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL));
+    TEST_ASSERT_EQUAL(3, writer.bytesDone);
+    TEST_ASSERT_EQUAL_UINT8(7, readBuffer[0]);
+    TEST_ASSERT_EQUAL_UINT8(9, readBuffer[2]);
+    TEST_ASSERT_EQUAL(0, cb.waiters);
+}
+
+//
+void test_cbuf_wait_writer_woken(void) {
+    cbuf_t cb;
+    uint8_t buffer[8];
+    uint8_t const data[8] = {0};
+    pthread_t thread;
+    wait_thread_t reader = {&cb, 0, 0, 20000};
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(7, cbuf_write_wait(&cb, data, sizeof(data), 0));
+    TEST_ASSERT_EQUAL(0, pthread_create(&thread, NULL, delayed_reader, &reader));
+    TEST_ASSERT_EQUAL(4, cbuf_write_wait(&cb, data, sizeof(data), 5000));
+    TEST_ASSERT_EQUAL(0, pthread_join(thread, NULL));
+    TEST_ASSERT_EQUAL(4, reader.bytesDone);
+    TEST_ASSERT_EQUAL(0, cb.waiters);
+}
+
+//
+void test_cbuf_wait_stream(void) {
+    static uint8_t buffer[4096 + 3];
+    cbuf_t cb;
+    pthread_t prodThread, consThread;
+    wait_thread_t prod = {&cb, 0, 0, 0}, cons = {&cb, 0, 0, 0};
+
+    TEST_ASSERT_EQUAL(1, cbuf_init(&cb, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL(0, pthread_create(&consThread, NULL, stream_consumer, &cons));
+    TEST_ASSERT_EQUAL(0, pthread_create(&prodThread, NULL, stream_producer, &prod));
+    TEST_ASSERT_EQUAL(0, pthread_join(prodThread, NULL));
+    TEST_ASSERT_EQUAL(0, pthread_join(consThread, NULL));
+
+    TEST_ASSERT_EQUAL_UINT64(WAIT_STREAM_BYTES, prod.bytesDone);
+    TEST_ASSERT_EQUAL_UINT64(WAIT_STREAM_BYTES, cons.bytesDone);
+    TEST_ASSERT_EQUAL_UINT64(0, cons.mismatches);
+    TEST_ASSERT_EQUAL(0, cbuf_get_filled(&cb));
+}